@@ -0,0 +1,135 @@
+/**
+ * @file bench_alloc.c
+ * @brief Heap allocations per ClientCache operation
+ *
+ * Counts every malloc(), calloc() and realloc() the process makes by
+ * wrapping glibc's allocator, and reports them per operation next to the
+ * slab allocations the cache accounts itself (ClientCacheStats). Resident
+ * hits should allocate nothing, and stores should only reach the heap when
+ * a slab runs out of chunks.
+ *
+ * The wrappers rely on glibc exporting __libc_malloc() and friends.
+ */
+#include "client_cache.h"
+#include "latency_histogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_ENTRIES 1000     ///< Resident entries of the cache
+#define BENCH_OPERATIONS 20000 ///< Operations per workload
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static size_t allocations;
+
+void* malloc(size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+typedef enum {
+    WORKLOAD_INSERT,    /* new keys into a full cache */
+    WORKLOAD_OVERWRITE, /* stores to resident keys */
+    WORKLOAD_PEEK,      /* resident hits without a copy */
+    WORKLOAD_GET,       /* resident hits returning a copy */
+} Workload;
+
+static const char* WORKLOAD_NAMES[] = {"insert", "overwrite", "peek", "get"};
+
+static uint64_t slab_allocations(const ClientCache* cache) {
+    ClientCacheStats stats;
+    return client_cache_get_stats(cache, &stats) == 0 ? stats.heap_allocations
+                                                       : 0;
+}
+
+static int run(ClientCache* cache, Workload workload) {
+    char key[64];
+    char value[] = "{\"temperature\":20.5,\"humidity\":81}";
+
+    size_t   heap_before = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+    uint64_t slab_before = slab_allocations(cache);
+    uint64_t start       = latency_now_ns();
+    for (size_t i = 0; i < BENCH_OPERATIONS; i++) {
+        size_t id = workload == WORKLOAD_INSERT ? BENCH_ENTRIES + i
+                                                : i % BENCH_ENTRIES;
+        snprintf(key, sizeof(key), "bench:%zu", id);
+
+        int ok;
+        switch (workload) {
+        case WORKLOAD_INSERT:
+        case WORKLOAD_OVERWRITE:
+            ok = client_cache_set(cache, key, value) == 0;
+            break;
+        case WORKLOAD_PEEK:
+            ok = client_cache_peek(cache, key, NULL) != NULL;
+            break;
+        default: {
+            char* data = client_cache_get(cache, key);
+            ok         = data != NULL;
+            free(data);
+            break;
+        }
+        }
+        if (!ok) {
+            return -1;
+        }
+    }
+    double ns   = (double)(latency_now_ns() - start) / BENCH_OPERATIONS;
+    size_t heap = __atomic_load_n(&allocations, __ATOMIC_RELAXED) -
+                  heap_before;
+    uint64_t slab = slab_allocations(cache) - slab_before;
+
+    printf("%10s %12.3f %12.3f %12.0f\n", WORKLOAD_NAMES[workload],
+           (double)heap / BENCH_OPERATIONS, (double)slab / BENCH_OPERATIONS,
+           ns);
+    return 0;
+}
+
+int main(void) {
+    ClientCache* cache = client_cache_create(BENCH_ENTRIES, CACHE_DEFAULT_TTL);
+    if (!cache || client_cache_set_store(cache, CLIENT_CACHE_STORE_LOG) != 0) {
+        fprintf(stderr, "bench_alloc: cannot create the cache\n");
+        client_cache_destroy(cache);
+        return 1;
+    }
+    client_cache_clear(cache);
+
+    char key[64];
+    for (size_t i = 0; i < BENCH_ENTRIES; i++) {
+        snprintf(key, sizeof(key), "bench:%zu", i);
+        client_cache_set(cache, key, "{}");
+    }
+
+    printf("ClientCache, %d resident entries, per operation:\n",
+           BENCH_ENTRIES);
+    printf("%10s %12s %12s %12s\n", "workload", "mallocs", "slab mallocs",
+           "ns");
+    /* Inserting pushes the first keys out; overwrite them back in before
+     * the hit workloads */
+    int result = run(cache, WORKLOAD_INSERT) == 0 &&
+                         run(cache, WORKLOAD_OVERWRITE) == 0 &&
+                         run(cache, WORKLOAD_PEEK) == 0 &&
+                         run(cache, WORKLOAD_GET) == 0
+                     ? 0
+                     : 1;
+    if (result != 0) {
+        fprintf(stderr, "bench_alloc: a workload failed\n");
+    }
+
+    client_cache_clear(cache);
+    client_cache_destroy(cache);
+    return result;
+}
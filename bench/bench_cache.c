@@ -0,0 +1,166 @@
+/**
+ * @file bench_cache.c
+ * @brief ClientCache lookup and store cost across entry counts
+ *
+ * Fills a cache of each size with as many keys, then times stores, resident
+ * hits and misses. With the hash index the cost per operation should stay
+ * flat as the entry count grows. A last run sends requests through a
+ * WeatherClient over the loopback transport, so that the cached path can be
+ * compared with a full exchange without any network in the way.
+ *
+ * Run it with `make bench`, which points JUST_WEATHER_CACHE_DIR at a
+ * scratch directory.
+ */
+#include "client_cache.h"
+#include "latency_histogram.h"
+#include "transport_loopback.h"
+#include "weather_client.h"
+
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_LOOKUPS 1000000 ///< Timed lookups per entry count
+
+static const size_t ENTRY_COUNTS[] = {100, 1000, 10000, 100000};
+
+static const char CANNED_RESPONSE[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 44\r\n\r\n"
+    "{\"success\":true,\"data\":{\"temperature\":20.5}}";
+
+/* xorshift64, so that lookups do not walk the keys in insertion order */
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double per_op(uint64_t start, size_t operations) {
+    return (double)(latency_now_ns() - start) / (double)operations;
+}
+
+static int bench_entries(size_t entries) {
+    ClientCache* cache = client_cache_create(entries, CACHE_DEFAULT_TTL);
+    if (!cache) {
+        return -1;
+    }
+    client_cache_clear(cache);
+
+    char key[64];
+    char value[] = "{\"temperature\":20.5}";
+
+    uint64_t start = latency_now_ns();
+    for (size_t i = 0; i < entries; i++) {
+        snprintf(key, sizeof(key), "bench:%zu", i);
+        if (client_cache_set(cache, key, value) != 0) {
+            client_cache_destroy(cache);
+            return -1;
+        }
+    }
+    double set_ns = per_op(start, entries);
+
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    size_t   found = 0;
+    start          = latency_now_ns();
+    for (size_t i = 0; i < BENCH_LOOKUPS; i++) {
+        snprintf(key, sizeof(key), "bench:%zu",
+                 (size_t)(next_random(&state) % entries));
+        char* data = client_cache_get(cache, key);
+        if (data) {
+            found++;
+        }
+        free(data);
+    }
+    double hit_ns = per_op(start, BENCH_LOOKUPS);
+
+    size_t misses = BENCH_LOOKUPS / 10;
+    start         = latency_now_ns();
+    for (size_t i = 0; i < misses; i++) {
+        snprintf(key, sizeof(key), "absent:%zu", i);
+        char* data = client_cache_get(cache, key);
+        if (data) {
+            found++;
+        }
+        free(data);
+    }
+    double miss_ns = per_op(start, misses);
+
+    printf("%10zu %12.0f %12.0f %12.0f\n", entries, set_ns, hit_ns, miss_ns);
+    client_cache_clear(cache);
+    client_cache_destroy(cache);
+    return found == BENCH_LOOKUPS ? 0 : -1;
+}
+
+static double time_requests(WeatherClient* client, size_t count) {
+    uint64_t start = latency_now_ns();
+    for (size_t i = 0; i < count; i++) {
+        json_t* weather = weather_client_get_current(
+            client, 59.0 + (double)i / 100.0, 18.0, NULL);
+        if (!weather) {
+            return -1;
+        }
+        json_decref(weather);
+    }
+    return (double)(latency_now_ns() - start);
+}
+
+static int bench_loopback(void) {
+    WeatherClient* client = weather_client_create("localhost", 80);
+    Transport*     loop =
+        transport_loopback_create(CANNED_RESPONSE, strlen(CANNED_RESPONSE));
+    if (!client || !loop || weather_client_set_transport(client, loop) != 0) {
+        transport_destroy(loop);
+        weather_client_destroy(client);
+        return -1;
+    }
+
+    /* Every round fetches the coordinates once and then hits for them */
+    size_t coordinates = 40;
+    size_t rounds      = 50;
+    double fetched     = 0;
+    double cached      = 0;
+    for (size_t round = 0; round < rounds; round++) {
+        weather_client_clear_cache(client);
+        double first  = time_requests(client, coordinates);
+        double second = time_requests(client, coordinates);
+        if (first < 0 || second < 0) {
+            weather_client_destroy(client);
+            return -1;
+        }
+        fetched += first;
+        cached  += second;
+    }
+
+    size_t requests = coordinates * rounds;
+    printf("\nWeatherClient over loopback, %zu exchanges:\n",
+           transport_loopback_get_exchanges(loop));
+    printf("  fetched  %10.0f ns/request\n", fetched / (double)requests);
+    printf("  cached   %10.0f ns/request\n", cached / (double)requests);
+
+    weather_client_clear_cache(client);
+    weather_client_destroy(client);
+    return 0;
+}
+
+int main(void) {
+    printf("ClientCache, ns per operation:\n");
+    printf("%10s %12s %12s %12s\n", "entries", "set", "hit", "miss");
+    for (size_t i = 0; i < sizeof(ENTRY_COUNTS) / sizeof(ENTRY_COUNTS[0]);
+         i++) {
+        if (bench_entries(ENTRY_COUNTS[i]) != 0) {
+            fprintf(stderr, "bench_cache: run with %zu entries failed\n",
+                    ENTRY_COUNTS[i]);
+            return 1;
+        }
+    }
+
+    if (bench_loopback() != 0) {
+        fprintf(stderr, "bench_cache: loopback run failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file bench_hash.c
+ * @brief Key hashing cost of hash_fast and MD5 across key lengths
+ *
+ * Times the two namings of the files store (hash_fast_string() and
+ * hash_md5_string()) and the 64-bit hash_fast_64() used by the resident
+ * index, for keys from a few bytes up to a kilobyte.
+ */
+#include "hash_fast.h"
+#include "hash_md5.h"
+#include "latency_histogram.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_BYTES (64 * 1024 * 1024) ///< Bytes hashed per measurement
+
+static const size_t KEY_LENGTHS[] = {8, 16, 32, 64, 128, 256, 1024};
+
+/* Keeps the compiler from dropping the hashing */
+static volatile uint64_t sink;
+
+static double time_fast_string(const char* key, size_t length,
+                               size_t rounds) {
+    char     name[HASH_FAST_STRING_LENGTH];
+    uint64_t start = latency_now_ns();
+    for (size_t i = 0; i < rounds; i++) {
+        hash_fast_string(key, length, name, sizeof(name));
+        sink += (uint64_t)name[i % 32];
+    }
+    return (double)(latency_now_ns() - start) / (double)rounds;
+}
+
+static double time_md5_string(const char* key, size_t length, size_t rounds) {
+    char     name[HASH_MD5_STRING_LENGTH];
+    uint64_t start = latency_now_ns();
+    for (size_t i = 0; i < rounds; i++) {
+        hash_md5_string(key, length, name, sizeof(name));
+        sink += (uint64_t)name[i % 32];
+    }
+    return (double)(latency_now_ns() - start) / (double)rounds;
+}
+
+static double time_fast_64(const char* key, size_t length, size_t rounds) {
+    uint64_t start = latency_now_ns();
+    for (size_t i = 0; i < rounds; i++) {
+        sink += hash_fast_64(key, length);
+    }
+    return (double)(latency_now_ns() - start) / (double)rounds;
+}
+
+int main(void) {
+    char key[1024];
+    for (size_t i = 0; i < sizeof(key); i++) {
+        key[i] = (char)('a' + i % 26);
+    }
+
+    printf("Key hashing, ns per key:\n");
+    printf("%8s %14s %14s %14s\n", "bytes", "hash_fast_64", "fast_string",
+           "md5_string");
+    for (size_t i = 0; i < sizeof(KEY_LENGTHS) / sizeof(KEY_LENGTHS[0]);
+         i++) {
+        size_t length = KEY_LENGTHS[i];
+        size_t rounds = BENCH_BYTES / length;
+        /* A different first byte every run, so nothing can be reused */
+        key[0] = (char)('A' + i);
+        printf("%8zu %14.1f %14.1f %14.1f\n", length,
+               time_fast_64(key, length, rounds),
+               time_fast_string(key, length, rounds),
+               time_md5_string(key, length, rounds));
+    }
+    return 0;
+}
@@ -12,36 +12,77 @@
 
 #include "weather_client.h"
 
+#include "../network/client_tcp.h"
 #include "../network/http_client.h"
 #include "../utils/client_cache.h"
 #include "../utils/utils.h"
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Entry cap for the response cache; the byte budgets are the real limit */
+#define WEATHER_CACHE_MAX_ENTRIES 4096
+#define WEATHER_BACKEND_MAX 272 ///< "host:port" or "unix:/path", with NUL
+#define WEATHER_KEY_SEPARATOR '|' ///< between the backend and the request
+
 struct WeatherClient {
-    HttpClient*  http;
-    ClientCache* cache;
-    char         server_host[256];
-    int          server_port;
-    int          timeout_ms;
+    HttpClient*      http;
+    ClientCache*     cache;
+    char             server_host[256];
+    int              server_port;
+    char             backend[WEATHER_BACKEND_MAX]; /* cache key prefix */
+    int              timeout_ms;
+    time_t           negative_ttl; /* 0: failed lookups are not cached */
+    uint64_t         requests;
+    uint64_t         cache_served;
+    uint64_t         fetched;
+    uint64_t         errors;
+    uint64_t         negative_served;
+    LatencyHistogram cached_latency;
+    LatencyHistogram network_latency;
 };
 
-static char*   build_cache_key(const char* endpoint, const char* params);
+static char*   build_cache_key(const WeatherClient* client,
+                               const char* endpoint, const char* params);
 static json_t* make_request(WeatherClient* client, const char* url,
-                            const char* cache_key, char** error);
+                            const char* cache_key, time_t ttl, char** error);
+static json_t* fetch_json(WeatherClient* client, const char* url,
+                          const char* cache_key, time_t ttl, int* from_cache,
+                          char** error);
 
 WeatherClient* weather_client_create(const char* host, int port) {
-    WeatherClient* client = malloc(sizeof(WeatherClient));
+    WeatherClient* client = calloc(1, sizeof(WeatherClient));
     if (!client) {
         return NULL;
     }
 
+    const char* unix_path  = NULL;
+    size_t      prefix_len = strlen(CLIENT_TCP_UNIX_PREFIX);
+    if (host && strncmp(host, CLIENT_TCP_UNIX_PREFIX, prefix_len) == 0) {
+        unix_path = host + prefix_len;
+        host      = NULL;
+    }
+
     strncpy(client->server_host, host ? host : "localhost", 255);
     client->server_host[255] = '\0';
     client->server_port      = port > 0 ? port : 10680;
     client->timeout_ms       = 5000;
+    client->negative_ttl     = TTL_NEGATIVE;
+
+    /* Responses of different servers must not answer for each other; host
+     * names are case-insensitive */
+    if (unix_path) {
+        snprintf(client->backend, sizeof(client->backend), "%s%s",
+                 CLIENT_TCP_UNIX_PREFIX, unix_path);
+    } else {
+        snprintf(client->backend, sizeof(client->backend), "%s:%d",
+                 client->server_host, client->server_port);
+        for (char* c = client->backend; *c; c++) {
+            *c = (char)tolower((unsigned char)*c);
+        }
+    }
 
     client->http = http_client_create(client->timeout_ms);
     if (!client->http) {
@@ -49,13 +90,31 @@ WeatherClient* weather_client_create(const char* host, int port) {
         return NULL;
     }
 
-    client->cache = client_cache_create(CACHE_MAX_ENTRIES, CACHE_DEFAULT_TTL);
-    if (!client->cache) {
+    if (unix_path &&
+        http_client_set_unix_socket(client->http, unix_path) != 0) {
+        http_client_destroy(client->http);
+        free(client);
+        return NULL;
+    }
+
+    client->cache =
+        client_cache_create(WEATHER_CACHE_MAX_ENTRIES, CACHE_DEFAULT_TTL);
+    if (!client->cache ||
+        client_cache_set_policy(client->cache, CLIENT_CACHE_POLICY_TINYLFU) ||
+        client_cache_set_limits(client->cache, CACHE_DEFAULT_MAX_BYTES,
+                                CACHE_DEFAULT_MAX_DISK_BYTES)) {
+        client_cache_destroy(client->cache);
         http_client_destroy(client->http);
         free(client);
         return NULL;
     }
 
+    /* Without the log, the flusher thread or the shared segment the cache
+     * still works */
+    client_cache_set_store(client->cache, CLIENT_CACHE_STORE_LOG);
+    client_cache_set_write_mode(client->cache, CLIENT_CACHE_WRITE_BEHIND);
+    client_cache_set_shared(client->cache, CACHE_DEFAULT_SHARED_BYTES);
+
     return client;
 }
 
@@ -97,9 +156,9 @@ json_t* weather_client_get_current(WeatherClient* client, double lat,
 
     char params[128];
     snprintf(params, sizeof(params), "lat=%.4f:lon=%.4f", lat, lon);
-    char* cache_key = build_cache_key("current", params);
+    char* cache_key = build_cache_key(client, "current", params);
 
-    json_t* result = make_request(client, url, cache_key, error);
+    json_t* result = make_request(client, url, cache_key, TTL_WEATHER, error);
 
     free(cache_key);
     return result;
@@ -174,9 +233,9 @@ json_t* weather_client_get_weather_by_city(WeatherClient* client,
     snprintf(params, sizeof(params), "city=%s:country=%s:region=%s",
              normalized_city, normalized_country, normalized_region);
 
-    char* cache_key = build_cache_key("weather", params);
+    char* cache_key = build_cache_key(client, "weather", params);
 
-    json_t* result = make_request(client, url, cache_key, error);
+    json_t* result = make_request(client, url, cache_key, TTL_WEATHER, error);
 
     free(city_encoded);
     free(cache_key);
@@ -217,9 +276,9 @@ json_t* weather_client_search_cities(WeatherClient* client, const char* query,
 
     char params[512];
     snprintf(params, sizeof(params), "query=%s", normalized_query);
-    char* cache_key = build_cache_key("cities", params);
+    char* cache_key = build_cache_key(client, "cities", params);
 
-    json_t* result = make_request(client, url, cache_key, error);
+    json_t* result = make_request(client, url, cache_key, TTL_CITIES, error);
 
     free(query_encoded);
     free(cache_key);
@@ -238,9 +297,12 @@ json_t* weather_client_get_homepage(WeatherClient* client, char** error) {
     snprintf(url, sizeof(url), "http://%s:%d/", client->server_host,
              client->server_port);
 
-    char* cache_key = build_cache_key("homepage", "");
+    char* cache_key = build_cache_key(client, "homepage", "");
 
-    return make_request(client, url, cache_key, error);
+    json_t* result = make_request(client, url, cache_key, TTL_HOMEPAGE, error);
+
+    free(cache_key);
+    return result;
 }
 
 json_t* weather_client_echo(WeatherClient* client, char** error) {
@@ -279,31 +341,189 @@ void weather_client_clear_cache(WeatherClient* client) {
     }
 }
 
+int weather_client_invalidate_cache(WeatherClient* client, const char* prefix) {
+    if (!client || !client->cache || !prefix) {
+        return -1;
+    }
+
+    /* Prefixes name requests; the keys start with the backend */
+    size_t len        = strlen(client->backend) + strlen(prefix) + 2;
+    char*  key_prefix = malloc(len);
+    if (!key_prefix) {
+        return -1;
+    }
+    snprintf(key_prefix, len, "%s%c%s", client->backend, WEATHER_KEY_SEPARATOR,
+             prefix);
+
+    int removed = client_cache_invalidate_prefix(client->cache, key_prefix);
+    free(key_prefix);
+    return removed;
+}
+
 void weather_client_set_timeout(WeatherClient* client, int timeout_ms) {
     if (client) {
         client->timeout_ms = timeout_ms;
     }
 }
 
-static char* build_cache_key(const char* endpoint, const char* params) {
-    size_t len = strlen(endpoint) + strlen(params) + 2;
+void weather_client_set_negative_ttl(WeatherClient* client, time_t ttl) {
+    if (client && ttl >= 0) {
+        client->negative_ttl = ttl;
+    }
+}
+
+int weather_client_set_transport(WeatherClient* client, Transport* transport) {
+    if (!client) {
+        return -1;
+    }
+    return http_client_set_transport(client->http, transport);
+}
+
+void weather_client_set_telemetry(WeatherClient* client, int enabled) {
+    if (client) {
+        http_client_set_telemetry(client->http, enabled);
+    }
+}
+
+int weather_client_set_cache_policy(WeatherClient*    client,
+                                    ClientCachePolicy policy) {
+    if (!client) {
+        return -1;
+    }
+    return client_cache_set_policy(client->cache, policy);
+}
+
+int weather_client_set_cache_store(WeatherClient*   client,
+                                   ClientCacheStore store) {
+    if (!client) {
+        return -1;
+    }
+    return client_cache_set_store(client->cache, store);
+}
+
+int weather_client_set_cache_write_mode(WeatherClient*       client,
+                                        ClientCacheWriteMode mode) {
+    if (!client) {
+        return -1;
+    }
+    return client_cache_set_write_mode(client->cache, mode);
+}
+
+int weather_client_set_shared_cache(WeatherClient* client, int enabled) {
+    if (!client) {
+        return -1;
+    }
+    return client_cache_set_shared(client->cache,
+                                   enabled ? CACHE_DEFAULT_SHARED_BYTES : 0);
+}
+
+int weather_client_get_stats(WeatherClient* client, WeatherClientStats* stats) {
+    if (!client || !stats) {
+        return -1;
+    }
+
+    stats->requests        = client->requests;
+    stats->cache_served    = client->cache_served;
+    stats->fetched         = client->fetched;
+    stats->errors          = client->errors;
+    stats->negative_served = client->negative_served;
+    latency_histogram_snapshot(&client->cached_latency,
+                               &stats->cached_latency);
+    latency_histogram_snapshot(&client->network_latency,
+                               &stats->network_latency);
+    if (client_cache_get_stats(client->cache, &stats->cache) != 0 ||
+        client_cache_get_counters(client->cache, &stats->counters) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int weather_client_set_cache_key_hash(WeatherClient*     client,
+                                      ClientCacheKeyHash key_hash) {
+    if (!client) {
+        return -1;
+    }
+    return client_cache_set_key_hash(client->cache, key_hash);
+}
+
+int weather_client_set_cache_dir(WeatherClient* client, const char* dir) {
+    if (!client) {
+        return -1;
+    }
+    return client_cache_set_directory(client->cache, dir);
+}
+
+const HttpBackendStats* weather_client_get_backend_stats(WeatherClient* client,
+                                                         size_t*        count) {
+    if (!client) {
+        if (count) {
+            *count = 0;
+        }
+        return NULL;
+    }
+    return http_client_get_backend_stats(client->http, count);
+}
+
+/* <backend>|<endpoint>:<params>; the part after the separator is the key
+ * that releases without the backend prefix used */
+static char* build_cache_key(const WeatherClient* client,
+                             const char* endpoint, const char* params) {
+    size_t len = strlen(client->backend) + strlen(endpoint) + strlen(params) +
+                 3;
     char*  key = malloc(len);
     if (!key) {
         return NULL;
     }
-    snprintf(key, len, "%s:%s", endpoint, params);
+    snprintf(key, len, "%s%c%s:%s", client->backend, WEATHER_KEY_SEPARATOR,
+             endpoint, params);
     return key;
 }
 
-static json_t* make_request(WeatherClient* client, const char* url,
-                            const char* cache_key, char** error) {
-    char* cached = client_cache_get(client->cache, cache_key);
+/* Returns 0 for a successful answer; otherwise sets *error from the body */
+static int check_success(json_t* result, char** error) {
+    json_t* success_field = json_object_get(result, "success");
+    if (!success_field || !json_is_boolean(success_field) ||
+        json_boolean_value(success_field)) {
+        return 0;
+    }
+
+    json_t* error_obj = json_object_get(result, "error");
+    if (error_obj && error) {
+        json_t* msg = json_object_get(error_obj, "message");
+        if (msg && json_is_string(msg)) {
+            *error = strdup(json_string_value(msg));
+        }
+    }
+    return -1;
+}
+
+static int is_empty_result(json_t* result) {
+    json_t* data = json_object_get(result, "data");
+    return data && json_is_array(data) && json_array_size(data) == 0;
+}
+
+static json_t* fetch_json(WeatherClient* client, const char* url,
+                          const char* cache_key, time_t ttl, int* from_cache,
+                          char** error) {
+    size_t      cached_len = 0;
+    const char* cached =
+        client_cache_peek(client->cache, cache_key, &cached_len);
+    const char* legacy_key = cache_key + strlen(client->backend) + 1;
+    if (!cached &&
+        client_cache_import_legacy(client->cache, cache_key, legacy_key) > 0) {
+        cached = client_cache_peek(client->cache, cache_key, &cached_len);
+    }
     if (cached) {
         json_error_t json_err;
-        json_t*      result = json_loads(cached, 0, &json_err);
-        free(cached);
+        json_t*      result = json_loadb(cached, cached_len, 0, &json_err);
 
         if (result) {
+            *from_cache = 1;
+            if (check_success(result, error) != 0) {
+                /* A negative entry: the server said no a moment ago */
+                json_decref(result);
+                return NULL;
+            }
             return result;
         }
     }
@@ -333,22 +553,45 @@ static json_t* make_request(WeatherClient* client, const char* url,
         return NULL;
     }
 
-    json_t* success_field = json_object_get(result, "success");
-    if (success_field && json_is_boolean(success_field)) {
-        if (!json_boolean_value(success_field)) {
-            json_t* error_obj = json_object_get(result, "error");
-            if (error_obj && error) {
-                json_t* msg = json_object_get(error_obj, "message");
-                if (msg && json_is_string(msg)) {
-                    *error = strdup(json_string_value(msg));
-                }
-            }
-            json_decref(result);
-            return NULL;
-        }
+    int failed = check_success(result, error) != 0;
+    if (failed || is_empty_result(result)) {
+        /* Rejections are cached briefly; server errors may be transient */
+        int status = http_client_get_status_code(client->http);
+        ttl        = status < 500 ? client->negative_ttl : 0;
     }
 
-    client_cache_set(client->cache, cache_key, body);
+    if (ttl > 0) {
+        client_cache_set_ex(client->cache, cache_key, body,
+                            http_client_get_body_size(client->http), ttl,
+                            http_client_get_etag(client->http));
+    }
 
+    if (failed) {
+        json_decref(result);
+        return NULL;
+    }
+    return result;
+}
+
+static json_t* make_request(WeatherClient* client, const char* url,
+                            const char* cache_key, time_t ttl, char** error) {
+    uint64_t start      = latency_now_ns();
+    int      from_cache = 0;
+    json_t*  result =
+        fetch_json(client, url, cache_key, ttl, &from_cache, error);
+    uint64_t elapsed = latency_now_ns() - start;
+
+    client->requests++;
+    if (!result) {
+        client->errors++;
+    }
+    if (from_cache) {
+        client->cache_served++;
+        client->negative_served += result == NULL;
+        latency_histogram_record(&client->cached_latency, elapsed);
+    } else if (result) {
+        client->fetched++;
+        latency_histogram_record(&client->network_latency, elapsed);
+    }
     return result;
 }
@@ -13,6 +13,8 @@
  * - Weather lookup by city name with optional country/region
  * - City search with autocomplete support
  * - Automatic response caching with configurable TTL
+ * - Negative caching: error answers and empty search results are kept for
+ *   a short TTL, so repeated bad lookups are answered locally
  * - JSON response parsing and validation
  * - Error handling with descriptive messages
  *
@@ -25,9 +27,14 @@
 #define TTL_WEATHER 300    ///< Weather data cache: 5 minutes
 #define TTL_CITIES 3600    ///< Cities search cache: 1 hour
 #define TTL_HOMEPAGE 86400 ///< Homepage cache: 24 hours
+#define TTL_NEGATIVE 30    ///< Error answers and empty results: 30 seconds
+
+#include "../network/http_client.h"
+#include "../utils/client_cache.h"
 
 #include <jansson.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 /**
@@ -41,6 +48,26 @@
 
 typedef struct WeatherClient WeatherClient;
 
+/**
+ * @struct WeatherClientStats
+ * @brief Request counters and cache statistics of a client
+ *
+ * Request latencies are end to end: cache lookup, network round trip and
+ * JSON parsing. Counted are the cached API calls (current, weather,
+ * cities, homepage); echo bypasses the cache and is not included.
+ */
+typedef struct {
+    uint64_t            requests;        /**< Cached API calls made */
+    uint64_t            cache_served;    /**< Answered from the cache */
+    uint64_t            fetched;         /**< Answered by the server */
+    uint64_t            errors;          /**< Failed calls */
+    uint64_t            negative_served; /**< Errors answered from cache */
+    LatencyHistogram    cached_latency;  /**< Calls answered from cache */
+    LatencyHistogram    network_latency; /**< Calls that went to the server */
+    ClientCacheStats    cache;           /**< Cache occupancy and limits */
+    ClientCacheCounters counters;        /**< Cache activity */
+} WeatherClientStats;
+
 /**
  * @brief Creates a new weather client instance
  *
@@ -48,10 +75,11 @@ typedef struct WeatherClient WeatherClient;
  * configuration. The client includes an HTTP client for network communication
  * and a cache for storing responses. Default timeout is 5000ms (5 seconds).
  *
- * @param host The weather API server hostname or IP address.
- *             If NULL, defaults to "localhost".
+ * @param host The weather API server hostname or IP address, or
+ *             "unix:/path/to.sock" to talk HTTP over a local Unix domain
+ *             socket. If NULL, defaults to "localhost".
  * @param port The weather API server port number.
- *             If <= 0, defaults to 10680.
+ *             If <= 0, defaults to 10680. Ignored for Unix sockets.
  *
  * @return Pointer to the newly created WeatherClient structure, or NULL if
  *         memory allocation fails or initialization of HTTP client or cache
@@ -330,6 +358,33 @@ json_t* weather_client_echo(WeatherClient* client, char** error);
  */
 
 void weather_client_clear_cache(WeatherClient* client);
+
+/**
+ * @brief Drops the cached responses whose cache key starts with prefix
+ *
+ * Cache keys are the backend ("host:port" or "unix:/path") and '|',
+ * followed by the endpoint name and the request parameters, e.g.
+ * "localhost:10680|cities:query=stockholm". The prefix is matched against
+ * the part after the backend, and only this client's backend is affected:
+ * "cities:" drops every city search and keeps the forecasts, and
+ * "weather:city=Stockholm" drops the forecasts of one city. Other
+ * processes sharing the cache directory see the change as well.
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param prefix Request key prefix; "" drops every response of the backend
+ *
+ * @return Number of in-memory entries dropped, or -1 on error (also if the
+ *         client has no cache)
+ *
+ * @see client_cache_invalidate_prefix()
+ *
+ * @par Example:
+ * @code
+ * // Coordinates of a renamed city: forget the searches only
+ * weather_client_invalidate_cache(client, "cities:");
+ * @endcode
+ */
+int weather_client_invalidate_cache(WeatherClient* client, const char* prefix);
 /**
  * @brief Sets the network timeout for API requests
  *
@@ -353,4 +408,181 @@ void weather_client_clear_cache(WeatherClient* client);
  */
 void weather_client_set_timeout(WeatherClient* client, int timeout_ms);
 
+/**
+ * @brief Sets how long failed and empty lookups are cached
+ *
+ * Responses the server rejected (success:false with a 2xx or 4xx status,
+ * e.g. an unknown city) and successful responses with an empty "data"
+ * array are stored under the same key as a positive answer, but with this
+ * TTL instead of the endpoint's. Until it expires, repeating the lookup
+ * returns the same error or empty result without contacting the server.
+ * Server errors (5xx) and network failures are never cached.
+ *
+ * @param client Pointer to the WeatherClient structure (safe to pass NULL)
+ * @param ttl TTL in seconds (default TTL_NEGATIVE), 0 to disable
+ */
+void weather_client_set_negative_ttl(WeatherClient* client, time_t ttl);
+
+/**
+ * @brief Replaces the network transport used by the client
+ *
+ * Hands the transport to the underlying HttpClient, which takes ownership.
+ * Plugging in the loopback transport (transport_loopback.h) lets the whole
+ * request path - HTTP parsing, caching and JSON handling - be benchmarked
+ * and profiled without real sockets.
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param transport New transport (ownership transferred on success)
+ *
+ * @return 0 on success, -1 if client or transport is NULL
+ *
+ * @see http_client_set_transport()
+ *
+ * @par Example:
+ * @code
+ * Transport *loop = transport_loopback_create(canned, canned_len);
+ * weather_client_set_transport(client, loop);
+ * json_t *weather = weather_client_get_current(client, 59.33, 18.07, NULL);
+ * @endcode
+ */
+int weather_client_set_transport(WeatherClient* client, Transport* transport);
+
+/**
+ * @brief Enables or disables per-backend TCP connection telemetry
+ *
+ * See http_client_set_telemetry(). Disabled by default, in which case no
+ * extra system call is made per request.
+ *
+ * @param client Pointer to the WeatherClient structure (safe to pass NULL)
+ * @param enabled Non-zero to sample TCP_INFO after every exchange
+ */
+void weather_client_set_telemetry(WeatherClient* client, int enabled);
+
+/**
+ * @brief Selects the response cache eviction policy
+ *
+ * Clients start with CLIENT_CACHE_POLICY_TINYLFU, which keeps the
+ * frequently requested cities cached while one-off coordinate lookups pass
+ * through the admission window. See client_cache_set_policy().
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param policy Policy to use for subsequent requests
+ *
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ */
+int weather_client_set_cache_policy(WeatherClient*    client,
+                                    ClientCachePolicy policy);
+
+/**
+ * @brief Selects where cached responses are persisted
+ *
+ * Clients start with CLIENT_CACHE_STORE_LOG (one append-only log plus an
+ * index) and fall back to one file per response if the log cannot be
+ * opened. See client_cache_set_store().
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param store Store to use for subsequent requests
+ *
+ * @return 0 on success, -1 on invalid arguments or if the store cannot be
+ *         opened
+ */
+int weather_client_set_cache_store(WeatherClient*   client,
+                                   ClientCacheStore store);
+
+/**
+ * @brief Selects when cached responses are written to disk
+ *
+ * Clients start with CLIENT_CACHE_WRITE_BEHIND, so a response is handed
+ * back as soon as it is parsed and a background thread persists it;
+ * weather_client_destroy() waits for pending writes. See
+ * client_cache_set_write_mode().
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param mode Write mode to use for subsequent requests
+ *
+ * @return 0 on success, -1 on invalid arguments or if the flusher thread
+ *         cannot be started
+ */
+int weather_client_set_cache_write_mode(WeatherClient*       client,
+                                        ClientCacheWriteMode mode);
+
+/**
+ * @brief Attaches to or detaches from the host-wide shared cache segment
+ *
+ * Clients start attached, so short-lived invocations reuse responses
+ * fetched by earlier ones without touching the disk. See
+ * client_cache_set_shared().
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param enabled Non-zero to attach, zero to detach
+ *
+ * @return 0 on success, -1 on invalid arguments or if the segment cannot
+ *         be attached
+ */
+int weather_client_set_shared_cache(WeatherClient* client, int enabled);
+
+/**
+ * @brief Selects how cache file names are derived from keys
+ *
+ * Only matters for the files store. See client_cache_set_key_hash().
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param key_hash CLIENT_CACHE_KEY_HASH_FAST (default) or
+ *                 CLIENT_CACHE_KEY_HASH_MD5
+ *
+ * @return 0 on success, -1 on invalid arguments
+ */
+int weather_client_set_cache_key_hash(WeatherClient*     client,
+                                      ClientCacheKeyHash key_hash);
+
+/**
+ * @brief Moves the response cache to another directory
+ *
+ * See client_cache_set_directory(). Without this the cache lives in
+ * $JUST_WEATHER_CACHE_DIR or the XDG user cache directory.
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param dir Cache directory (created if needed)
+ *
+ * @return 0 on success, -1 on invalid arguments or if the directory
+ *         cannot be used
+ */
+int weather_client_set_cache_dir(WeatherClient* client, const char* dir);
+
+/**
+ * @brief Returns the aggregated TCP telemetry per backend
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param count Output: number of entries in the returned array
+ *
+ * @return Array owned by the client, or NULL if nothing was sampled
+ *
+ * @see http_client_get_backend_stats()
+ */
+const HttpBackendStats* weather_client_get_backend_stats(WeatherClient* client,
+                                                         size_t*        count);
+
+/**
+ * @brief Collects request counters, latencies and cache statistics
+ *
+ * Statistics cover this client only, from its creation on; a one-shot CLI
+ * run therefore sees just its own request.
+ *
+ * @param client Pointer to the WeatherClient structure
+ * @param stats Output
+ *
+ * @return 0 on success, -1 on invalid arguments
+ *
+ * @par Example:
+ * @code
+ * WeatherClientStats stats;
+ * if (weather_client_get_stats(client, &stats) == 0) {
+ *     printf("%llu of %llu requests served from cache\n",
+ *            (unsigned long long)stats.cache_served,
+ *            (unsigned long long)stats.requests);
+ * }
+ * @endcode
+ */
+int weather_client_get_stats(WeatherClient* client, WeatherClientStats* stats);
+
 #endif
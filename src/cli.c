@@ -11,6 +11,9 @@
  */
 #include "cli.h"
 
+#include "network/client_tcp.h"
+#include "network/transport_netem.h"
+
 #include <jansson.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,15 +36,524 @@ void cli_print_usage(const char* prog_name) {
     printf("  %s homepage\n", prog_name);
     printf("  %s echo\n", prog_name);
     printf("  %s clear-cache\n", prog_name);
+    printf("  %s cache-invalidate <prefix>  # e.g. cities:\n", prog_name);
+    printf("  %s net-stats      # TCP telemetry (with --telemetry)\n",
+           prog_name);
+    printf("  %s cache-stats [--json]\n", prog_name);
     printf("  %s interactive    # Enter interactive mode\n", prog_name);
+    printf("\nOptions (before the command):\n");
+    printf("  --server <host|unix:/path>   Backend address (default "
+           "localhost)\n");
+    printf("  --port <port>                Backend TCP port (default "
+           "10680)\n");
+    printf("  --netem <spec>               Emulate a bad link, e.g. "
+           "latency=80,jitter=20,drop=0.05,seed=1\n");
+    printf("  --telemetry                  Sample TCP_INFO per request and "
+           "print net-stats on exit\n");
+    printf("  --cache-stats                Print cache-stats to stderr on "
+           "exit\n");
+    printf("  --cache-policy <lru|tinylfu> Cache eviction policy (default "
+           "tinylfu)\n");
+    printf("  --cache-store <files|log>    Cache disk store (default log)\n");
+    printf("  --cache-write <through|behind|durable>\n"
+           "                               Cache disk writes (default "
+           "behind)\n");
+    printf("  --cache-shm <on|off>         Share cached responses between "
+           "processes (default on)\n");
+    printf("  --cache-key-hash <fast|md5>  Cache file naming (files store "
+           "only)\n");
+    printf("  --cache-dir <path>           Cache directory (default "
+           "$JUST_WEATHER_CACHE_DIR,\n"
+           "                               else "
+           "$XDG_CACHE_HOME/just-weather-client)\n");
     printf("\nExamples:\n");
     printf("  %s current 59.33 18.07\n", prog_name);
     printf("  %s weather Stockholm SE\n", prog_name);
     printf("  %s cities Stock\n", prog_name);
     printf("  %s interactive\n", prog_name);
+    printf("  %s --server unix:/run/just-weather.sock echo\n", prog_name);
+}
+
+int cli_parse_options(int argc, char* argv[], CliOptions* options) {
+    if (!options) {
+        return -1;
+    }
+
+    options->server_host  = "localhost";
+    options->server_port  = 10680;
+    options->netem        = NULL;
+    options->telemetry    = 0;
+    options->cache_stats  = 0;
+    options->cache_policy = NULL;
+    options->cache_store  = NULL;
+    options->cache_write  = NULL;
+    options->cache_shm    = NULL;
+    options->cache_hash   = NULL;
+    options->cache_dir    = NULL;
+
+    int index = 1;
+    while (index < argc && strncmp(argv[index], "--", 2) == 0) {
+        const char* name = argv[index];
+
+        if (strcmp(name, "--telemetry") == 0) {
+            options->telemetry = 1;
+            index++;
+            continue;
+        }
+
+        if (strcmp(name, "--cache-stats") == 0) {
+            options->cache_stats = 1;
+            index++;
+            continue;
+        }
+
+        if (strcmp(name, "--server") != 0 && strcmp(name, "--port") != 0 &&
+            strcmp(name, "--netem") != 0 &&
+            strcmp(name, "--cache-policy") != 0 &&
+            strcmp(name, "--cache-store") != 0 &&
+            strcmp(name, "--cache-write") != 0 &&
+            strcmp(name, "--cache-shm") != 0 &&
+            strcmp(name, "--cache-key-hash") != 0 &&
+            strcmp(name, "--cache-dir") != 0) {
+            break;
+        }
+
+        if (index + 1 >= argc) {
+            fprintf(stderr, "Option %s requires a value\n", name);
+            return -1;
+        }
+
+        const char* value = argv[index + 1];
+        if (strcmp(name, "--server") == 0) {
+            options->server_host = value;
+        } else if (strcmp(name, "--netem") == 0) {
+            options->netem = value;
+        } else if (strcmp(name, "--cache-policy") == 0) {
+            if (strcmp(value, "lru") != 0 && strcmp(value, "tinylfu") != 0) {
+                fprintf(stderr, "Invalid cache policy: %s\n", value);
+                return -1;
+            }
+            options->cache_policy = value;
+        } else if (strcmp(name, "--cache-store") == 0) {
+            if (strcmp(value, "files") != 0 && strcmp(value, "log") != 0) {
+                fprintf(stderr, "Invalid cache store: %s\n", value);
+                return -1;
+            }
+            options->cache_store = value;
+        } else if (strcmp(name, "--cache-write") == 0) {
+            if (strcmp(value, "through") != 0 &&
+                strcmp(value, "behind") != 0 &&
+                strcmp(value, "durable") != 0) {
+                fprintf(stderr, "Invalid cache write mode: %s\n", value);
+                return -1;
+            }
+            options->cache_write = value;
+        } else if (strcmp(name, "--cache-shm") == 0) {
+            if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0) {
+                fprintf(stderr, "Invalid cache-shm value: %s\n", value);
+                return -1;
+            }
+            options->cache_shm = value;
+        } else if (strcmp(name, "--cache-key-hash") == 0) {
+            if (strcmp(value, "fast") != 0 && strcmp(value, "md5") != 0) {
+                fprintf(stderr, "Invalid cache key hash: %s\n", value);
+                return -1;
+            }
+            options->cache_hash = value;
+        } else if (strcmp(name, "--cache-dir") == 0) {
+            options->cache_dir = value;
+        } else {
+            char* endptr;
+            long  port = strtol(value, &endptr, 10);
+            if (endptr == value || *endptr != '\0' || port <= 0 ||
+                port > 65535) {
+                fprintf(stderr, "Invalid port: %s\n", value);
+                return -1;
+            }
+            options->server_port = (int)port;
+        }
+
+        index += 2;
+    }
+
+    return index;
+}
+
+int cli_apply_options(WeatherClient* client, const CliOptions* options) {
+    if (!client || !options) {
+        return -1;
+    }
+
+    if (options->netem) {
+        NetemConfig config;
+        if (transport_netem_parse(options->netem, &config) != 0) {
+            fprintf(stderr, "Invalid --netem specification: %s\n",
+                    options->netem);
+            return -1;
+        }
+
+        Transport* transport =
+            transport_netem_create(transport_tcp_create(), &config);
+        if (!transport || weather_client_set_transport(client, transport)) {
+            transport_destroy(transport);
+            fprintf(stderr, "Failed to set up network emulation\n");
+            return -1;
+        }
+    }
+
+    weather_client_set_telemetry(client, options->telemetry);
+
+    /* First: the other cache options act on the directory's stores */
+    if (options->cache_dir &&
+        weather_client_set_cache_dir(client, options->cache_dir) != 0) {
+        fprintf(stderr, "Cannot use cache directory: %s\n",
+                options->cache_dir);
+        return -1;
+    }
+
+    if (options->cache_policy) {
+        ClientCachePolicy policy = strcmp(options->cache_policy, "lru") == 0
+                                       ? CLIENT_CACHE_POLICY_LRU
+                                       : CLIENT_CACHE_POLICY_TINYLFU;
+        if (weather_client_set_cache_policy(client, policy) != 0) {
+            fprintf(stderr, "Failed to set cache policy\n");
+            return -1;
+        }
+    }
+
+    if (options->cache_store) {
+        ClientCacheStore store = strcmp(options->cache_store, "files") == 0
+                                     ? CLIENT_CACHE_STORE_FILES
+                                     : CLIENT_CACHE_STORE_LOG;
+        if (weather_client_set_cache_store(client, store) != 0) {
+            fprintf(stderr, "Failed to set cache store\n");
+            return -1;
+        }
+    }
+
+    if (options->cache_write) {
+        ClientCacheWriteMode mode = CLIENT_CACHE_WRITE_BEHIND;
+        if (strcmp(options->cache_write, "through") == 0) {
+            mode = CLIENT_CACHE_WRITE_THROUGH;
+        } else if (strcmp(options->cache_write, "durable") == 0) {
+            mode = CLIENT_CACHE_WRITE_DURABLE;
+        }
+        if (weather_client_set_cache_write_mode(client, mode) != 0) {
+            fprintf(stderr, "Failed to set cache write mode\n");
+            return -1;
+        }
+    }
+
+    if (options->cache_shm &&
+        weather_client_set_shared_cache(
+            client, strcmp(options->cache_shm, "on") == 0) != 0) {
+        fprintf(stderr, "Failed to attach the shared cache\n");
+        return -1;
+    }
+
+    if (options->cache_hash) {
+        ClientCacheKeyHash key_hash = strcmp(options->cache_hash, "md5") == 0
+                                          ? CLIENT_CACHE_KEY_HASH_MD5
+                                          : CLIENT_CACHE_KEY_HASH_FAST;
+        if (weather_client_set_cache_key_hash(client, key_hash) != 0) {
+            fprintf(stderr, "Failed to set cache key hash\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void cli_print_net_stats(WeatherClient* client, FILE* out) {
+    size_t                  count = 0;
+    const HttpBackendStats* stats =
+        weather_client_get_backend_stats(client, &count);
+
+    json_t* backends = json_array();
+    for (size_t i = 0; i < count; i++) {
+        json_t* entry = json_object();
+        json_object_set_new(entry, "backend", json_string(stats[i].backend));
+        json_object_set_new(entry, "samples", json_integer(stats[i].samples));
+        json_object_set_new(entry, "rtt_us_last",
+                            json_integer(stats[i].rtt_us_last));
+        json_object_set_new(entry, "rtt_us_min",
+                            json_integer(stats[i].rtt_us_min));
+        json_object_set_new(entry, "rtt_us_max",
+                            json_integer(stats[i].rtt_us_max));
+        json_object_set_new(
+            entry, "rtt_us_avg",
+            json_integer(stats[i].samples
+                             ? stats[i].rtt_us_sum / stats[i].samples
+                             : 0));
+        json_object_set_new(entry, "rtt_var_us_last",
+                            json_integer(stats[i].rtt_var_us_last));
+        json_object_set_new(entry, "snd_cwnd_last",
+                            json_integer(stats[i].snd_cwnd_last));
+        json_object_set_new(entry, "snd_cwnd_min",
+                            json_integer(stats[i].snd_cwnd_min));
+        json_object_set_new(entry, "retransmits",
+                            json_integer(stats[i].retransmits));
+        json_array_append_new(backends, entry);
+    }
+
+    json_t* result = json_object();
+    json_object_set_new(result, "backends", backends);
+
+    char* json_str = json_dumps(result, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    if (json_str) {
+        fprintf(out, "%s\n", json_str);
+        free(json_str);
+    }
+    json_decref(result);
+}
+
+static json_t* latency_json(const LatencyHistogram* histogram) {
+    json_t* result = json_object();
+    json_object_set_new(result, "count", json_integer(histogram->count));
+    json_object_set_new(result, "mean",
+                        json_integer(latency_histogram_mean(histogram)));
+    json_object_set_new(
+        result, "p50",
+        json_integer(latency_histogram_percentile(histogram, 50.0)));
+    json_object_set_new(
+        result, "p90",
+        json_integer(latency_histogram_percentile(histogram, 90.0)));
+    json_object_set_new(
+        result, "p99",
+        json_integer(latency_histogram_percentile(histogram, 99.0)));
+    json_object_set_new(result, "max", json_integer(histogram->max_ns));
+
+    /* Non-empty buckets as upper bound -> count, for external tooling */
+    json_t* buckets = json_array();
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        if (histogram->buckets[i]) {
+            json_t* bucket = json_object();
+            json_object_set_new(bucket, "le", json_integer((2ULL << i) - 1));
+            json_object_set_new(bucket, "count",
+                                json_integer(histogram->buckets[i]));
+            json_array_append_new(buckets, bucket);
+        }
+    }
+    json_object_set_new(result, "buckets", buckets);
+    return result;
 }
 
-void cli_interactive_mode() {
+/* Cache settings that only the files store acts on */
+static const char* const FILES_STORE_ONLY[] = {
+    "key_hash",
+    "shard_dirs",
+    "bloom_filter",
+};
+
+#define FILES_STORE_ONLY_COUNT                                                 \
+    (sizeof(FILES_STORE_ONLY) / sizeof(FILES_STORE_ONLY[0]))
+
+static void print_cache_stats_json(const WeatherClientStats* stats,
+                                   FILE*                     out) {
+    const ClientCacheCounters* counters = &stats->counters;
+
+    json_t* requests = json_object();
+    json_object_set_new(requests, "total", json_integer(stats->requests));
+    json_object_set_new(requests, "cache_served",
+                        json_integer(stats->cache_served));
+    json_object_set_new(requests, "fetched", json_integer(stats->fetched));
+    json_object_set_new(requests, "errors", json_integer(stats->errors));
+    json_object_set_new(requests, "negative_served",
+                        json_integer(stats->negative_served));
+
+    /* Under the log store, the files store settings have no effect */
+    int     log_store = stats->cache.store == CLIENT_CACHE_STORE_LOG;
+    json_t* inactive  = json_array();
+    for (size_t i = 0; log_store && i < FILES_STORE_ONLY_COUNT; i++) {
+        json_array_append_new(inactive, json_string(FILES_STORE_ONLY[i]));
+    }
+
+    json_t* cache = json_object();
+    json_object_set_new(cache, "store",
+                        json_string(log_store ? "log" : "files"));
+    json_object_set_new(cache, "inactive_settings", inactive);
+    json_object_set_new(cache, "entries", json_integer(stats->cache.entries));
+    json_object_set_new(cache, "max_entries",
+                        json_integer(stats->cache.max_entries));
+    json_object_set_new(cache, "bytes", json_integer(stats->cache.bytes));
+    json_object_set_new(cache, "max_bytes",
+                        json_integer(stats->cache.max_bytes));
+    json_object_set_new(cache, "disk_bytes",
+                        json_integer(stats->cache.disk_bytes));
+    json_object_set_new(cache, "max_disk_bytes",
+                        json_integer(stats->cache.max_disk_bytes));
+    json_object_set_new(cache, "shared_entries",
+                        json_integer(stats->cache.shared_entries));
+    json_object_set_new(cache, "shared_bytes",
+                        json_integer(stats->cache.shared_bytes));
+    json_object_set_new(cache, "shared_max_bytes",
+                        json_integer(stats->cache.shared_max_bytes));
+    json_object_set_new(cache, "heap_reserved_bytes",
+                        json_integer(stats->cache.heap_reserved_bytes));
+    json_object_set_new(cache, "heap_used_bytes",
+                        json_integer(stats->cache.heap_used_bytes));
+    json_object_set_new(cache, "heap_allocations",
+                        json_integer(stats->cache.heap_allocations));
+    json_object_set_new(cache, "lookups", json_integer(counters->lookups));
+    json_object_set_new(cache, "memory_hits",
+                        json_integer(counters->memory_hits));
+    json_object_set_new(cache, "shared_hits",
+                        json_integer(counters->shared_hits));
+    json_object_set_new(cache, "disk_hits", json_integer(counters->disk_hits));
+    json_object_set_new(cache, "misses", json_integer(counters->misses));
+    json_object_set_new(cache, "expirations",
+                        json_integer(counters->expirations));
+    json_object_set_new(cache, "evictions", json_integer(counters->evictions));
+    json_object_set_new(cache, "stores", json_integer(counters->stores));
+    json_object_set_new(cache, "store_failures",
+                        json_integer(counters->store_failures));
+    json_object_set_new(cache, "disk_reads",
+                        json_integer(counters->disk_reads));
+    json_object_set_new(cache, "disk_writes",
+                        json_integer(counters->disk_writes));
+    json_object_set_new(cache, "disk_write_errors",
+                        json_integer(counters->disk_write_errors));
+    json_object_set_new(cache, "gc_removed",
+                        json_integer(counters->gc_removed));
+    json_object_set_new(cache, "promotions",
+                        json_integer(counters->promotions));
+    json_object_set_new(cache, "demotions",
+                        json_integer(counters->demotions));
+    json_object_set_new(cache, "filter_skips",
+                        json_integer(counters->filter_skips));
+
+    json_t* latency = json_object();
+    json_object_set_new(latency, "request_cached",
+                        latency_json(&stats->cached_latency));
+    json_object_set_new(latency, "request_network",
+                        latency_json(&stats->network_latency));
+    json_object_set_new(latency, "lookup", latency_json(&counters->lookup));
+    json_object_set_new(latency, "store", latency_json(&counters->store));
+    json_object_set_new(latency, "disk_read",
+                        latency_json(&counters->disk_read));
+    json_object_set_new(latency, "disk_write",
+                        latency_json(&counters->disk_write));
+
+    json_t* result = json_object();
+    json_object_set_new(result, "requests", requests);
+    json_object_set_new(result, "cache", cache);
+    json_object_set_new(result, "latency_ns", latency);
+
+    char* json_str = json_dumps(result, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    if (json_str) {
+        fprintf(out, "%s\n", json_str);
+        free(json_str);
+    }
+    json_decref(result);
+}
+
+static void print_latency_row(FILE* out, const char* name,
+                              const LatencyHistogram* histogram) {
+    fprintf(out, "  %-16s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+            (unsigned long long)histogram->count,
+            latency_histogram_mean(histogram) / 1000.0,
+            latency_histogram_percentile(histogram, 50.0) / 1000.0,
+            latency_histogram_percentile(histogram, 90.0) / 1000.0,
+            latency_histogram_percentile(histogram, 99.0) / 1000.0,
+            histogram->max_ns / 1000.0);
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+static void print_cache_stats_text(const WeatherClientStats* stats,
+                                   FILE*                     out) {
+    const ClientCacheCounters* counters = &stats->counters;
+
+    uint64_t hits = counters->memory_hits + counters->shared_hits +
+                    counters->disk_hits;
+
+    fprintf(out, "Requests:    %llu (%llu from cache, %llu fetched, %llu "
+                 "failed)\n",
+            (unsigned long long)stats->requests,
+            (unsigned long long)stats->cache_served,
+            (unsigned long long)stats->fetched,
+            (unsigned long long)stats->errors);
+    fprintf(out, "Negative:    %llu errors answered from cache\n",
+            (unsigned long long)stats->negative_served);
+    if (stats->cache.store == CLIENT_CACHE_STORE_LOG) {
+        fprintf(out, "Store:       log (inactive, files store only:");
+        for (size_t i = 0; i < FILES_STORE_ONLY_COUNT; i++) {
+            fprintf(out, "%s %s", i ? "," : "", FILES_STORE_ONLY[i]);
+        }
+        fprintf(out, ")\n");
+    } else {
+        fprintf(out, "Store:       files\n");
+    }
+    fprintf(out, "Hot:         %zu of %zu entries, %zu of %zu bytes\n",
+            stats->cache.entries, stats->cache.max_entries,
+            stats->cache.bytes, stats->cache.max_bytes);
+    fprintf(out, "Heap:        %zu of %zu slab bytes in use, %llu mallocs "
+                 "for %llu stores\n",
+            stats->cache.heap_used_bytes, stats->cache.heap_reserved_bytes,
+            (unsigned long long)stats->cache.heap_allocations,
+            (unsigned long long)counters->stores);
+    fprintf(out, "Warm:        %zu records, %zu of %zu bytes (shared)\n",
+            stats->cache.shared_entries, stats->cache.shared_bytes,
+            stats->cache.shared_max_bytes);
+    fprintf(out, "Cold:        %zu of %zu bytes (of hot entries)\n",
+            stats->cache.disk_bytes, stats->cache.max_disk_bytes);
+    fprintf(out, "Moves:       %llu promoted, %llu demoted\n",
+            (unsigned long long)counters->promotions,
+            (unsigned long long)counters->demotions);
+    fprintf(out, "Lookups:     %llu, hit ratio %.1f%%\n",
+            (unsigned long long)counters->lookups,
+            percent(hits, counters->lookups));
+    fprintf(out, "  hot        %llu\n",
+            (unsigned long long)counters->memory_hits);
+    fprintf(out, "  warm       %llu\n",
+            (unsigned long long)counters->shared_hits);
+    fprintf(out, "  cold       %llu\n",
+            (unsigned long long)counters->disk_hits);
+    fprintf(out, "  miss       %llu\n", (unsigned long long)counters->misses);
+    fprintf(out, "Expirations: %llu\n",
+            (unsigned long long)counters->expirations);
+    fprintf(out, "Evictions:   %llu (disk budget)\n",
+            (unsigned long long)counters->evictions);
+    fprintf(out, "Stores:      %llu (%llu refused)\n",
+            (unsigned long long)counters->stores,
+            (unsigned long long)counters->store_failures);
+    fprintf(out,
+            "Disk I/O:    %llu reads (%llu skipped by filter), %llu writes "
+            "(%llu failed)\n",
+            (unsigned long long)counters->disk_reads,
+            (unsigned long long)counters->filter_skips,
+            (unsigned long long)counters->disk_writes,
+            (unsigned long long)counters->disk_write_errors);
+    fprintf(out, "Disk GC:     %llu removed\n",
+            (unsigned long long)counters->gc_removed);
+
+    fprintf(out, "\nLatency (us)        count       mean        p50        p90"
+                 "        p99        max\n");
+    print_latency_row(out, "request cached", &stats->cached_latency);
+    print_latency_row(out, "request network", &stats->network_latency);
+    print_latency_row(out, "lookup", &counters->lookup);
+    print_latency_row(out, "store", &counters->store);
+    print_latency_row(out, "disk read", &counters->disk_read);
+    print_latency_row(out, "disk write", &counters->disk_write);
+}
+
+void cli_print_cache_stats(WeatherClient* client, FILE* out, int json) {
+    WeatherClientStats stats;
+    if (weather_client_get_stats(client, &stats) != 0) {
+        fprintf(stderr, "Cache statistics unavailable\n");
+        return;
+    }
+
+    if (json) {
+        print_cache_stats_json(&stats, out);
+    } else {
+        print_cache_stats_text(&stats, out);
+    }
+}
+
+void cli_interactive_mode(const CliOptions* options) {
     // Initialize WeatherClient
     char server_address[256];
     int  server_port;
@@ -52,15 +564,25 @@ void cli_interactive_mode() {
         fprintf(stderr, "invalid server address input\n");
         return;
     }
-    printf("Server port:\n");
-    ref = scanf("%d", &server_port);
-    if (ref != 1) {
-        fprintf(stderr, "invalid server port input\n");
-        return;
+    if (strncmp(server_address, CLIENT_TCP_UNIX_PREFIX,
+                strlen(CLIENT_TCP_UNIX_PREFIX)) == 0) {
+        server_port = 0;
+    } else {
+        printf("Server port:\n");
+        ref = scanf("%d", &server_port);
+        if (ref != 1) {
+            fprintf(stderr, "invalid server port input\n");
+            return;
+        }
     }
     WeatherClient* client = weather_client_create(server_address, server_port);
     if (!client) {
         fprintf(stderr, "Failed to create weather client\n");
+        return;
+    }
+    if (options && cli_apply_options(client, options) != 0) {
+        weather_client_destroy(client);
+        return;
     }
     char* error = NULL;
 
@@ -69,12 +591,18 @@ void cli_interactive_mode() {
     if (!result) {
         fprintf(stderr, "Error: %s\n", error ? error : "Unknown error");
         free(error);
+        weather_client_destroy(client);
         return;
     }
+    json_decref(result);
     char line[1024];
 
     printf("Just Weather Interactive Client\n");
-    printf("Connected to: localhost:10680\n");
+    if (server_port > 0) {
+        printf("Connected to: %s:%d\n", server_address, server_port);
+    } else {
+        printf("Connected to: %s\n", server_address);
+    }
     printf("Type 'help' for commands, 'quit' to exit\n\n");
 
     while (1) {
@@ -110,6 +638,14 @@ void cli_interactive_mode() {
             printf("  homepage                        - Get API homepage\n");
             printf("  echo                            - Test echo endpoint\n");
             printf("  clear-cache                     - Clear client cache\n");
+            printf("  cache-invalidate <prefix>       - Drop cached keys under "
+                   "a prefix\n");
+            printf("  net-stats                       - TCP telemetry per "
+                   "backend\n");
+            printf("  cache-stats [--json]            - Cache counters and "
+                   "latencies\n");
+            printf("  telemetry on|off                - Toggle TCP "
+                   "telemetry\n");
             printf("  help                            - Show this help\n");
             printf("  quit / exit                     - Exit interactive "
                    "mode\n\n");
@@ -122,6 +658,9 @@ void cli_interactive_mode() {
 
         process_command(client, line);
     }
+
+    // Flushes pending write-behind stores and detaches the shared segment
+    weather_client_destroy(client);
 }
 
 int cli_execute_command(WeatherClient* client, int argc, char* argv[]) {
@@ -181,6 +720,31 @@ int cli_execute_command(WeatherClient* client, int argc, char* argv[]) {
         printf("Cache cleared\n");
         return 0;
 
+    } else if (strcmp(command, "cache-invalidate") == 0) {
+        if (argc < 3 || argv[2][0] == '\0') {
+            fprintf(stderr, "Usage: %s cache-invalidate <prefix>\n", argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        if (weather_client_invalidate_cache(client, argv[2]) < 0) {
+            fprintf(stderr, "Error: Could not invalidate '%s'\n", argv[2]);
+            return EXIT_INVALID_ARGS;
+        }
+        printf("Cache entries under '%s' invalidated\n", argv[2]);
+        return 0;
+
+    } else if (strcmp(command, "net-stats") == 0) {
+        cli_print_net_stats(client, stdout);
+        return 0;
+
+    } else if (strcmp(command, "cache-stats") == 0) {
+        int json = argc > 2 && strcmp(argv[2], "--json") == 0;
+        if (argc > 2 && !json) {
+            fprintf(stderr, "Usage: %s cache-stats [--json]\n", argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        cli_print_cache_stats(client, stdout, json);
+        return 0;
+
     } else if (strcmp(command, "interactive") == 0 ||
                strcmp(command, "-i") == 0) {
         return -1;
@@ -290,6 +854,44 @@ static void process_command(WeatherClient* client, char* line) {
         printf("Cache cleared\n");
         return;
 
+    } else if (strcmp(cmd, "cache-invalidate") == 0) {
+        char* prefix = strtok(NULL, " ");
+        if (!prefix) {
+            printf("Error: Usage: cache-invalidate <prefix>\n");
+            return;
+        }
+        int removed = weather_client_invalidate_cache(client, prefix);
+        if (removed < 0) {
+            printf("Error: Could not invalidate '%s'\n", prefix);
+            return;
+        }
+        printf("Cache entries under '%s' invalidated (%d in memory)\n",
+               prefix, removed);
+        return;
+
+    } else if (strcmp(cmd, "net-stats") == 0) {
+        cli_print_net_stats(client, stdout);
+        return;
+
+    } else if (strcmp(cmd, "cache-stats") == 0) {
+        char* format = strtok(NULL, " ");
+        if (format && strcmp(format, "--json") != 0) {
+            printf("Error: Usage: cache-stats [--json]\n");
+            return;
+        }
+        cli_print_cache_stats(client, stdout, format != NULL);
+        return;
+
+    } else if (strcmp(cmd, "telemetry") == 0) {
+        char* mode = strtok(NULL, " ");
+        if (!mode || (strcmp(mode, "on") != 0 && strcmp(mode, "off") != 0)) {
+            printf("Error: Usage: telemetry on|off\n");
+            return;
+        }
+        weather_client_set_telemetry(client, strcmp(mode, "on") == 0);
+        printf("Telemetry %s\n", mode);
+        return;
+
     } else {
         printf("Error: Unknown command '%s'. Type 'help' for available "
                "commands.\n",
@@ -14,6 +14,8 @@
  * - homepage - Get API homepage
  * - echo - Test server connectivity
  * - clear-cache - Clear response cache
+ * - net-stats - Show per-backend TCP telemetry
+ * - cache-stats - Show cache counters and latency histograms
  * - interactive - Enter interactive mode
  *
  * Exit codes:
@@ -27,6 +29,100 @@
 
 #include "api/weather_client.h"
 
+#include <stdio.h>
+
+/**
+ * @struct CliOptions
+ * @brief Global options given before the command
+ *
+ * Filled in by cli_parse_options() from leading "--name value" arguments.
+ */
+typedef struct {
+    const char* server_host;  /**< Hostname, IP or "unix:/path/to.sock" */
+    int         server_port;  /**< TCP port (ignored for Unix sockets) */
+    const char* netem;        /**< Network emulation spec, or NULL */
+    int         telemetry;    /**< Sample TCP_INFO per request */
+    int         cache_stats;  /**< Print cache-stats to stderr on exit */
+    const char* cache_policy; /**< "lru" or "tinylfu", or NULL for default */
+    const char* cache_store;  /**< "files" or "log", or NULL for default */
+    const char* cache_write;  /**< "through", "behind", "durable" or NULL */
+    const char* cache_shm;    /**< "on" or "off", or NULL for default */
+    const char* cache_hash;   /**< "fast" or "md5", or NULL for default */
+    const char* cache_dir;    /**< Cache directory, or NULL for default */
+} CliOptions;
+
+/**
+ * @brief Parses global options preceding the command
+ *
+ * Recognised options:
+ * - --server \<host|unix:/path\> - Backend address (default "localhost")
+ * - --port \<port\> - Backend TCP port (default 10680)
+ * - --netem \<spec\> - Emulate a bad link, see transport_netem_parse()
+ * - --telemetry - Sample TCP_INFO per request (see net-stats)
+ * - --cache-stats - Print the cache statistics to stderr on exit
+ * - --cache-policy \<lru|tinylfu\> - Response cache eviction policy
+ *
+ * Parsing stops at the first argument that is not a recognised option,
+ * which is taken to be the command.
+ *
+ * @param argc Argument count (from main)
+ * @param argv Argument vector (from main)
+ * @param options Output structure, reset to defaults before parsing
+ *
+ * @return Index of the command in argv, or -1 if an option is missing its
+ *         value or has an invalid value
+ *
+ * @par Example:
+ * @code
+ * // ./just-weather-client --server unix:/run/weather.sock current 59.33 18.07
+ * CliOptions options;
+ * int first = cli_parse_options(argc, argv, &options);  // first == 3
+ * @endcode
+ */
+int cli_parse_options(int argc, char* argv[], CliOptions* options);
+
+/**
+ * @brief Applies the parsed options to a freshly created client
+ *
+ * Installs the network emulation transport when --netem was given,
+ * enables TCP telemetry when --telemetry was given and selects the cache
+ * policy when --cache-policy was given.
+ *
+ * @param client Client created from the same options
+ * @param options Parsed options
+ *
+ * @return 0 on success, -1 if an option could not be applied (an error
+ *         message has been printed to stderr)
+ */
+int cli_apply_options(WeatherClient* client, const CliOptions* options);
+
+/**
+ * @brief Prints the per-backend TCP telemetry as JSON
+ *
+ * Output has the form {"backends": [{"backend": "host:port", "samples": N,
+ * "rtt_us_avg": ..., "retransmits": ...}, ...]}. The list is empty unless
+ * telemetry was enabled and at least one TCP request completed.
+ *
+ * @param client Client whose statistics to print
+ * @param out Destination stream (stdout or stderr)
+ */
+void cli_print_net_stats(WeatherClient* client, FILE* out);
+
+/**
+ * @brief Prints request counters, cache counters and latency histograms
+ *
+ * The text form is a table meant for people, with latencies in
+ * microseconds; the JSON form has the shape {"requests": {...}, "cache":
+ * {...}, "latency_ns": {"lookup": {"count", "mean", "p50", "p90", "p99",
+ * "max", "buckets": [{"le": ns, "count": N}, ...]}, ...}}. Percentiles are
+ * bucket upper bounds, see latency_histogram_percentile().
+ *
+ * @param client Client whose statistics to print
+ * @param out Destination stream (stdout or stderr)
+ * @param json Nonzero for JSON, zero for text
+ */
+void cli_print_cache_stats(WeatherClient* client, FILE* out, int json);
+
 /**
  * @brief Prints usage information and available commands
  *
@@ -76,8 +172,10 @@ void cli_print_usage(const char* prog_name);
  *
  * The function runs until the user types 'quit', 'exit', 'q', or EOF (Ctrl+D).
  *
- * @param client Pointer to the WeatherClient to use for all requests.
- *               Must be a valid, initialized client.
+ * The backend address is asked for interactively; the remaining options
+ * (such as --netem) are applied to the client created from it.
+ *
+ * @param options Parsed global options (may be NULL)
  *
  * @note This function is blocking and will not return until the user exits
  *       interactive mode or an unrecoverable error occurs.
@@ -89,9 +187,9 @@ void cli_print_usage(const char* prog_name);
  *
  * @par Example:
  * @code
- * WeatherClient *client = weather_client_create("localhost", 10680);
- * cli_interactive_mode(client);
- * weather_client_destroy(client);
+ * CliOptions options;
+ * cli_parse_options(argc, argv, &options);
+ * cli_interactive_mode(&options);
  * @endcode
  *
  * @par Interactive session example:
@@ -109,7 +207,7 @@ void cli_print_usage(const char* prog_name);
  * Goodbye!
  * @endcode
  */
-void cli_interactive_mode();
+void cli_interactive_mode(const CliOptions* options);
 
 /**
  * @brief Executes a command based on command-line arguments
@@ -126,6 +224,7 @@ void cli_interactive_mode();
  * - homepage - Get API homepage information
  * - echo - Test server connectivity
  * - clear-cache - Clear the response cache
+ * - net-stats - Print per-backend TCP telemetry
  * - interactive / -i - Returns -1 to signal interactive mode request
  *
  * @param client Pointer to the WeatherClient to use for the request.
@@ -14,21 +14,46 @@ int main(int argc, char* argv[]) {
         return EXIT_INVALID_ARGS;
     }
 
-    WeatherClient* client = weather_client_create("localhost", 10680);
+    CliOptions options;
+    int        first = cli_parse_options(argc, argv, &options);
+    if (first < 0 || first >= argc) {
+        cli_print_usage(argv[0]);
+        return EXIT_INVALID_ARGS;
+    }
+
+    /* Drop the options so argv[1] is the command again */
+    argv[first - 1] = argv[0];
+    argv += first - 1;
+    argc -= first - 1;
+
+    WeatherClient* client =
+        weather_client_create(options.server_host, options.server_port);
     if (!client) {
         fprintf(stderr, "Failed to create weather client\n");
         return EXIT_NETWORK_ERROR;
     }
 
+    if (cli_apply_options(client, &options) != 0) {
+        weather_client_destroy(client);
+        return EXIT_INVALID_ARGS;
+    }
+
     const char* command   = argv[1];
     int         exit_code = 0;
 
     if (strcmp(command, "interactive") == 0 || strcmp(command, "-i") == 0) {
-        cli_interactive_mode();
+        cli_interactive_mode(&options);
     } else {
         exit_code = cli_execute_command(client, argc, argv);
         if (exit_code == EXIT_INVALID_ARGS) {
             cli_print_usage(argv[0]);
+        } else {
+            if (options.telemetry && strcmp(command, "net-stats") != 0) {
+                cli_print_net_stats(client, stderr);
+            }
+            if (options.cache_stats && strcmp(command, "cache-stats") != 0) {
+                cli_print_cache_stats(client, stderr, 0);
+            }
         }
     }
 
@@ -7,14 +7,20 @@
  */
 #include "client_tcp.h"
 
+#include "../utils/utils.h"
+
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 ClientTCP* client_tcp_create() {
@@ -22,7 +28,8 @@ ClientTCP* client_tcp_create() {
     if (!tcp) {
         return NULL;
     }
-    tcp->fd = -1;
+    tcp->fd      = -1;
+    tcp->is_unix = 0;
     return tcp;
 }
 
@@ -44,6 +51,11 @@ int client_tcp_connect(ClientTCP* tcp, const char* host, int port,
         return -1;
     }
 
+    size_t prefix_len = strlen(CLIENT_TCP_UNIX_PREFIX);
+    if (strncmp(host, CLIENT_TCP_UNIX_PREFIX, prefix_len) == 0) {
+        return client_tcp_connect_unix(tcp, host + prefix_len, timeout_ms);
+    }
+
     char port_str[16];
     snprintf(port_str, sizeof(port_str), "%d", port);
 
@@ -111,7 +123,52 @@ int client_tcp_connect(ClientTCP* tcp, const char* host, int port,
     int flags = fcntl(fd, F_GETFL, 0);
     fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
 
-    tcp->fd = fd;
+    tcp->fd      = fd;
+    tcp->is_unix = 0;
+    return 0;
+}
+
+int client_tcp_connect_unix(ClientTCP* tcp, const char* path, int timeout_ms) {
+    if (!tcp || !path) {
+        return -1;
+    }
+
+    if (tcp->fd >= 0) {
+        return -1;
+    }
+
+    struct sockaddr_un addr = {0};
+    addr.sun_family         = AF_UNIX;
+
+    size_t path_len = strlen(path);
+    if (path_len == 0 || path_len >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(addr.sun_path, path, path_len + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* connect() on AF_UNIX completes locally; a full backlog blocks until
+     * the send timeout, so bound it instead of polling for writability. */
+    struct timeval tv;
+    tv.tv_sec  = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    struct timeval no_timeout = {0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &no_timeout, sizeof(no_timeout));
+
+    tcp->fd      = fd;
+    tcp->is_unix = 1;
     return 0;
 }
 
@@ -168,6 +225,90 @@ int client_tcp_recv(ClientTCP* tcp, void* buffer, size_t len, int timeout_ms) {
     return (int)received;
 }
 
+static int set_recv_timeout(int fd, uint64_t timeout_ms) {
+    struct timeval tv;
+    tv.tv_sec  = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+int client_tcp_recv_exact(ClientTCP* tcp, void* buffer, size_t len,
+                          int timeout_ms) {
+    if (!tcp || tcp->fd < 0 || !buffer || len > INT_MAX) {
+        return -1;
+    }
+
+    uint64_t now      = get_monotonic_time_ms();
+    uint64_t deadline = now + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+    if (now >= deadline) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    if (set_recv_timeout(tcp->fd, deadline - now) != 0) {
+        return -1;
+    }
+
+    size_t total = 0;
+    while (total < len) {
+        ssize_t received =
+            recv(tcp->fd, (char*)buffer + total, len - total, MSG_WAITALL);
+        if (received < 0 && errno != EINTR && errno != EAGAIN &&
+            errno != EWOULDBLOCK) {
+            return -1;
+        }
+
+        if (received == 0) {
+            break;
+        }
+
+        if (received > 0) {
+            total += received;
+        }
+        if (total == len) {
+            break;
+        }
+
+        /* Short read, signal or timeout: the next wait only gets what is
+         * left of the deadline */
+        now = get_monotonic_time_ms();
+        if (now >= deadline) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (set_recv_timeout(tcp->fd, deadline - now) != 0) {
+            return -1;
+        }
+    }
+
+    return (int)total;
+}
+
+int client_tcp_get_info(ClientTCP* tcp, ClientTCPInfo* info) {
+    if (!tcp || tcp->fd < 0 || !info) {
+        return -1;
+    }
+
+#ifdef TCP_INFO
+    if (!tcp->is_unix) {
+        struct tcp_info raw;
+        socklen_t       raw_len = sizeof(raw);
+        if (getsockopt(tcp->fd, IPPROTO_TCP, TCP_INFO, &raw, &raw_len) != 0) {
+            return -1;
+        }
+
+        info->rtt_us        = raw.tcpi_rtt;
+        info->rtt_var_us    = raw.tcpi_rttvar;
+        info->snd_cwnd      = raw.tcpi_snd_cwnd;
+        info->snd_mss       = raw.tcpi_snd_mss;
+        info->total_retrans = raw.tcpi_total_retrans;
+        return 0;
+    }
+#endif
+
+    errno = ENOTSUP;
+    return -1;
+}
+
 void client_tcp_close(ClientTCP* tcp) {
     if (!tcp || tcp->fd < 0) {
         return;
@@ -4,7 +4,8 @@
  *
  * This header provides a simple and portable TCP client implementation with
  * support for connection timeouts, reliable data transmission, and proper
- * resource management. The implementation supports both IPv4 and IPv6.
+ * resource management. The implementation supports both IPv4 and IPv6,
+ * as well as Unix domain stream sockets for co-located servers.
  */
 #ifndef CLIENT_TCP_H
 #define CLIENT_TCP_H
@@ -18,10 +19,26 @@
  */
 #include <stddef.h>
 
+/** Host prefix selecting a Unix domain socket (e.g. "unix:/run/weather.sock") */
+#define CLIENT_TCP_UNIX_PREFIX "unix:"
+
 typedef struct {
-    int fd; /**< Socket file descriptor (-1 when not connected) */
+    int fd;      /**< Socket file descriptor (-1 when not connected) */
+    int is_unix; /**< Non-zero when connected over a Unix domain socket */
 } ClientTCP;
 
+/**
+ * @struct ClientTCPInfo
+ * @brief Kernel TCP statistics of a connection (subset of TCP_INFO)
+ */
+typedef struct {
+    unsigned int rtt_us;        /**< Smoothed round trip time */
+    unsigned int rtt_var_us;    /**< Round trip time variance */
+    unsigned int snd_cwnd;      /**< Congestion window in segments */
+    unsigned int snd_mss;       /**< Sender maximum segment size */
+    unsigned int total_retrans; /**< Retransmitted segments so far */
+} ClientTCPInfo;
+
 /**
  * @brief Creates a new TCP client instance
  *
@@ -76,6 +93,10 @@ void client_tcp_destroy(ClientTCP* tcp);
  * The function attempts to resolve the hostname and tries each resolved
  * address until one succeeds or all fail.
  *
+ * If the host starts with CLIENT_TCP_UNIX_PREFIX, the remainder is treated
+ * as a filesystem path and the call is forwarded to client_tcp_connect_unix()
+ * (the port is ignored).
+ *
  * @param tcp Pointer to the ClientTCP structure
  * @param host The hostname or IP address to connect to (e.g., "example.com"
  *             or "192.168.1.1")
@@ -107,6 +128,39 @@ void client_tcp_destroy(ClientTCP* tcp);
 int client_tcp_connect(ClientTCP* tcp, const char* host, int port,
                        int timeout_ms);
 
+/**
+ * @brief Establishes a connection over a Unix domain stream socket
+ *
+ * Connects to a server listening on a local AF_UNIX stream socket. The
+ * connection behaves exactly like a TCP connection for client_tcp_send(),
+ * client_tcp_recv() and client_tcp_close(), but skips the TCP/IP loopback
+ * stack and does not consume an ephemeral port.
+ *
+ * @param tcp Pointer to the ClientTCP structure
+ * @param path Filesystem path of the socket (e.g., "/run/weather.sock")
+ * @param timeout_ms Connection timeout in milliseconds
+ *
+ * @return 0 on success, -1 on failure
+ * @retval 0 Connection established successfully
+ * @retval -1 Failed to connect (check errno for details)
+ *
+ * @note The function will fail if:
+ *       - Invalid parameters are provided (tcp is NULL, path is NULL)
+ *       - The path does not fit in sockaddr_un (errno set to ENAMETOOLONG)
+ *       - The client is already connected (tcp->fd >= 0)
+ *       - No server is listening on the socket
+ *
+ * @see client_tcp_connect(), client_tcp_close()
+ *
+ * @par Example:
+ * @code
+ * if (client_tcp_connect_unix(client, "/run/weather.sock", 5000) == 0) {
+ *     printf("Connected over Unix socket\n");
+ * }
+ * @endcode
+ */
+int client_tcp_connect_unix(ClientTCP* tcp, const char* path, int timeout_ms);
+
 /**
  * @brief Sends data over the TCP connection
  *
@@ -188,6 +242,69 @@ int client_tcp_send(ClientTCP* tcp, const void* data, size_t len);
  */
 int client_tcp_recv(ClientTCP* tcp, void* buffer, size_t len, int timeout_ms);
 
+/**
+ * @brief Receives exactly len bytes before an absolute deadline
+ *
+ * Intended for reads whose size is already known (e.g. an HTTP body after
+ * Content-Length was parsed). Instead of waking up through select() for
+ * every segment, the function blocks in recv() with MSG_WAITALL and lets
+ * the kernel gather the whole range. SO_RCVTIMEO is set to the time left
+ * until a single deadline computed on entry, so a server that trickles
+ * bytes slowly cannot extend the wait beyond timeout_ms in total.
+ *
+ * @param tcp Pointer to the ClientTCP structure
+ * @param buffer Destination buffer of at least len bytes
+ * @param len Number of bytes to read (at most INT_MAX)
+ * @param timeout_ms Total time budget for the whole read in milliseconds
+ *
+ * @return Number of bytes read, or -1 on failure
+ * @retval len All bytes received
+ * @retval <len The peer closed the connection early
+ * @retval -1 Error, or the deadline passed (errno set to ETIMEDOUT)
+ *
+ * @note SO_RCVTIMEO is left set on the socket; client_tcp_recv() waits in
+ *       select() first and is therefore unaffected.
+ *
+ * @see client_tcp_recv()
+ *
+ * @par Example:
+ * @code
+ * char body[512];
+ * if (client_tcp_recv_exact(client, body, sizeof(body), 5000) ==
+ *     (int)sizeof(body)) {
+ *     printf("Got the full body\n");
+ * }
+ * @endcode
+ */
+int client_tcp_recv_exact(ClientTCP* tcp, void* buffer, size_t len,
+                          int timeout_ms);
+
+/**
+ * @brief Samples kernel TCP statistics for the current connection
+ *
+ * Performs a single getsockopt(TCP_INFO) call. Intended to be called at
+ * the end of a request/response exchange, before client_tcp_close(), to
+ * tell network slowness (RTT, retransmits, small congestion window) apart
+ * from server slowness.
+ *
+ * @param tcp Pointer to the ClientTCP structure
+ * @param info Output statistics
+ *
+ * @return 0 on success, -1 on failure
+ *
+ * @note Fails with errno ENOTSUP for Unix domain sockets and on platforms
+ *       without TCP_INFO; no system call is made in that case.
+ *
+ * @par Example:
+ * @code
+ * ClientTCPInfo info;
+ * if (client_tcp_get_info(client, &info) == 0) {
+ *     printf("rtt=%uus retrans=%u\n", info.rtt_us, info.total_retrans);
+ * }
+ * @endcode
+ */
+int client_tcp_get_info(ClientTCP* tcp, ClientTCPInfo* info);
+
 /**
  * @brief Closes the TCP connection
  *
@@ -7,7 +7,12 @@
  */
 #include "http_client.h"
 
+#include "../utils/utils.h"
+#include "client_tcp.h"
+
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,11 +20,13 @@
 
 static int parse_url(const char* url, char* hostname, int* port, char* path);
 static int send_request(HttpClient* client, const char* host, const char* path);
-static int receive_response(HttpClient* client);
+static int receive_response(HttpClient* client, uint64_t deadline);
 static int parse_headers(const char* data, size_t len, int* status_code,
-                         size_t* content_length, int* chunked);
+                         size_t* content_length, int* has_length,
+                         int* chunked, char* etag);
 static int decode_chunked(const uint8_t* in, size_t in_len, char** out,
                           size_t* out_len);
+static void record_telemetry(HttpClient* client, const char* host, int port);
 
 HttpClient* http_client_create(int timeout_ms) {
     HttpClient* client = malloc(sizeof(HttpClient));
@@ -27,13 +34,18 @@ HttpClient* http_client_create(int timeout_ms) {
         return NULL;
     }
 
-    client->tcp           = client_tcp_create();
-    client->status_code   = 0;
-    client->response_body = NULL;
-    client->response_size = 0;
-    client->timeout_ms    = timeout_ms > 0 ? timeout_ms : 5000;
-
-    if (!client->tcp) {
+    client->transport      = transport_tcp_create();
+    client->status_code    = 0;
+    client->response_body  = NULL;
+    client->response_size  = 0;
+    client->timeout_ms     = timeout_ms > 0 ? timeout_ms : 5000;
+    client->unix_socket[0] = '\0';
+    client->telemetry      = 0;
+    client->backend_stats  = NULL;
+    client->backend_count  = 0;
+    client->etag[0]        = '\0';
+
+    if (!client->transport) {
         free(client);
         return NULL;
     }
@@ -50,10 +62,12 @@ void http_client_destroy(HttpClient* client) {
         free(client->response_body);
     }
 
-    if (client->tcp) {
-        client_tcp_destroy(client->tcp);
+    if (client->transport) {
+        transport_destroy(client->transport);
     }
 
+    free(client->backend_stats);
+
     free(client);
 }
 
@@ -65,6 +79,12 @@ int http_client_get(HttpClient* client, const char* url, char** error) {
         return -1;
     }
 
+    free(client->response_body);
+    client->response_body = NULL;
+    client->response_size = 0;
+    client->status_code   = 0;
+    client->etag[0]       = '\0';
+
     char hostname[256];
     int  port;
     char path[512];
@@ -76,8 +96,20 @@ int http_client_get(HttpClient* client, const char* url, char** error) {
         return -1;
     }
 
-    if (client_tcp_connect(client->tcp, hostname, port, client->timeout_ms) !=
-        0) {
+    /* One budget for the whole exchange, so a slow-drip server cannot
+     * extend it by sending a byte just before each read times out. */
+    uint64_t deadline = get_monotonic_time_ms() + client->timeout_ms;
+
+    const char* target = hostname;
+    char        unix_target[sizeof(client->unix_socket) + 8];
+    if (client->unix_socket[0] != '\0') {
+        snprintf(unix_target, sizeof(unix_target), "%s%s",
+                 CLIENT_TCP_UNIX_PREFIX, client->unix_socket);
+        target = unix_target;
+    }
+
+    if (transport_connect(client->transport, target, port,
+                          client->timeout_ms) != 0) {
         if (error) {
             *error = strdup("Connection failed");
         }
@@ -88,19 +120,23 @@ int http_client_get(HttpClient* client, const char* url, char** error) {
         if (error) {
             *error = strdup("Failed to send request");
         }
-        client_tcp_close(client->tcp);
+        transport_close(client->transport);
         return -1;
     }
 
-    if (receive_response(client) != 0) {
+    if (receive_response(client, deadline) != 0) {
         if (error) {
             *error = strdup("Failed to receive response");
         }
-        client_tcp_close(client->tcp);
+        transport_close(client->transport);
         return -1;
     }
 
-    client_tcp_close(client->tcp);
+    if (client->telemetry) {
+        record_telemetry(client, target, port);
+    }
+
+    transport_close(client->transport);
 
     if (client->status_code < 200 || client->status_code >= 600) {
         if (error) {
@@ -126,6 +162,111 @@ size_t http_client_get_body_size(HttpClient* client) {
     return client ? client->response_size : 0;
 }
 
+const char* http_client_get_etag(HttpClient* client) {
+    if (!client || client->etag[0] == '\0') {
+        return NULL;
+    }
+    return client->etag;
+}
+
+int http_client_set_unix_socket(HttpClient* client, const char* path) {
+    if (!client) {
+        return -1;
+    }
+
+    if (!path) {
+        client->unix_socket[0] = '\0';
+        return 0;
+    }
+
+    size_t len = strlen(path);
+    if (len >= sizeof(client->unix_socket)) {
+        return -1;
+    }
+
+    memcpy(client->unix_socket, path, len + 1);
+    return 0;
+}
+
+int http_client_set_transport(HttpClient* client, Transport* transport) {
+    if (!client || !transport) {
+        return -1;
+    }
+
+    /* Installing the current transport again must not free it */
+    if (transport == client->transport) {
+        return 0;
+    }
+
+    transport_destroy(client->transport);
+    client->transport = transport;
+    return 0;
+}
+
+void http_client_set_telemetry(HttpClient* client, int enabled) {
+    if (client) {
+        client->telemetry = enabled ? 1 : 0;
+    }
+}
+
+const HttpBackendStats* http_client_get_backend_stats(HttpClient* client,
+                                                      size_t*     count) {
+    if (count) {
+        *count = client ? client->backend_count : 0;
+    }
+    return client ? client->backend_stats : NULL;
+}
+
+static void record_telemetry(HttpClient* client, const char* host, int port) {
+    ClientTCPInfo info;
+    if (transport_get_info(client->transport, &info) != 0) {
+        return;
+    }
+
+    char backend[sizeof(client->backend_stats->backend)];
+    snprintf(backend, sizeof(backend), "%s:%d", host, port);
+
+    HttpBackendStats* stats = NULL;
+    for (size_t i = 0; i < client->backend_count; i++) {
+        if (strcmp(client->backend_stats[i].backend, backend) == 0) {
+            stats = &client->backend_stats[i];
+            break;
+        }
+    }
+
+    if (!stats) {
+        HttpBackendStats* grown =
+            realloc(client->backend_stats,
+                    (client->backend_count + 1) * sizeof(HttpBackendStats));
+        if (!grown) {
+            return;
+        }
+        client->backend_stats = grown;
+        stats                 = &grown[client->backend_count++];
+        memset(stats, 0, sizeof(HttpBackendStats));
+        memcpy(stats->backend, backend, sizeof(backend));
+        stats->rtt_us_min   = info.rtt_us;
+        stats->snd_cwnd_min = info.snd_cwnd;
+    }
+
+    stats->samples++;
+    stats->rtt_us_last     = info.rtt_us;
+    stats->rtt_us_sum     += info.rtt_us;
+    stats->rtt_var_us_last = info.rtt_var_us;
+    stats->snd_cwnd_last   = info.snd_cwnd;
+    stats->retransmits    += info.total_retrans;
+
+    if (info.rtt_us < stats->rtt_us_min) {
+        stats->rtt_us_min = info.rtt_us;
+    }
+    if (info.rtt_us > stats->rtt_us_max) {
+        stats->rtt_us_max = info.rtt_us;
+    }
+    if (info.snd_cwnd < stats->snd_cwnd_min) {
+        stats->snd_cwnd_min = info.snd_cwnd;
+    }
+}
+
 static int parse_url(const char* url, char* hostname, int* port, char* path) {
     if (url == NULL || hostname == NULL || port == NULL || path == NULL) {
         return -1;
@@ -196,98 +337,161 @@ static int send_request(HttpClient* client, const char* host,
         return -1;
     }
 
-    return client_tcp_send(client->tcp, request, len);
+    return transport_send(client->transport, request, len);
 }
 
-static int receive_response(HttpClient* client) {
-    char   buffer[8192];
-    size_t total_received = 0;
-    char*  full_response  = NULL;
-
-    while (1) {
-        int received = client_tcp_recv(client->tcp, buffer, sizeof(buffer) - 1,
-                                       client->timeout_ms);
+static int remaining_ms(uint64_t deadline) {
+    uint64_t now = get_monotonic_time_ms();
+    if (now >= deadline) {
+        errno = ETIMEDOUT;
+        return 0;
+    }
+    return deadline - now > INT_MAX ? INT_MAX : (int)(deadline - now);
+}
 
-        if (received < 0) {
-            free(full_response);
+static int read_more(HttpClient* client, char** data, size_t* alloc,
+                     size_t* total, uint64_t deadline) {
+    if (*total + 4096 + 1 > *alloc) {
+        size_t new_alloc = *alloc * 2;
+        char*  grown     = realloc(*data, new_alloc);
+        if (!grown) {
             return -1;
         }
+        *data  = grown;
+        *alloc = new_alloc;
+    }
 
-        if (received == 0) {
-            break;
-        }
-
-        char* new_response =
-            realloc(full_response, total_received + received + 1);
-        if (!new_response) {
-            free(full_response);
-            return -1;
-        }
+    int timeout = remaining_ms(deadline);
+    if (timeout == 0) {
+        return -1;
+    }
 
-        full_response = new_response;
-        memcpy(full_response + total_received, buffer, received);
-        total_received += received;
-        full_response[total_received] = '\0';
+    int received = transport_recv(client->transport, *data + *total,
+                                  *alloc - *total - 1, timeout);
+    if (received > 0) {
+        *total += received;
+        (*data)[*total] = '\0';
     }
+    return received;
+}
+
+static int receive_response(HttpClient* client, uint64_t deadline) {
+    size_t alloc      = 8192;
+    size_t total      = 0;
+    char*  data       = malloc(alloc);
+    char*  header_end = NULL;
 
-    if (!full_response || total_received == 0) {
-        free(full_response);
+    if (!data) {
         return -1;
     }
+    data[0] = '\0';
+
+    /* Read until the header block is complete; the body may follow */
+    while (!header_end) {
+        size_t scan_from = total > 3 ? total - 3 : 0;
+        int    received  = read_more(client, &data, &alloc, &total, deadline);
+        if (received <= 0) {
+            free(data);
+            return -1;
+        }
+        header_end = strstr(data + scan_from, "\r\n\r\n");
+    }
 
+    size_t header_len     = header_end + 4 - data;
     size_t content_length = 0;
+    int    has_length     = 0;
     int    is_chunked     = 0;
 
-    if (parse_headers(full_response, total_received, &client->status_code,
-                      &content_length, &is_chunked) != 0) {
-        free(full_response);
+    if (parse_headers(data, header_len, &client->status_code, &content_length,
+                      &has_length, &is_chunked, client->etag) != 0) {
+        free(data);
         return -1;
     }
 
-    const char* body_start = strstr(full_response, "\r\n\r\n");
-    if (!body_start) {
-        free(full_response);
-        return -1;
+    if (has_length && !is_chunked) {
+        /* Size is known: copy what arrived with the headers and read the
+         * rest straight into the body in one deadline-bound call. */
+        if (content_length > INT_MAX) {
+            free(data);
+            return -1;
+        }
+
+        char* body = malloc(content_length + 1);
+        if (!body) {
+            free(data);
+            return -1;
+        }
+
+        size_t have = total - header_len;
+        if (have > content_length) {
+            have = content_length;
+        }
+        memcpy(body, data + header_len, have);
+        free(data);
+
+        if (have < content_length) {
+            size_t missing = content_length - have;
+            int    timeout = remaining_ms(deadline);
+            if (timeout == 0 ||
+                transport_recv_exact(client->transport, body + have, missing,
+                                     timeout) != (int)missing) {
+                free(body);
+                return -1;
+            }
+        }
+
+        body[content_length]  = '\0';
+        client->response_body = body;
+        client->response_size = content_length;
+        return 0;
     }
-    body_start += 4;
 
-    size_t header_len = body_start - full_response;
-    size_t body_len   = total_received - header_len;
+    /* Chunked or unknown length: the server closes the connection */
+    while (1) {
+        int received = read_more(client, &data, &alloc, &total, deadline);
+        if (received < 0) {
+            free(data);
+            return -1;
+        }
+        if (received == 0) {
+            break;
+        }
+    }
+
+    const char* body_start = data + header_len;
+    size_t      body_len   = total - header_len;
 
     if (is_chunked) {
         char*  decoded_body = NULL;
         size_t decoded_len  = 0;
 
         if (decode_chunked((uint8_t*)body_start, body_len, &decoded_body,
-                           &decoded_len) == 0) {
-            free(full_response);
-            client->response_body = decoded_body;
-            client->response_size = decoded_len;
-            return 0;
-        } else {
-            free(full_response);
-            return -1;
-        }
-    } else {
-        client->response_body = malloc(body_len + 1);
-        if (!client->response_body) {
-            free(full_response);
+                           &decoded_len) != 0) {
+            free(data);
             return -1;
         }
 
-        memcpy(client->response_body, body_start, body_len);
-        client->response_body[body_len] = '\0';
-        client->response_size           = body_len;
-        free(full_response);
+        free(data);
+        client->response_body = decoded_body;
+        client->response_size = decoded_len;
         return 0;
     }
+
+    memmove(data, body_start, body_len);
+    data[body_len]        = '\0';
+    client->response_body = data;
+    client->response_size = body_len;
+    return 0;
 }
 
 static int parse_headers(const char* data, size_t len, int* status_code,
-                         size_t* content_length, int* chunked) {
+                         size_t* content_length, int* has_length,
+                         int* chunked, char* etag) {
     *status_code    = 0;
     *content_length = 0;
+    *has_length     = 0;
     *chunked        = 0;
+    etag[0]         = '\0';
 
     const char* line_end = strstr(data, "\r\n");
     if (!line_end) {
@@ -310,11 +514,21 @@ static int parse_headers(const char* data, size_t len, int* status_code,
         }
 
         if (strncasecmp(current, "Content-Length:", 15) == 0) {
-            sscanf(current + 15, "%zu", content_length);
+            *has_length = sscanf(current + 15, "%zu", content_length) == 1;
         } else if (strncasecmp(current, "Transfer-Encoding:", 18) == 0) {
             if (strstr(current, "chunked")) {
                 *chunked = 1;
             }
+        } else if (strncasecmp(current, "ETag:", 5) == 0) {
+            const char* value = current + 5;
+            while (value < line_end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            size_t value_len = line_end - value;
+            if (value_len > 0 && value_len < HTTP_CLIENT_ETAG_MAX) {
+                memcpy(etag, value, value_len);
+                etag[value_len] = '\0';
+            }
         }
 
         current = line_end + 2;
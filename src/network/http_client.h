@@ -3,8 +3,9 @@
  * @brief Simple HTTP/1.1 client implementation
  *
  * This header provides a simple HTTP client implementation built on top of
- * the TCP client. It supports HTTP GET requests with automatic URL parsing,
- * header processing, and chunked transfer encoding support. The client
+ * a pluggable transport (TCP by default, see transport.h). It supports HTTP
+ * GET requests with automatic URL parsing, header processing, and chunked
+ * transfer encoding support. The client
  * automatically handles connection management and response parsing.
  *
  * @note This implementation currently supports HTTP only (not HTTPS).
@@ -13,39 +14,67 @@
 #ifndef HTTP_CLIENT_H
 #define HTTP_CLIENT_H
 
-#include "client_tcp.h"
+#include "transport.h"
 
 #include <stddef.h>
 
+#define HTTP_CLIENT_ETAG_MAX 128 ///< Longest ETag kept (including NUL)
+
+/**
+ * @struct HttpBackendStats
+ * @brief TCP_INFO samples aggregated for one backend
+ *
+ * One sample is taken at the end of each successful exchange while
+ * telemetry is enabled (see http_client_set_telemetry()).
+ */
+typedef struct {
+    char               backend[272];    /**< "host:port" or "unix:/path" */
+    size_t             samples;         /**< Number of exchanges sampled */
+    unsigned int       rtt_us_last;     /**< Most recent smoothed RTT */
+    unsigned int       rtt_us_min;      /**< Lowest smoothed RTT seen */
+    unsigned int       rtt_us_max;      /**< Highest smoothed RTT seen */
+    unsigned long long rtt_us_sum;      /**< Sum of RTTs (for the mean) */
+    unsigned int       rtt_var_us_last; /**< Most recent RTT variance */
+    unsigned int       snd_cwnd_last;   /**< Most recent congestion window */
+    unsigned int       snd_cwnd_min;    /**< Smallest congestion window */
+    unsigned long long retransmits;     /**< Retransmitted segments, total */
+} HttpBackendStats;
+
 /**
  * @struct HttpClient
  * @brief HTTP client connection structure
  *
  * Structure that maintains the state of an HTTP client connection including
- * the underlying TCP connection, response data, and configuration.
+ * the underlying transport, response data, and configuration.
  */
 typedef struct {
-    ClientTCP* tcp;
-    char       url[1024];
-    int        status_code;
-    char*      response_body;
-    size_t     response_size;
-    int        timeout_ms;
+    Transport*        transport;
+    char              url[1024];
+    int               status_code;
+    char*             response_body;
+    size_t            response_size;
+    char              etag[HTTP_CLIENT_ETAG_MAX];
+    int               timeout_ms;
+    char              unix_socket[108]; /**< AF_UNIX path, empty for TCP */
+    int               telemetry;        /**< Sample TCP_INFO per exchange */
+    HttpBackendStats* backend_stats;    /**< Per-backend telemetry */
+    size_t            backend_count;    /**< Entries in backend_stats */
 } HttpClient;
 
 /**
  * @brief Creates a new HTTP client instance
  *
  * Allocates and initializes a new HttpClient structure with the specified
- * timeout. The client creates an underlying TCP connection that will be
- * used for HTTP requests. The returned client must be destroyed with
- * http_client_destroy() when no longer needed.
+ * timeout. The client creates an underlying TCP transport that will be
+ * used for HTTP requests (replaceable with http_client_set_transport()).
+ * The returned client must be destroyed with http_client_destroy() when no
+ * longer needed.
  *
  * @param timeout_ms Timeout for network operations in milliseconds.
  *                   If <= 0, defaults to 5000ms (5 seconds).
  *
  * @return Pointer to the newly created HttpClient structure, or NULL if
- *         memory allocation fails or TCP client creation fails
+ *         memory allocation fails or transport creation fails
  *
  * @see http_client_destroy()
  *
@@ -64,7 +93,7 @@ HttpClient* http_client_create(int timeout_ms);
  * @brief Destroys an HTTP client instance and frees all resources
  *
  * Closes any open connections, frees the response body buffer, destroys
- * the underlying TCP client, and frees the HttpClient structure memory.
+ * the underlying transport, and frees the HttpClient structure memory.
  * Safe to call with NULL pointer. After calling this function, the pointer
  * should not be used anymore.
  *
@@ -226,4 +255,102 @@ const char* http_client_get_body(HttpClient* client);
  */
 size_t http_client_get_body_size(HttpClient* client);
 
+/**
+ * @brief Gets the ETag header of the last response
+ *
+ * @param client Pointer to the HttpClient structure
+ *
+ * @return The entity tag exactly as sent (quotes included), or NULL if the
+ *         response had none or it was longer than HTTP_CLIENT_ETAG_MAX - 1
+ */
+const char* http_client_get_etag(HttpClient* client);
+
+/**
+ * @brief Routes all requests over a Unix domain socket
+ *
+ * When set, every subsequent request connects to the given AF_UNIX stream
+ * socket instead of resolving the URL host. The URL is still parsed as
+ * usual and its host is sent in the Host header, so the HTTP framing is
+ * identical to a TCP request.
+ *
+ * @param client Pointer to the HttpClient structure
+ * @param path Socket path, or NULL/empty string to go back to TCP
+ *
+ * @return 0 on success, -1 if client is NULL or the path is too long
+ *
+ * @see client_tcp_connect_unix()
+ *
+ * @par Example:
+ * @code
+ * http_client_set_unix_socket(client, "/run/just-weather.sock");
+ * http_client_get(client, "http://localhost/v1/current?lat=1&lon=2", NULL);
+ * @endcode
+ */
+int http_client_set_unix_socket(HttpClient* client, const char* path);
+
+/**
+ * @brief Replaces the transport used for all subsequent requests
+ *
+ * The client takes ownership of the transport and destroys the previous
+ * one; passing the transport already installed is a no-op. This is how the
+ * in-memory loopback transport (transport_loopback.h) is plugged in for
+ * benchmarks.
+ *
+ * @param client Pointer to the HttpClient structure
+ * @param transport New transport (ownership transferred)
+ *
+ * @return 0 on success, -1 if client or transport is NULL (in which case
+ *         ownership stays with the caller)
+ *
+ * @see transport_loopback_create()
+ *
+ * @par Example:
+ * @code
+ * Transport *loop = transport_loopback_create(canned, canned_len);
+ * if (http_client_set_transport(client, loop) != 0) {
+ *     transport_destroy(loop);
+ * }
+ * @endcode
+ */
+int http_client_set_transport(HttpClient* client, Transport* transport);
+
+/**
+ * @brief Enables or disables TCP_INFO connection telemetry
+ *
+ * While enabled, the client samples the transport's TCP statistics with a
+ * single getsockopt() at the end of every successful exchange and folds
+ * them into per-backend aggregates. While disabled (the default) no extra
+ * work is done at all. Transports without kernel statistics (Unix sockets,
+ * loopback) are silently skipped.
+ *
+ * @param client Pointer to the HttpClient structure
+ * @param enabled Non-zero to enable sampling
+ *
+ * @see http_client_get_backend_stats()
+ */
+void http_client_set_telemetry(HttpClient* client, int enabled);
+
+/**
+ * @brief Returns the aggregated telemetry of every backend contacted
+ *
+ * @param client Pointer to the HttpClient structure
+ * @param count Output: number of entries in the returned array
+ *
+ * @return Array of per-backend statistics owned by the client (valid until
+ *         the next request or http_client_destroy()), or NULL if empty
+ *
+ * @par Example:
+ * @code
+ * size_t count = 0;
+ * const HttpBackendStats *stats = http_client_get_backend_stats(client,
+ *                                                               &count);
+ * for (size_t i = 0; i < count; i++) {
+ *     printf("%s: %zu samples, avg rtt %lluus\n", stats[i].backend,
+ *            stats[i].samples, stats[i].rtt_us_sum / stats[i].samples);
+ * }
+ * @endcode
+ */
+const HttpBackendStats* http_client_get_backend_stats(HttpClient* client,
+                                                      size_t*     count);
+
 #endif
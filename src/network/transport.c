@@ -0,0 +1,158 @@
+/**
+ * @file transport.c
+ * @brief Transport dispatch and the default ClientTCP transport
+ *
+ * See transport.h for detailed API documentation.
+ */
+#include "transport.h"
+
+#include "../utils/utils.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+
+static int tcp_connect(void* ctx, const char* host, int port,
+                       int timeout_ms) {
+    return client_tcp_connect((ClientTCP*)ctx, host, port, timeout_ms);
+}
+
+static int tcp_send(void* ctx, const void* data, size_t len) {
+    return client_tcp_send((ClientTCP*)ctx, data, len);
+}
+
+static int tcp_recv(void* ctx, void* buffer, size_t len, int timeout_ms) {
+    return client_tcp_recv((ClientTCP*)ctx, buffer, len, timeout_ms);
+}
+
+static void tcp_close(void* ctx) { client_tcp_close((ClientTCP*)ctx); }
+
+static void tcp_destroy(void* ctx) { client_tcp_destroy((ClientTCP*)ctx); }
+
+static int tcp_get_info(void* ctx, ClientTCPInfo* info) {
+    return client_tcp_get_info((ClientTCP*)ctx, info);
+}
+
+static int tcp_recv_exact(void* ctx, void* buffer, size_t len,
+                          int timeout_ms) {
+    return client_tcp_recv_exact((ClientTCP*)ctx, buffer, len, timeout_ms);
+}
+
+static const TransportVTable TCP_VTABLE = {
+    tcp_connect, tcp_send,    tcp_recv,       tcp_close,
+    tcp_destroy, tcp_get_info, tcp_recv_exact,
+};
+
+Transport* transport_create(const TransportVTable* vtable, void* ctx) {
+    if (!vtable) {
+        return NULL;
+    }
+
+    Transport* transport = malloc(sizeof(Transport));
+    if (!transport) {
+        return NULL;
+    }
+
+    transport->vtable = vtable;
+    transport->ctx    = ctx;
+    return transport;
+}
+
+Transport* transport_tcp_create() {
+    ClientTCP* tcp = client_tcp_create();
+    if (!tcp) {
+        return NULL;
+    }
+
+    Transport* transport = transport_create(&TCP_VTABLE, tcp);
+    if (!transport) {
+        client_tcp_destroy(tcp);
+        return NULL;
+    }
+
+    return transport;
+}
+
+void transport_destroy(Transport* transport) {
+    if (!transport) {
+        return;
+    }
+
+    transport->vtable->close(transport->ctx);
+    transport->vtable->destroy(transport->ctx);
+    free(transport);
+}
+
+int transport_connect(Transport* transport, const char* host, int port,
+                      int timeout_ms) {
+    if (!transport) {
+        return -1;
+    }
+    return transport->vtable->connect(transport->ctx, host, port, timeout_ms);
+}
+
+int transport_send(Transport* transport, const void* data, size_t len) {
+    if (!transport) {
+        return -1;
+    }
+    return transport->vtable->send(transport->ctx, data, len);
+}
+
+int transport_recv(Transport* transport, void* buffer, size_t len,
+                   int timeout_ms) {
+    if (!transport) {
+        return -1;
+    }
+    return transport->vtable->recv(transport->ctx, buffer, len, timeout_ms);
+}
+
+int transport_recv_exact(Transport* transport, void* buffer, size_t len,
+                         int timeout_ms) {
+    if (!transport || !buffer || len > INT_MAX) {
+        return -1;
+    }
+
+    if (transport->vtable->recv_exact) {
+        return transport->vtable->recv_exact(transport->ctx, buffer, len,
+                                             timeout_ms);
+    }
+
+    uint64_t deadline =
+        get_monotonic_time_ms() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+    size_t total = 0;
+
+    while (total < len) {
+        uint64_t now = get_monotonic_time_ms();
+        if (now >= deadline) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+
+        int received =
+            transport->vtable->recv(transport->ctx, (char*)buffer + total,
+                                    len - total, (int)(deadline - now));
+        if (received < 0) {
+            return -1;
+        }
+        if (received == 0) {
+            break;
+        }
+        total += received;
+    }
+
+    return (int)total;
+}
+
+int transport_get_info(Transport* transport, ClientTCPInfo* info) {
+    if (!transport || !transport->vtable->get_info) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    return transport->vtable->get_info(transport->ctx, info);
+}
+
+void transport_close(Transport* transport) {
+    if (transport) {
+        transport->vtable->close(transport->ctx);
+    }
+}
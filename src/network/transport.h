@@ -0,0 +1,132 @@
+/**
+ * @file transport.h
+ * @brief Pluggable byte-stream transport used by the HTTP client
+ *
+ * This header defines a small vtable interface (connect/send/recv/close)
+ * that HttpClient uses for all I/O. The default implementation wraps
+ * ClientTCP and therefore supports TCP as well as Unix domain sockets.
+ * Alternative implementations (see transport_loopback.h) can serve
+ * responses without touching the kernel, which makes it possible to
+ * benchmark HTTP parsing, caching and JSON handling in isolation.
+ *
+ * All operations follow the ClientTCP conventions: 0 on success, -1 on
+ * failure, and recv returns the number of bytes read (0 on end of stream).
+ */
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "client_tcp.h"
+
+#include <stddef.h>
+
+/**
+ * @struct TransportVTable
+ * @brief Operations implemented by a transport
+ *
+ * Every operation receives the transport's private context pointer.
+ * destroy must release the context; it is called once by
+ * transport_destroy(). get_info is optional (NULL when the transport has
+ * no kernel connection statistics to report). recv_exact is optional too;
+ * without it transport_recv_exact() loops over recv against one deadline.
+ */
+typedef struct {
+    int (*connect)(void* ctx, const char* host, int port, int timeout_ms);
+    int (*send)(void* ctx, const void* data, size_t len);
+    int (*recv)(void* ctx, void* buffer, size_t len, int timeout_ms);
+    void (*close)(void* ctx);
+    void (*destroy)(void* ctx);
+    int (*get_info)(void* ctx, ClientTCPInfo* info);
+    int (*recv_exact)(void* ctx, void* buffer, size_t len, int timeout_ms);
+} TransportVTable;
+
+/**
+ * @struct Transport
+ * @brief A transport instance: operations plus private state
+ */
+typedef struct {
+    const TransportVTable* vtable; /**< Operations of this transport */
+    void*                  ctx;    /**< Implementation specific state */
+} Transport;
+
+/**
+ * @brief Wraps an implementation into a heap allocated Transport
+ *
+ * Intended for transport implementations. On allocation failure the
+ * context is NOT destroyed; the caller keeps ownership of it.
+ *
+ * @param vtable Operations table (must outlive the transport)
+ * @param ctx Implementation state passed to every operation
+ *
+ * @return New transport, or NULL on allocation failure
+ */
+Transport* transport_create(const TransportVTable* vtable, void* ctx);
+
+/**
+ * @brief Creates the default transport backed by a ClientTCP socket
+ *
+ * Hosts starting with CLIENT_TCP_UNIX_PREFIX connect over a Unix domain
+ * socket, everything else over TCP.
+ *
+ * @return New transport, or NULL on allocation failure
+ *
+ * @par Example:
+ * @code
+ * Transport *transport = transport_tcp_create();
+ * if (transport_connect(transport, "localhost", 10680, 5000) == 0) {
+ *     transport_send(transport, request, request_len);
+ * }
+ * transport_destroy(transport);
+ * @endcode
+ */
+Transport* transport_tcp_create();
+
+/**
+ * @brief Closes and frees a transport (safe to call with NULL)
+ */
+void transport_destroy(Transport* transport);
+
+/**
+ * @brief Opens a connection to host:port (see client_tcp_connect())
+ */
+int transport_connect(Transport* transport, const char* host, int port,
+                      int timeout_ms);
+
+/**
+ * @brief Sends the whole buffer (see client_tcp_send())
+ */
+int transport_send(Transport* transport, const void* data, size_t len);
+
+/**
+ * @brief Receives up to len bytes (see client_tcp_recv())
+ *
+ * @return Number of bytes received, 0 at end of stream, -1 on error
+ *         (errno is ETIMEDOUT when the timeout expires)
+ */
+int transport_recv(Transport* transport, void* buffer, size_t len,
+                   int timeout_ms);
+
+/**
+ * @brief Receives exactly len bytes within timeout_ms in total
+ *
+ * See client_tcp_recv_exact(). The timeout is a budget for the whole read,
+ * not per underlying recv.
+ *
+ * @return len on success, fewer bytes if the stream ended early, -1 on
+ *         error or when the budget is exhausted (errno ETIMEDOUT)
+ */
+int transport_recv_exact(Transport* transport, void* buffer, size_t len,
+                         int timeout_ms);
+
+/**
+ * @brief Samples connection statistics (see client_tcp_get_info())
+ *
+ * @return 0 on success, -1 if unsupported by the transport or on error
+ */
+int transport_get_info(Transport* transport, ClientTCPInfo* info);
+
+/**
+ * @brief Closes the current connection; the transport can be reconnected
+ */
+void transport_close(Transport* transport);
+
+#endif
@@ -0,0 +1,204 @@
+/**
+ * @file transport_loopback.c
+ * @brief In-process loopback transport implementation
+ *
+ * See transport_loopback.h for detailed API documentation.
+ */
+#include "transport_loopback.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int             connected;
+    char*           request;
+    size_t          request_len;
+    size_t          request_alloc;
+    char*           canned;
+    size_t          canned_len;
+    LoopbackHandler handler;
+    void*           user_data;
+    char*           generated;
+    const char*     response;
+    size_t          response_len;
+    size_t          response_pos;
+    size_t          exchanges;
+} Loopback;
+
+static void reset_exchange(Loopback* loop) {
+    free(loop->generated);
+    loop->generated    = NULL;
+    loop->response     = NULL;
+    loop->response_len = 0;
+    loop->response_pos = 0;
+    loop->request_len  = 0;
+}
+
+static int loopback_connect(void* ctx, const char* host, int port,
+                            int timeout_ms) {
+    Loopback* loop = ctx;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+
+    if (loop->connected) {
+        return -1;
+    }
+
+    reset_exchange(loop);
+    loop->connected = 1;
+    return 0;
+}
+
+static int loopback_send(void* ctx, const void* data, size_t len) {
+    Loopback* loop = ctx;
+    if (!loop->connected || !data) {
+        return -1;
+    }
+
+    if (loop->request_len + len + 1 > loop->request_alloc) {
+        size_t alloc = loop->request_alloc ? loop->request_alloc : 1024;
+        while (loop->request_len + len + 1 > alloc) {
+            alloc *= 2;
+        }
+        char* request = realloc(loop->request, alloc);
+        if (!request) {
+            return -1;
+        }
+        loop->request       = request;
+        loop->request_alloc = alloc;
+    }
+
+    memcpy(loop->request + loop->request_len, data, len);
+    loop->request_len += len;
+    loop->request[loop->request_len] = '\0';
+    return 0;
+}
+
+static int produce_response(Loopback* loop) {
+    if (loop->handler) {
+        char*  generated     = NULL;
+        size_t generated_len = 0;
+        if (loop->handler(loop->request ? loop->request : "",
+                          loop->request_len, &generated, &generated_len,
+                          loop->user_data) != 0) {
+            free(generated);
+            return -1;
+        }
+        loop->generated    = generated;
+        loop->response     = generated;
+        loop->response_len = generated ? generated_len : 0;
+    } else {
+        loop->response     = loop->canned;
+        loop->response_len = loop->canned_len;
+    }
+
+    loop->response_pos = 0;
+    loop->exchanges++;
+    return 0;
+}
+
+static int loopback_recv(void* ctx, void* buffer, size_t len,
+                         int timeout_ms) {
+    Loopback* loop = ctx;
+    (void)timeout_ms;
+
+    if (!loop->connected || !buffer) {
+        return -1;
+    }
+
+    if (!loop->response) {
+        if (loop->request_len == 0) {
+            /* Nothing was asked for: behave like an idle peer */
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (produce_response(loop) != 0) {
+            errno = ECONNRESET;
+            return -1;
+        }
+    }
+
+    size_t remaining = loop->response_len - loop->response_pos;
+    size_t chunk     = remaining < len ? remaining : len;
+    memcpy(buffer, loop->response + loop->response_pos, chunk);
+    loop->response_pos += chunk;
+
+    return (int)chunk;
+}
+
+static void loopback_close(void* ctx) {
+    Loopback* loop = ctx;
+    reset_exchange(loop);
+    loop->connected = 0;
+}
+
+static void loopback_destroy(void* ctx) {
+    Loopback* loop = ctx;
+    reset_exchange(loop);
+    free(loop->request);
+    free(loop->canned);
+    free(loop);
+}
+
+static const TransportVTable LOOPBACK_VTABLE = {
+    loopback_connect, loopback_send,    loopback_recv,
+    loopback_close,   loopback_destroy, NULL,
+    NULL,
+};
+
+static Transport* wrap_loopback(Loopback* loop) {
+    Transport* transport = transport_create(&LOOPBACK_VTABLE, loop);
+    if (!transport) {
+        loopback_destroy(loop);
+        return NULL;
+    }
+    return transport;
+}
+
+Transport* transport_loopback_create(const char* response,
+                                     size_t      response_len) {
+    if (!response) {
+        return NULL;
+    }
+
+    Loopback* loop = calloc(1, sizeof(Loopback));
+    if (!loop) {
+        return NULL;
+    }
+
+    loop->canned = malloc(response_len > 0 ? response_len : 1);
+    if (!loop->canned) {
+        free(loop);
+        return NULL;
+    }
+    memcpy(loop->canned, response, response_len);
+    loop->canned_len = response_len;
+
+    return wrap_loopback(loop);
+}
+
+Transport* transport_loopback_create_handler(LoopbackHandler handler,
+                                             void*           user_data) {
+    if (!handler) {
+        return NULL;
+    }
+
+    Loopback* loop = calloc(1, sizeof(Loopback));
+    if (!loop) {
+        return NULL;
+    }
+
+    loop->handler   = handler;
+    loop->user_data = user_data;
+
+    return wrap_loopback(loop);
+}
+
+size_t transport_loopback_get_exchanges(const Transport* transport) {
+    if (!transport || transport->vtable != &LOOPBACK_VTABLE) {
+        return 0;
+    }
+    return ((const Loopback*)transport->ctx)->exchanges;
+}
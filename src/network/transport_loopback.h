@@ -0,0 +1,78 @@
+/**
+ * @file transport_loopback.h
+ * @brief In-process loopback transport for benchmarking and profiling
+ *
+ * The loopback transport implements the Transport interface without any
+ * system calls. Bytes written with transport_send() are collected as the
+ * request; the first transport_recv() after a request produces the response,
+ * either from a fixed canned buffer or from a user supplied handler, and
+ * serves it back in recv-sized pieces followed by end of stream.
+ *
+ * Typical use is to plug it into an HttpClient (http_client_set_transport())
+ * or a WeatherClient (weather_client_set_transport()) so that HTTP parsing,
+ * caching and JSON work can be measured without kernel networking noise.
+ */
+#ifndef TRANSPORT_LOOPBACK_H
+#define TRANSPORT_LOOPBACK_H
+
+#include "transport.h"
+
+#include <stddef.h>
+
+/**
+ * @brief Generates a raw HTTP response for a request
+ *
+ * @param request Raw request bytes as sent by the client (null-terminated)
+ * @param request_len Length of the request in bytes
+ * @param response Output: malloc'ed raw response (status line, headers and
+ *                 body). Ownership passes to the transport.
+ * @param response_len Output: length of *response in bytes
+ * @param user_data Pointer given at creation time
+ *
+ * @return 0 on success, -1 to make the exchange fail like a network error
+ */
+typedef int (*LoopbackHandler)(const char* request, size_t request_len,
+                               char** response, size_t* response_len,
+                               void* user_data);
+
+/**
+ * @brief Creates a loopback transport serving the same response every time
+ *
+ * @param response Raw HTTP response bytes; copied internally
+ * @param response_len Length of the response in bytes
+ *
+ * @return New transport, or NULL on invalid parameters or allocation failure
+ *
+ * @par Example:
+ * @code
+ * const char *canned = "HTTP/1.1 200 OK\r\n"
+ *                      "Content-Length: 16\r\n\r\n"
+ *                      "{\"success\":true}";
+ * Transport *loop = transport_loopback_create(canned, strlen(canned));
+ * http_client_set_transport(http, loop);
+ * @endcode
+ */
+Transport* transport_loopback_create(const char* response,
+                                     size_t      response_len);
+
+/**
+ * @brief Creates a loopback transport generating responses with a callback
+ *
+ * @param handler Callback invoked once per request
+ * @param user_data Opaque pointer handed to the callback
+ *
+ * @return New transport, or NULL on invalid parameters or allocation failure
+ */
+Transport* transport_loopback_create_handler(LoopbackHandler handler,
+                                             void*           user_data);
+
+/**
+ * @brief Number of request/response exchanges served so far
+ *
+ * @param transport A transport created by this module
+ *
+ * @return Exchange count, or 0 if transport is NULL
+ */
+size_t transport_loopback_get_exchanges(const Transport* transport);
+
+#endif
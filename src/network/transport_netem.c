@@ -0,0 +1,242 @@
+/**
+ * @file transport_netem.c
+ * @brief Network condition emulator implementation
+ *
+ * See transport_netem.h for detailed API documentation.
+ */
+#include "transport_netem.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    Transport*  inner;
+    NetemConfig config;
+    uint64_t    rng;
+    int         awaiting_response; /* a request was sent, no bytes read yet */
+    int         request_dropped;
+    long        pending_delay_ms;
+} Netem;
+
+static uint64_t next_random(Netem* netem) {
+    /* xorshift64*: tiny, fast and fully determined by the seed */
+    uint64_t x = netem->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    netem->rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double random_unit(Netem* netem) {
+    return (double)(next_random(netem) >> 11) / (double)(1ULL << 53);
+}
+
+static int chance(Netem* netem, double probability) {
+    return probability > 0.0 && random_unit(netem) < probability;
+}
+
+static void sleep_us(long long us) {
+    if (us <= 0) {
+        return;
+    }
+
+    struct timespec ts;
+    ts.tv_sec  = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static long sample_delay_ms(Netem* netem) {
+    long delay = netem->config.latency_ms;
+    if (netem->config.jitter_ms > 0) {
+        long span = 2L * netem->config.jitter_ms + 1;
+        delay += (long)(next_random(netem) % (uint64_t)span) -
+                 netem->config.jitter_ms;
+    }
+    return delay > 0 ? delay : 0;
+}
+
+static void throttle(Netem* netem, size_t bytes) {
+    if (netem->config.bandwidth_bps > 0) {
+        sleep_us((long long)bytes * 1000000 /
+                 (long long)netem->config.bandwidth_bps);
+    }
+}
+
+static int netem_connect(void* ctx, const char* host, int port,
+                         int timeout_ms) {
+    Netem* netem = ctx;
+
+    netem->awaiting_response = 0;
+    netem->request_dropped   = 0;
+    netem->pending_delay_ms  = 0;
+
+    long delay = sample_delay_ms(netem);
+    if (delay > timeout_ms) {
+        sleep_us((long long)timeout_ms * 1000);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    sleep_us((long long)delay * 1000);
+
+    return transport_connect(netem->inner, host, port, timeout_ms);
+}
+
+static int netem_send(void* ctx, const void* data, size_t len) {
+    Netem* netem = ctx;
+
+    throttle(netem, len);
+    if (transport_send(netem->inner, data, len) != 0) {
+        return -1;
+    }
+
+    netem->awaiting_response = 1;
+    netem->request_dropped   = chance(netem, netem->config.drop_probability);
+    netem->pending_delay_ms  = sample_delay_ms(netem);
+    return 0;
+}
+
+static int netem_recv(void* ctx, void* buffer, size_t len, int timeout_ms) {
+    Netem* netem = ctx;
+
+    if (netem->request_dropped) {
+        sleep_us((long long)timeout_ms * 1000);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    if (netem->awaiting_response) {
+        if (netem->pending_delay_ms > timeout_ms) {
+            sleep_us((long long)timeout_ms * 1000);
+            netem->pending_delay_ms -= timeout_ms;
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        sleep_us((long long)netem->pending_delay_ms * 1000);
+        netem->pending_delay_ms  = 0;
+        netem->awaiting_response = 0;
+    }
+
+    if (chance(netem, netem->config.reset_probability)) {
+        transport_close(netem->inner);
+        errno = ECONNRESET;
+        return -1;
+    }
+
+    size_t want = len;
+    if (netem->config.partial_read_max > 0 && want > 1) {
+        size_t cap = netem->config.partial_read_max < want
+                         ? netem->config.partial_read_max
+                         : want;
+        want       = 1 + (size_t)(next_random(netem) % cap);
+    }
+
+    int received = transport_recv(netem->inner, buffer, want, timeout_ms);
+    if (received > 0) {
+        throttle(netem, (size_t)received);
+    }
+    return received;
+}
+
+static void netem_close(void* ctx) {
+    Netem* netem = ctx;
+    transport_close(netem->inner);
+    netem->awaiting_response = 0;
+    netem->request_dropped   = 0;
+}
+
+static void netem_destroy(void* ctx) {
+    Netem* netem = ctx;
+    transport_destroy(netem->inner);
+    free(netem);
+}
+
+static int netem_get_info(void* ctx, ClientTCPInfo* info) {
+    Netem* netem = ctx;
+    return transport_get_info(netem->inner, info);
+}
+
+static const TransportVTable NETEM_VTABLE = {
+    netem_connect, netem_send,    netem_recv,
+    netem_close,   netem_destroy, netem_get_info,
+    NULL,
+};
+
+int transport_netem_parse(const char* spec, NetemConfig* config) {
+    if (!spec || !config) {
+        return -1;
+    }
+
+    memset(config, 0, sizeof(NetemConfig));
+
+    const char* cursor = spec;
+    while (*cursor) {
+        const char* eq = strchr(cursor, '=');
+        if (!eq) {
+            return -1;
+        }
+
+        size_t name_len = eq - cursor;
+        char*  end      = NULL;
+        double value    = strtod(eq + 1, &end);
+        if (end == eq + 1 || (*end != ',' && *end != '\0') || value < 0) {
+            return -1;
+        }
+
+        if (name_len == 7 && strncmp(cursor, "latency", 7) == 0) {
+            config->latency_ms = (int)value;
+        } else if (name_len == 6 && strncmp(cursor, "jitter", 6) == 0) {
+            config->jitter_ms = (int)value;
+        } else if (name_len == 9 && strncmp(cursor, "bandwidth", 9) == 0) {
+            config->bandwidth_bps = (size_t)value;
+        } else if (name_len == 7 && strncmp(cursor, "partial", 7) == 0) {
+            config->partial_read_max = (size_t)value;
+        } else if (name_len == 5 && strncmp(cursor, "reset", 5) == 0) {
+            config->reset_probability = value;
+        } else if (name_len == 4 && strncmp(cursor, "drop", 4) == 0) {
+            config->drop_probability = value;
+        } else if (name_len == 4 && strncmp(cursor, "seed", 4) == 0) {
+            config->seed = strtoull(eq + 1, NULL, 10);
+        } else {
+            return -1;
+        }
+
+        cursor = *end == ',' ? end + 1 : end;
+    }
+
+    if (config->reset_probability > 1.0 || config->drop_probability > 1.0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+Transport* transport_netem_create(Transport* inner, const NetemConfig* config) {
+    if (!inner || !config) {
+        transport_destroy(inner);
+        return NULL;
+    }
+
+    Netem* netem = calloc(1, sizeof(Netem));
+    if (!netem) {
+        transport_destroy(inner);
+        return NULL;
+    }
+
+    /* xorshift must never be seeded with zero */
+    netem->inner  = inner;
+    netem->config = *config;
+    netem->rng    = config->seed ? config->seed : 0x9E3779B97F4A7C15ULL;
+
+    Transport* transport = transport_create(&NETEM_VTABLE, netem);
+    if (!transport) {
+        netem_destroy(netem);
+        return NULL;
+    }
+
+    return transport;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file transport_netem.h
+ * @brief Network condition emulator layered over another transport
+ *
+ * The netem transport wraps an existing Transport (normally the ClientTCP
+ * one) and injects bad-link behaviour: added latency with jitter, a
+ * bandwidth cap, partial reads, connection resets and lost requests. All
+ * random decisions come from a seeded PRNG, so a given seed reproduces the
+ * same sequence of faults, which makes timeout, retry and caching behaviour
+ * testable and benchmarkable on a single machine without a real WAN.
+ *
+ * Fault model:
+ * - Latency/jitter: applied to connect and to the first read of every
+ *   response. If the delay exceeds the read timeout, the read fails with
+ *   ETIMEDOUT and the remaining delay carries over to the next read.
+ * - Bandwidth: every send/recv sleeps for the time the bytes would take
+ *   on a link of the configured rate.
+ * - Partial reads: each recv returns a random 1..partial_read_max bytes.
+ * - Reset: each recv fails with ECONNRESET with the given probability.
+ * - Drop: each request is lost with the given probability; the following
+ *   recv waits for its full timeout and fails with ETIMEDOUT.
+ */
+#ifndef TRANSPORT_NETEM_H
+#define TRANSPORT_NETEM_H
+
+#include "transport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct NetemConfig
+ * @brief Emulated link properties (all zero = transparent pass-through)
+ */
+typedef struct {
+    int      latency_ms;        /**< One-way delay added per exchange */
+    int      jitter_ms;         /**< Uniform +/- variation of the delay */
+    size_t   bandwidth_bps;     /**< Link rate in bytes/second, 0 = no cap */
+    size_t   partial_read_max;  /**< Max bytes per recv, 0 = no limit */
+    double   reset_probability; /**< Chance a recv resets the connection */
+    double   drop_probability;  /**< Chance a request is lost */
+    uint64_t seed;              /**< PRNG seed for reproducible runs */
+} NetemConfig;
+
+/**
+ * @brief Parses a comma separated "name=value" fault specification
+ *
+ * Recognised names: latency, jitter (milliseconds), bandwidth (bytes per
+ * second), partial (max bytes per read), reset, drop (probabilities in
+ * [0, 1]) and seed. Unspecified fields are zero.
+ *
+ * @param spec Specification string, e.g. "latency=80,jitter=20,drop=0.05"
+ * @param config Output configuration
+ *
+ * @return 0 on success, -1 on unknown names or invalid values
+ *
+ * @par Example:
+ * @code
+ * NetemConfig config;
+ * if (transport_netem_parse("latency=100,reset=0.01,seed=7", &config) == 0) {
+ *     Transport *slow = transport_netem_create(transport_tcp_create(),
+ *                                              &config);
+ * }
+ * @endcode
+ */
+int transport_netem_parse(const char* spec, NetemConfig* config);
+
+/**
+ * @brief Wraps a transport with the emulated network conditions
+ *
+ * @param inner Transport carrying the real traffic (ownership transferred,
+ *              destroyed on failure)
+ * @param config Link properties (copied)
+ *
+ * @return New transport, or NULL on invalid parameters or allocation failure
+ */
+Transport* transport_netem_create(Transport* inner, const NetemConfig* config);
+
+#endif
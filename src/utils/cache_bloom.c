@@ -0,0 +1,265 @@
+/**
+ * @file cache_bloom.c
+ * @brief Files store Bloom filter implementation
+ *
+ * See cache_bloom.h for detailed API documentation.
+ */
+#include "cache_bloom.h"
+
+#include "cache_index.h"
+#include "file_lock.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOOM_MAGIC "JWCB"
+#define BLOOM_VERSION 1
+#define BLOOM_WORDS (CACHE_BLOOM_BITS / 64)
+#define BLOOM_FILE_SIZE (sizeof(BloomHeader) + BLOOM_WORDS * sizeof(uint64_t))
+
+/* Shared filter: this header followed by BLOOM_WORDS words of bits */
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t bits;
+    uint64_t keys;       /* names added since the last reset or rebuild */
+    uint64_t rebuild_at; /* keys worth a rebuild */
+} BloomHeader;
+
+struct CacheBloom {
+    int             fd;
+    BloomHeader*    header; /* shared mapping of the filter file */
+    FileLock        lock;
+};
+
+/* A rebuild in progress: the private bit array and its name count */
+typedef struct {
+    uint64_t* words;
+    uint64_t  keys;
+} BloomBuild;
+
+static uint64_t* words(const CacheBloom* bloom) {
+    return (uint64_t*)(bloom->header + 1);
+}
+
+/* The name already is a 128-bit hash: its halves drive double hashing */
+static int name_hashes(const char* name, uint64_t hashes[2]) {
+    if (!name) {
+        return -1;
+    }
+
+    hashes[0] = 0;
+    hashes[1] = 0;
+    for (int i = 0; i < CACHE_INDEX_NAME_LENGTH; i++) {
+        char     c = name[i];
+        uint64_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = (uint64_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = (uint64_t)(c - 'a' + 10);
+        } else {
+            return -1;
+        }
+        hashes[i / 16] = (hashes[i / 16] << 4) | digit;
+    }
+    hashes[1] |= 1; /* odd, so the probes cover the whole array */
+    return 0;
+}
+
+static uint64_t probe(const uint64_t hashes[2], int i) {
+    return (hashes[0] + (uint64_t)i * hashes[1]) & (CACHE_BLOOM_BITS - 1);
+}
+
+static void set_bits(uint64_t* bits, const uint64_t hashes[2]) {
+    for (int i = 0; i < CACHE_BLOOM_HASHES; i++) {
+        uint64_t bit = probe(hashes, i);
+        __atomic_fetch_or(&bits[bit / 64], 1ULL << (bit % 64),
+                          __ATOMIC_RELAXED);
+    }
+}
+
+static void reset_bloom(CacheBloom* bloom) {
+    memset(words(bloom), 0, BLOOM_WORDS * sizeof(uint64_t));
+    bloom->header->keys       = 0;
+    bloom->header->rebuild_at = CACHE_BLOOM_KEYS;
+}
+
+CacheBloom* cache_bloom_open(const char* path, int* created) {
+    if (!path) {
+        return NULL;
+    }
+
+    CacheBloom* bloom = calloc(1, sizeof(CacheBloom));
+    if (!bloom) {
+        return NULL;
+    }
+
+    bloom->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (bloom->fd < 0) {
+        free(bloom);
+        return NULL;
+    }
+
+    file_lock_init(&bloom->lock, bloom->fd);
+    if (file_lock_acquire(&bloom->lock, LOCK_EX) != 0) {
+        close(bloom->fd);
+        file_lock_destroy(&bloom->lock);
+        free(bloom);
+        return NULL;
+    }
+
+    /* The filter never changes size, so one mapping serves for good */
+    struct stat bloom_stat;
+    int         fresh = fstat(bloom->fd, &bloom_stat) != 0 ||
+                bloom_stat.st_size != (off_t)BLOOM_FILE_SIZE;
+    int         ok    = 1;
+    if (fresh && (ftruncate(bloom->fd, 0) != 0 ||
+                  ftruncate(bloom->fd, BLOOM_FILE_SIZE) != 0)) {
+        ok = 0;
+    }
+    if (ok) {
+        void* map = mmap(NULL, BLOOM_FILE_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, bloom->fd, 0);
+        ok        = map != MAP_FAILED;
+        if (ok) {
+            bloom->header = map;
+        }
+    }
+
+    if (ok && !fresh) {
+        BloomHeader* header = bloom->header;
+        fresh =
+            memcmp(header->magic, BLOOM_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != BLOOM_VERSION ||
+            header->bits != CACHE_BLOOM_BITS;
+    }
+    if (ok && fresh) {
+        BloomHeader* header = bloom->header;
+        memcpy(header->magic, BLOOM_MAGIC, sizeof(header->magic));
+        header->version = BLOOM_VERSION;
+        header->bits    = CACHE_BLOOM_BITS;
+        reset_bloom(bloom);
+    }
+
+    file_lock_release(&bloom->lock);
+
+    if (!ok) {
+        cache_bloom_close(bloom);
+        return NULL;
+    }
+
+    if (created) {
+        *created = fresh;
+    }
+    return bloom;
+}
+
+void cache_bloom_close(CacheBloom* bloom) {
+    if (!bloom) {
+        return;
+    }
+
+    if (bloom->header) {
+        munmap(bloom->header, BLOOM_FILE_SIZE);
+    }
+    close(bloom->fd);
+    file_lock_destroy(&bloom->lock);
+    free(bloom);
+}
+
+void cache_bloom_add(CacheBloom* bloom, const char* name) {
+    uint64_t hashes[2];
+    if (!bloom || name_hashes(name, hashes) != 0 ||
+        file_lock_acquire(&bloom->lock, LOCK_SH) != 0) {
+        return;
+    }
+
+    /* Shared lock: adders only set bits, a rebuild must not interleave */
+    set_bits(words(bloom), hashes);
+    __atomic_fetch_add(&bloom->header->keys, 1, __ATOMIC_RELAXED);
+
+    file_lock_release(&bloom->lock);
+}
+
+int cache_bloom_may_contain(const CacheBloom* bloom, const char* name) {
+    uint64_t hashes[2];
+    if (!bloom || name_hashes(name, hashes) != 0) {
+        return 1;
+    }
+
+    const uint64_t* bits = words(bloom);
+    for (int i = 0; i < CACHE_BLOOM_HASHES; i++) {
+        uint64_t bit  = probe(hashes, i);
+        uint64_t word = __atomic_load_n(&bits[bit / 64], __ATOMIC_RELAXED);
+        if (!(word & (1ULL << (bit % 64)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void cache_bloom_reset(CacheBloom* bloom) {
+    if (!bloom || file_lock_acquire(&bloom->lock, LOCK_EX) != 0) {
+        return;
+    }
+
+    reset_bloom(bloom);
+    file_lock_release(&bloom->lock);
+}
+
+int cache_bloom_should_rebuild(const CacheBloom* bloom) {
+    if (!bloom) {
+        return 0;
+    }
+    return __atomic_load_n(&bloom->header->keys, __ATOMIC_RELAXED) >=
+           __atomic_load_n(&bloom->header->rebuild_at, __ATOMIC_RELAXED);
+}
+
+static void build_add(const char* name, void* add_data) {
+    BloomBuild* build = add_data;
+    uint64_t    hashes[2];
+    if (name_hashes(name, hashes) == 0) {
+        set_bits(build->words, hashes);
+        build->keys++;
+    }
+}
+
+int cache_bloom_rebuild(CacheBloom* bloom, CacheBloomSource source,
+                        void* user_data) {
+    if (!bloom || !source) {
+        return -1;
+    }
+
+    BloomBuild build = {calloc(BLOOM_WORDS, sizeof(uint64_t)), 0};
+    if (!build.words) {
+        return -1;
+    }
+    if (file_lock_acquire(&bloom->lock, LOCK_EX) != 0) {
+        free(build.words);
+        return -1;
+    }
+
+    source(build_add, &build, user_data);
+
+    /* Word by word: a bit that is set in both arrays never reads as clear,
+     * so lock-free queries for listed names keep succeeding throughout */
+    uint64_t* bits = words(bloom);
+    for (size_t i = 0; i < BLOOM_WORDS; i++) {
+        __atomic_store_n(&bits[i], build.words[i], __ATOMIC_RELAXED);
+    }
+
+    /* A filter full of live names would otherwise be rebuilt every time */
+    bloom->header->keys       = build.keys;
+    bloom->header->rebuild_at = build.keys * 2 > CACHE_BLOOM_KEYS
+                                    ? build.keys * 2
+                                    : CACHE_BLOOM_KEYS;
+
+    file_lock_release(&bloom->lock);
+    free(build.words);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file cache_bloom.h
+ * @brief Persistent Bloom filter of the files store
+ *
+ * Most lookups that miss in memory are for keys that were never stored,
+ * and the files store can only tell by trying to open a file. This filter
+ * records the name of every file written, in a memory-mapped bit array
+ * that every process using the cache directory shares, so that a definite
+ * miss costs a few memory loads instead of a system call.
+ *
+ * Features:
+ * - Lock-free queries: a handful of bit tests in the shared mapping
+ * - Adds are atomic bit sets, safe between processes and threads
+ * - No false negatives; about 1% false positives at the design load
+ * - Rebuildable from the files index: deleted and expired files leave
+ *   their bits set, so the filter is rebuilt once enough keys were added
+ *   since the last rebuild
+ *
+ * Like cache_index.h, the filter is keyed by the 32-hex-digit file name
+ * stem, which already is a 128-bit hash of the key.
+ */
+#ifndef CACHE_BLOOM_H
+#define CACHE_BLOOM_H
+
+#define CACHE_BLOOM_BITS (1u << 20) ///< Filter size, 128 KiB
+#define CACHE_BLOOM_HASHES 7        ///< Bits set per name
+#define CACHE_BLOOM_KEYS (CACHE_BLOOM_BITS / 10) ///< Design load
+
+/**
+ * @struct CacheBloom
+ * @brief Open filter (opaque)
+ */
+typedef struct CacheBloom CacheBloom;
+
+/**
+ * @brief Receives one name while a filter is rebuilt
+ *
+ * @param name File name stem (CACHE_INDEX_NAME_LENGTH hex digits)
+ * @param add_data As passed to the CacheBloomSource
+ */
+typedef void (*CacheBloomAdd)(const char* name, void* add_data);
+
+/**
+ * @brief Lists every name the rebuilt filter must contain
+ *
+ * Called with the filter locked: it must call add for each name and must
+ * not call back into the filter.
+ *
+ * @param add Adds one name to the filter being built
+ * @param add_data Passed through to add
+ * @param user_data As passed to cache_bloom_rebuild()
+ */
+typedef void (*CacheBloomSource)(CacheBloomAdd add, void* add_data,
+                                 void* user_data);
+
+/**
+ * @brief Opens (creating if needed) a filter file
+ *
+ * A filter that is missing, truncated or of another format is recreated
+ * empty and *created is set; the caller must then rebuild it before
+ * trusting a negative answer.
+ *
+ * @param path Filter file path
+ * @param created Output: 1 if the filter was (re)created empty, else 0
+ *
+ * @return Open filter, or NULL on failure
+ */
+CacheBloom* cache_bloom_open(const char* path, int* created);
+
+/**
+ * @brief Closes the filter (safe to call with NULL)
+ */
+void cache_bloom_close(CacheBloom* bloom);
+
+/**
+ * @brief Records a name
+ *
+ * @param bloom Open filter
+ * @param name File name stem, CACHE_INDEX_NAME_LENGTH hex digits
+ */
+void cache_bloom_add(CacheBloom* bloom, const char* name);
+
+/**
+ * @brief Tests a name without taking any lock
+ *
+ * @param bloom Open filter, or NULL
+ * @param name File name stem
+ *
+ * @return 0 if the name was certainly never added since the last reset or
+ *         rebuild, 1 if it may have been (always 1 for a NULL filter or an
+ *         invalid name)
+ */
+int cache_bloom_may_contain(const CacheBloom* bloom, const char* name);
+
+/**
+ * @brief Forgets every name
+ */
+void cache_bloom_reset(CacheBloom* bloom);
+
+/**
+ * @brief Whether enough names were added since the last rebuild that
+ *        stale bits are worth clearing
+ */
+int cache_bloom_should_rebuild(const CacheBloom* bloom);
+
+/**
+ * @brief Replaces the filter contents with the names a source lists
+ *
+ * The new bit array is built privately and copied over the shared one,
+ * so concurrent queries for names in the source never miss.
+ *
+ * @param bloom Open filter
+ * @param source Lists the names to keep
+ * @param user_data Passed through to source
+ *
+ * @return 0 on success, -1 on failure (the filter is left as it was)
+ */
+int cache_bloom_rebuild(CacheBloom* bloom, CacheBloomSource source,
+                        void* user_data);
+
+#endif
@@ -0,0 +1,481 @@
+/**
+ * @file cache_index.c
+ * @brief Files store index implementation
+ *
+ * See cache_index.h for detailed API documentation.
+ */
+#include "cache_index.h"
+
+#include "file_lock.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC "JWCF"
+#define INDEX_VERSION 2
+#define INDEX_INITIAL_SLOTS 1024
+
+#define SLOT_EMPTY 0
+#define SLOT_TOMBSTONE 1
+
+/* Shared index: this header followed by capacity slots */
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t capacity; /* slots, power of two */
+    uint64_t used;     /* live slots */
+    uint64_t tombstones;
+    uint64_t bytes;  /* sum of the sizes of live slots */
+    uint64_t cursor; /* next slot the sweep visits */
+    uint64_t epoch;  /* slots of other epochs are retired */
+} IndexHeader;
+
+typedef struct {
+    uint64_t hash; /* SLOT_EMPTY, SLOT_TOMBSTONE or taken from the name */
+    uint64_t bytes;
+    int64_t  expires_at;
+    uint64_t epoch;
+    char     name[CACHE_INDEX_NAME_LENGTH]; /* not NUL-terminated */
+} IndexSlot;
+
+/* A visited slot the sweep may remove to get under quota */
+typedef struct {
+    int64_t  expires_at;
+    uint64_t slot;
+} Candidate;
+
+struct CacheIndex {
+    int             fd;
+    IndexHeader*    header; /* shared mapping of the index file */
+    size_t          mapped; /* bytes currently mapped */
+    FileLock        lock;
+};
+
+static IndexSlot* slots(CacheIndex* index) {
+    return (IndexSlot*)(index->header + 1);
+}
+
+static size_t index_size(uint64_t capacity) {
+    return sizeof(IndexHeader) + capacity * sizeof(IndexSlot);
+}
+
+static int valid_name(const char* name) {
+    if (!name) {
+        return 0;
+    }
+    for (int i = 0; i < CACHE_INDEX_NAME_LENGTH; i++) {
+        char c = name[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* The name already is a hash; its first 16 digits serve as the slot hash */
+static uint64_t name_hash(const char* name) {
+    uint64_t hash = 0;
+    for (int i = 0; i < 16; i++) {
+        char c = name[i];
+        hash   = (hash << 4) | (uint64_t)(c <= '9' ? c - '0' : c - 'a' + 10);
+    }
+    return hash <= SLOT_TOMBSTONE ? hash + 2 : hash;
+}
+
+static int map_index(CacheIndex* index) {
+    struct stat index_stat;
+    if (fstat(index->fd, &index_stat) != 0) {
+        return -1;
+    }
+
+    void* map = mmap(NULL, (size_t)index_stat.st_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, index->fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    if (index->header) {
+        munmap(index->header, index->mapped);
+    }
+    index->header = map;
+    index->mapped = (size_t)index_stat.st_size;
+    return 0;
+}
+
+static void reset_index(CacheIndex* index) {
+    memset(slots(index), 0, index->header->capacity * sizeof(IndexSlot));
+    index->header->used       = 0;
+    index->header->tombstones = 0;
+    index->header->bytes      = 0;
+    index->header->cursor     = 0;
+}
+
+static int init_index(CacheIndex* index) {
+    if (ftruncate(index->fd, 0) != 0 ||
+        ftruncate(index->fd, index_size(INDEX_INITIAL_SLOTS)) != 0 ||
+        map_index(index) != 0) {
+        return -1;
+    }
+
+    memcpy(index->header->magic, INDEX_MAGIC, sizeof(index->header->magic));
+    index->header->version  = INDEX_VERSION;
+    index->header->capacity = INDEX_INITIAL_SLOTS;
+    reset_index(index);
+    return 0;
+}
+
+static int index_valid(const CacheIndex* index) {
+    const IndexHeader* header = index->header;
+    uint64_t           cap    = header->capacity;
+    return index->mapped >= sizeof(IndexHeader) &&
+           memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == INDEX_VERSION && cap > 0 &&
+           (cap & (cap - 1)) == 0 && index->mapped >= index_size(cap);
+}
+
+/* Takes the index lock and remaps if another process grew the table */
+static int lock_index(CacheIndex* index, int operation) {
+    if (file_lock_acquire(&index->lock, operation) != 0) {
+        return -1;
+    }
+
+    if (index->mapped < index_size(index->header->capacity) &&
+        map_index(index) != 0) {
+        file_lock_release(&index->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void unlock_index(CacheIndex* index) {
+    file_lock_release(&index->lock);
+}
+
+static IndexSlot* find_name(CacheIndex* index, const char* name) {
+    uint64_t   hash = name_hash(name);
+    uint64_t   mask = index->header->capacity - 1;
+    IndexSlot* all  = slots(index);
+
+    for (uint64_t i = hash & mask;; i = (i + 1) & mask) {
+        if (all[i].hash == SLOT_EMPTY) {
+            return NULL;
+        }
+        if (all[i].hash == hash &&
+            memcmp(all[i].name, name, CACHE_INDEX_NAME_LENGTH) == 0) {
+            return &all[i];
+        }
+    }
+}
+
+static void kill_slot(CacheIndex* index, IndexSlot* slot) {
+    index->header->bytes -= slot->bytes;
+    index->header->used--;
+    index->header->tombstones++;
+    slot->hash = SLOT_TOMBSTONE;
+}
+
+static int rehash(CacheIndex* index, uint64_t capacity) {
+    uint64_t   old_capacity = index->header->capacity;
+    IndexSlot* live = malloc(index->header->used * sizeof(IndexSlot));
+    if (index->header->used > 0 && !live) {
+        return -1;
+    }
+
+    size_t count = 0;
+    for (uint64_t i = 0; i < old_capacity; i++) {
+        IndexSlot* slot = &slots(index)[i];
+        if (slot->hash > SLOT_TOMBSTONE) {
+            live[count++] = *slot;
+        }
+    }
+
+    /* The file only ever grows, so other mappings never lose pages */
+    if (capacity > old_capacity &&
+        (ftruncate(index->fd, index_size(capacity)) != 0 ||
+         map_index(index) != 0)) {
+        free(live);
+        return -1;
+    }
+
+    index->header->capacity   = capacity;
+    index->header->tombstones = 0;
+    index->header->cursor     = 0;
+    memset(slots(index), 0, capacity * sizeof(IndexSlot));
+
+    uint64_t mask = capacity - 1;
+    for (size_t n = 0; n < count; n++) {
+        uint64_t i = live[n].hash & mask;
+        while (slots(index)[i].hash != SLOT_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        slots(index)[i] = live[n];
+    }
+
+    free(live);
+    return 0;
+}
+
+static int reserve_slot(CacheIndex* index) {
+    IndexHeader* header = index->header;
+    if ((header->used + header->tombstones + 1) * 4 <= header->capacity * 3) {
+        return 0;
+    }
+
+    uint64_t capacity = header->capacity;
+    if ((header->used + 1) * 2 > capacity) {
+        capacity *= 2;
+    }
+    return rehash(index, capacity);
+}
+
+CacheIndex* cache_index_open(const char* path, int* created) {
+    if (!path) {
+        return NULL;
+    }
+
+    CacheIndex* index = calloc(1, sizeof(CacheIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    index->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (index->fd < 0) {
+        free(index);
+        return NULL;
+    }
+
+    file_lock_init(&index->lock, index->fd);
+    if (file_lock_acquire(&index->lock, LOCK_EX) != 0) {
+        close(index->fd);
+        file_lock_destroy(&index->lock);
+        free(index);
+        return NULL;
+    }
+
+    struct stat index_stat;
+    int         ok    = fstat(index->fd, &index_stat) == 0;
+    int         fresh = 1;
+    if (ok && index_stat.st_size >= (off_t)index_size(INDEX_INITIAL_SLOTS)) {
+        ok    = map_index(index) == 0;
+        fresh = ok && !index_valid(index);
+    }
+    if (ok && fresh) {
+        ok = init_index(index) == 0;
+    }
+
+    file_lock_release(&index->lock);
+
+    if (!ok) {
+        cache_index_close(index);
+        return NULL;
+    }
+
+    if (created) {
+        *created = fresh;
+    }
+    return index;
+}
+
+void cache_index_close(CacheIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    if (index->header) {
+        munmap(index->header, index->mapped);
+    }
+    close(index->fd);
+    file_lock_destroy(&index->lock);
+    free(index);
+}
+
+int cache_index_put(CacheIndex* index, const char* name, uint64_t bytes,
+                    int64_t expires_at) {
+    if (!index || !valid_name(name) || lock_index(index, LOCK_EX) != 0) {
+        return -1;
+    }
+
+    IndexSlot* slot = find_name(index, name);
+    if (slot) {
+        index->header->bytes -= slot->bytes;
+    } else if (reserve_slot(index) != 0) {
+        unlock_index(index);
+        return -1;
+    } else {
+        uint64_t hash = name_hash(name);
+        uint64_t mask = index->header->capacity - 1;
+        uint64_t i    = hash & mask;
+        while (slots(index)[i].hash > SLOT_TOMBSTONE) {
+            i = (i + 1) & mask;
+        }
+
+        slot = &slots(index)[i];
+        if (slot->hash == SLOT_TOMBSTONE) {
+            index->header->tombstones--;
+        }
+        index->header->used++;
+        slot->hash = hash;
+        memcpy(slot->name, name, CACHE_INDEX_NAME_LENGTH);
+    }
+
+    slot->bytes      = bytes;
+    slot->expires_at = expires_at;
+    slot->epoch      = index->header->epoch;
+    index->header->bytes += bytes;
+
+    unlock_index(index);
+    return 0;
+}
+
+void cache_index_remove(CacheIndex* index, const char* name) {
+    if (!index || !valid_name(name) || lock_index(index, LOCK_EX) != 0) {
+        return;
+    }
+
+    IndexSlot* slot = find_name(index, name);
+    if (slot) {
+        kill_slot(index, slot);
+    }
+
+    unlock_index(index);
+}
+
+void cache_index_clear(CacheIndex* index) {
+    if (!index || lock_index(index, LOCK_EX) != 0) {
+        return;
+    }
+
+    reset_index(index);
+    unlock_index(index);
+}
+
+void cache_index_retire_all(CacheIndex* index) {
+    if (!index || lock_index(index, LOCK_EX) != 0) {
+        return;
+    }
+
+    index->header->epoch++;
+    unlock_index(index);
+}
+
+static int by_expiry(const void* a, const void* b) {
+    const Candidate* left  = a;
+    const Candidate* right = b;
+    return (left->expires_at > right->expires_at) -
+           (left->expires_at < right->expires_at);
+}
+
+static void evict_slot(CacheIndex* index, IndexSlot* slot,
+                       CacheIndexEvict evict, void* user_data) {
+    char name[CACHE_INDEX_NAME_LENGTH + 1];
+    memcpy(name, slot->name, CACHE_INDEX_NAME_LENGTH);
+    name[CACHE_INDEX_NAME_LENGTH] = '\0';
+    kill_slot(index, slot);
+    if (evict) {
+        evict(name, user_data);
+    }
+}
+
+int cache_index_sweep(CacheIndex* index, size_t max_slots, uint64_t quota,
+                      CacheIndexEvict evict, void* user_data) {
+    if (!index || lock_index(index, LOCK_EX) != 0) {
+        return -1;
+    }
+
+    IndexHeader* header = index->header;
+    uint64_t     mask   = header->capacity - 1;
+    if (max_slots > header->capacity) {
+        max_slots = header->capacity;
+    }
+
+    Candidate* candidates = quota ? malloc(max_slots * sizeof(Candidate))
+                                  : NULL;
+    size_t     count      = 0;
+    int        removed    = 0;
+    int64_t    now        = (int64_t)time(NULL);
+    uint64_t   cursor     = header->cursor & mask;
+
+    for (size_t n = 0; n < max_slots; n++) {
+        uint64_t   i    = (cursor + n) & mask;
+        IndexSlot* slot = &slots(index)[i];
+        if (slot->hash <= SLOT_TOMBSTONE) {
+            continue;
+        }
+        if (slot->expires_at < now || slot->epoch != header->epoch) {
+            evict_slot(index, slot, evict, user_data);
+            removed++;
+        } else if (candidates) {
+            candidates[count].expires_at = slot->expires_at;
+            candidates[count].slot       = i;
+            count++;
+        }
+    }
+    header->cursor = (cursor + max_slots) & mask;
+
+    /* Over quota: the visited files closest to expiry go first, which
+     * approximates expiry order across a full cycle of steps */
+    if (candidates && header->bytes > quota) {
+        qsort(candidates, count, sizeof(Candidate), by_expiry);
+        for (size_t n = 0; n < count && header->bytes > quota; n++) {
+            evict_slot(index, &slots(index)[candidates[n].slot], evict,
+                       user_data);
+            removed++;
+        }
+    }
+    free(candidates);
+
+    if (header->tombstones > header->capacity / 4) {
+        rehash(index, header->capacity);
+    }
+
+    unlock_index(index);
+    return removed;
+}
+
+int cache_index_for_each(CacheIndex* index, CacheIndexVisit visit,
+                         void* user_data) {
+    if (!index || !visit || lock_index(index, LOCK_SH) != 0) {
+        return -1;
+    }
+
+    IndexHeader* header = index->header;
+    int64_t      now    = (int64_t)time(NULL);
+    for (uint64_t i = 0; i < header->capacity; i++) {
+        IndexSlot* slot = &slots(index)[i];
+        if (slot->hash <= SLOT_TOMBSTONE || slot->expires_at < now ||
+            slot->epoch != header->epoch) {
+            continue;
+        }
+
+        char name[CACHE_INDEX_NAME_LENGTH + 1];
+        memcpy(name, slot->name, CACHE_INDEX_NAME_LENGTH);
+        name[CACHE_INDEX_NAME_LENGTH] = '\0';
+        visit(name, user_data);
+    }
+
+    unlock_index(index);
+    return 0;
+}
+
+void cache_index_get_stats(CacheIndex* index, CacheIndexStats* stats) {
+    if (!index || !stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(CacheIndexStats));
+    if (lock_index(index, LOCK_SH) != 0) {
+        return;
+    }
+
+    stats->entries = index->header->used;
+    stats->bytes   = index->header->bytes;
+    stats->slots   = index->header->capacity;
+
+    unlock_index(index);
+}
@@ -0,0 +1,160 @@
+/**
+ * @file cache_index.h
+ * @brief Persistent size and expiry index of the files store
+ *
+ * The files store keeps one file per cache entry. This index records, per
+ * file, its size and expiry time in a small memory-mapped hash table that
+ * every process using the cache directory shares. It lets a garbage
+ * collector enforce a disk quota and remove expired files in short,
+ * bounded steps without ever listing the directory.
+ *
+ * Features:
+ * - O(1) insert and remove, kept up to date by every write and delete
+ * - Running total of the bytes held, so the quota check is one load
+ * - Incremental sweep: each call visits a fixed number of slots from a
+ *   cursor stored in the index, removes expired files and, while over
+ *   quota, the visited files that expire soonest
+ * - O(1) retirement of every file: the sweep removes them over time
+ * - Safe to share between processes and threads: operations hold an
+ *   flock() on the index plus a mutex, and processes notice index growth
+ *
+ * Entries are identified by the 32-hex-digit file name stem; the index
+ * does not know the keys. A file written before the index existed, or by
+ * a process that died between writing the file and updating the index, is
+ * unknown to it; cache_index_open() reports a newly created index so the
+ * caller can import the directory once.
+ */
+#ifndef CACHE_INDEX_H
+#define CACHE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_INDEX_NAME_LENGTH 32 ///< Hex digits of an indexed file name
+
+/**
+ * @struct CacheIndex
+ * @brief Open index (opaque)
+ */
+typedef struct CacheIndex CacheIndex;
+
+/**
+ * @struct CacheIndexStats
+ * @brief Space accounting of the index
+ */
+typedef struct {
+    size_t   entries; /**< Files indexed */
+    uint64_t bytes;   /**< Total size of the indexed files */
+    size_t   slots;   /**< Table size; one sweep cycle visits all slots */
+} CacheIndexStats;
+
+/**
+ * @brief Removes the file of an entry the sweep dropped
+ *
+ * Called with the index locked: it must not call back into the index.
+ *
+ * @param name File name stem (CACHE_INDEX_NAME_LENGTH hex digits + NUL)
+ * @param user_data As passed to cache_index_sweep()
+ */
+typedef void (*CacheIndexEvict)(const char* name, void* user_data);
+
+/**
+ * @brief Receives one indexed file name from cache_index_for_each()
+ *
+ * Called with the index locked: it must not call back into the index.
+ *
+ * @param name File name stem (CACHE_INDEX_NAME_LENGTH hex digits + NUL)
+ * @param user_data As passed to cache_index_for_each()
+ */
+typedef void (*CacheIndexVisit)(const char* name, void* user_data);
+
+/**
+ * @brief Opens (creating if needed) an index file
+ *
+ * An index that is missing, truncated or of another format is recreated
+ * empty and *created is set, so that the caller can import the files that
+ * are already there.
+ *
+ * @param path Index file path
+ * @param created Output: 1 if the index was (re)created empty, else 0
+ *
+ * @return Open index, or NULL on failure
+ */
+CacheIndex* cache_index_open(const char* path, int* created);
+
+/**
+ * @brief Closes the index (safe to call with NULL)
+ */
+void cache_index_close(CacheIndex* index);
+
+/**
+ * @brief Records a file, replacing any previous entry of the same name
+ *
+ * @param index Open index
+ * @param name File name stem, CACHE_INDEX_NAME_LENGTH hex digits
+ * @param bytes File size
+ * @param expires_at Absolute expiry time
+ *
+ * @return 0 on success, -1 on failure
+ */
+int cache_index_put(CacheIndex* index, const char* name, uint64_t bytes,
+                    int64_t expires_at);
+
+/**
+ * @brief Forgets a file (a no-op if it is not indexed)
+ */
+void cache_index_remove(CacheIndex* index, const char* name);
+
+/**
+ * @brief Forgets every file
+ */
+void cache_index_clear(CacheIndex* index);
+
+/**
+ * @brief Marks every file indexed so far for removal, in constant time
+ *
+ * The entries stay in the index, and count towards the quota, until the
+ * sweep reaches them and removes them like expired ones. Files recorded
+ * afterwards, including rewrites of retired names, are not affected.
+ */
+void cache_index_retire_all(CacheIndex* index);
+
+/**
+ * @brief Runs one bounded garbage collection step
+ *
+ * Visits max_slots slots from the shared cursor. Expired and retired
+ * entries are removed. If the indexed bytes then still exceed quota, the
+ * visited entries that expire soonest are removed until they do not.
+ * evict is called for every removed entry.
+ *
+ * @param index Open index
+ * @param max_slots Slots to visit
+ * @param quota Byte quota, 0 for none
+ * @param evict Deletes the file of a removed entry
+ * @param user_data Passed through to evict
+ *
+ * @return Number of entries removed, or -1 if the index could not be
+ *         locked
+ */
+int cache_index_sweep(CacheIndex* index, size_t max_slots, uint64_t quota,
+                      CacheIndexEvict evict, void* user_data);
+
+/**
+ * @brief Calls visit for every indexed file that is neither expired nor
+ *        retired
+ *
+ * @param index Open index
+ * @param visit Called once per file
+ * @param user_data Passed through to visit
+ *
+ * @return 0 on success, -1 if the index could not be locked
+ */
+int cache_index_for_each(CacheIndex* index, CacheIndexVisit visit,
+                         void* user_data);
+
+/**
+ * @brief Fills in space accounting
+ */
+void cache_index_get_stats(CacheIndex* index, CacheIndexStats* stats);
+
+#endif
@@ -0,0 +1,773 @@
+/**
+ * @file cache_log.c
+ * @brief Log-structured disk store implementation
+ *
+ * See cache_log.h for detailed API documentation.
+ */
+#include "cache_log.h"
+
+#include "file_lock.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define COMPACT_FILE_NAME CACHE_LOG_FILE_NAME ".compact"
+
+#define INDEX_MAGIC "JWCI"
+#define INDEX_VERSION 3
+#define INDEX_INITIAL_SLOTS 1024
+#define RECORD_MAGIC 0x5243574AU /* "JWCR" in little endian */
+
+#define SLOT_EMPTY 0
+#define SLOT_TOMBSTONE 1
+
+/* Shared index: this header followed by capacity slots */
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t capacity; /* slots, power of two */
+    uint64_t used;     /* live slots */
+    uint64_t tombstones;
+    uint64_t log_epoch; /* bumped whenever compaction replaces the log */
+    uint64_t log_end;   /* records beyond this are torn writes */
+    uint64_t live_bytes;
+    uint64_t dead_bytes;
+    uint64_t gc_cursor; /* next slot cache_log_sweep() visits */
+} IndexHeader;
+
+typedef struct {
+    uint64_t hash; /* SLOT_EMPTY, SLOT_TOMBSTONE or a remapped key hash */
+    uint64_t offset;
+    uint32_t length; /* whole record */
+    uint32_t reserved;
+    int64_t  expires_at;
+} IndexSlot;
+
+/* A visited slot the sweep may remove to get under quota */
+typedef struct {
+    int64_t  expires_at;
+    uint64_t slot;
+} Candidate;
+
+/* Log record: this header, the key, the ETag, then the payload */
+typedef struct {
+    uint32_t magic;
+    uint32_t key_len;
+    uint32_t etag_len;
+    uint32_t payload_len;
+    int64_t  created_at;
+    int64_t  expires_at;
+    uint64_t stamp;    /* see cache_tombstone.h */
+    uint64_t checksum; /* FNV-1a over key, ETag and payload */
+} RecordHeader;
+
+struct CacheLog {
+    char            dir[512];
+    int             index_fd;
+    int             log_fd;
+    IndexHeader*    index;  /* shared mapping of the index file */
+    size_t          mapped; /* bytes currently mapped */
+    uint64_t        log_epoch;
+    FileLock        lock; /* on index_fd */
+};
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t key_hash(const char* key) {
+    uint64_t hash = fnv1a(0xcbf29ce484222325ULL, key, strlen(key));
+    /* Keep clear of the two reserved slot markers */
+    return hash <= SLOT_TOMBSTONE ? hash + 2 : hash;
+}
+
+static IndexSlot* slots(CacheLog* log) { return (IndexSlot*)(log->index + 1); }
+
+static size_t index_size(uint64_t capacity) {
+    return sizeof(IndexHeader) + capacity * sizeof(IndexSlot);
+}
+
+static void path_of(const CacheLog* log, const char* name, char* out,
+                    size_t out_size) {
+    snprintf(out, out_size, "%s/%s", log->dir, name);
+}
+
+static int open_log_file(CacheLog* log) {
+    char path[600];
+    path_of(log, CACHE_LOG_FILE_NAME, path, sizeof(path));
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (log->log_fd >= 0) {
+        close(log->log_fd);
+    }
+    log->log_fd    = fd;
+    log->log_epoch = log->index->log_epoch;
+    return 0;
+}
+
+static int map_index(CacheLog* log) {
+    struct stat index_stat;
+    if (fstat(log->index_fd, &index_stat) != 0) {
+        return -1;
+    }
+
+    void* map = mmap(NULL, (size_t)index_stat.st_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, log->index_fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    if (log->index) {
+        munmap(log->index, log->mapped);
+    }
+    log->index  = map;
+    log->mapped = (size_t)index_stat.st_size;
+    return 0;
+}
+
+static void reset_index(CacheLog* log) {
+    memset(slots(log), 0, log->index->capacity * sizeof(IndexSlot));
+    log->index->used       = 0;
+    log->index->tombstones = 0;
+    log->index->log_end    = 0;
+    log->index->live_bytes = 0;
+    log->index->dead_bytes = 0;
+    log->index->gc_cursor  = 0;
+    log->index->log_epoch++;
+}
+
+static int init_index(CacheLog* log) {
+    if (ftruncate(log->index_fd, 0) != 0 ||
+        ftruncate(log->index_fd, index_size(INDEX_INITIAL_SLOTS)) != 0 ||
+        map_index(log) != 0) {
+        return -1;
+    }
+
+    memcpy(log->index->magic, INDEX_MAGIC, sizeof(log->index->magic));
+    log->index->version  = INDEX_VERSION;
+    log->index->capacity = INDEX_INITIAL_SLOTS;
+    reset_index(log);
+    return 0;
+}
+
+static int index_valid(const CacheLog* log) {
+    const IndexHeader* header = log->index;
+    uint64_t           cap    = header->capacity;
+    return log->mapped >= sizeof(IndexHeader) &&
+           memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == INDEX_VERSION && cap > 0 &&
+           (cap & (cap - 1)) == 0 && log->mapped >= index_size(cap);
+}
+
+/* Takes the index lock and catches up with changes made by other processes */
+static int lock_log(CacheLog* log, int operation) {
+    if (file_lock_acquire(&log->lock, operation) != 0) {
+        return -1;
+    }
+
+    if ((log->mapped < index_size(log->index->capacity) &&
+         map_index(log) != 0) ||
+        (log->log_epoch != log->index->log_epoch && open_log_file(log) != 0)) {
+        file_lock_release(&log->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void unlock_log(CacheLog* log) {
+    file_lock_release(&log->lock);
+}
+
+static IndexSlot* find_key(CacheLog* log, const char* key) {
+    /* Slots are matched on the 64-bit hash alone; the key stored in the
+     * record is compared when the record is read */
+    uint64_t   hash = key_hash(key);
+    uint64_t   mask = log->index->capacity - 1;
+    IndexSlot* all  = slots(log);
+
+    for (uint64_t i = hash & mask;; i = (i + 1) & mask) {
+        if (all[i].hash == SLOT_EMPTY) {
+            return NULL;
+        }
+        if (all[i].hash == hash) {
+            return &all[i];
+        }
+    }
+}
+
+static void kill_slot(CacheLog* log, IndexSlot* slot) {
+    log->index->dead_bytes += slot->length;
+    log->index->live_bytes -= slot->length;
+    log->index->used--;
+    log->index->tombstones++;
+    slot->hash = SLOT_TOMBSTONE;
+}
+
+static int rehash(CacheLog* log, uint64_t capacity) {
+    uint64_t   old_capacity = log->index->capacity;
+    IndexSlot* live         = malloc(log->index->used * sizeof(IndexSlot));
+    if (log->index->used > 0 && !live) {
+        return -1;
+    }
+
+    size_t count = 0;
+    for (uint64_t i = 0; i < old_capacity; i++) {
+        IndexSlot* slot = &slots(log)[i];
+        if (slot->hash > SLOT_TOMBSTONE) {
+            live[count++] = *slot;
+        }
+    }
+
+    /* The file only ever grows, so other mappings never lose pages */
+    if (capacity > old_capacity &&
+        (ftruncate(log->index_fd, index_size(capacity)) != 0 ||
+         map_index(log) != 0)) {
+        free(live);
+        return -1;
+    }
+
+    log->index->capacity   = capacity;
+    log->index->tombstones = 0;
+    log->index->gc_cursor  = 0;
+    memset(slots(log), 0, capacity * sizeof(IndexSlot));
+
+    uint64_t mask = capacity - 1;
+    for (size_t n = 0; n < count; n++) {
+        uint64_t i = live[n].hash & mask;
+        while (slots(log)[i].hash != SLOT_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        slots(log)[i] = live[n];
+    }
+
+    free(live);
+    return 0;
+}
+
+static int reserve_slot(CacheLog* log) {
+    IndexHeader* index = log->index;
+    if ((index->used + index->tombstones + 1) * 4 <= index->capacity * 3) {
+        return 0;
+    }
+
+    uint64_t capacity = index->capacity;
+    if ((index->used + 1) * 2 > capacity) {
+        capacity *= 2;
+    }
+    return rehash(log, capacity);
+}
+
+static IndexSlot* insert_slot(CacheLog* log, uint64_t hash) {
+    uint64_t mask = log->index->capacity - 1;
+    uint64_t i    = hash & mask;
+    while (slots(log)[i].hash > SLOT_TOMBSTONE) {
+        i = (i + 1) & mask;
+    }
+
+    if (slots(log)[i].hash == SLOT_TOMBSTONE) {
+        log->index->tombstones--;
+    }
+    log->index->used++;
+    return &slots(log)[i];
+}
+
+static int should_compact(const CacheLog* log) {
+    return log->index->dead_bytes > CACHE_LOG_COMPACT_MIN_DEAD &&
+           log->index->dead_bytes > log->index->live_bytes;
+}
+
+static uint64_t record_checksum(const char* key, size_t key_len,
+                                const char* etag, size_t etag_len,
+                                const char* payload, size_t payload_len) {
+    uint64_t hash = fnv1a(0xcbf29ce484222325ULL, key, key_len);
+    hash          = fnv1a(hash, etag, etag_len);
+    return fnv1a(hash, payload, payload_len);
+}
+
+static int record_valid(const RecordHeader* record, const char* stored,
+                        size_t length, const char* key, size_t key_len) {
+    if (record->magic != RECORD_MAGIC || record->key_len != key_len ||
+        record->etag_len >= CACHE_LOG_ETAG_MAX ||
+        sizeof(RecordHeader) + key_len + record->etag_len +
+                record->payload_len !=
+            length) {
+        return 0;
+    }
+
+    const char* etag    = stored + key_len;
+    const char* payload = etag + record->etag_len;
+    return memcmp(stored, key, key_len) == 0 &&
+           record->checksum == record_checksum(stored, key_len, etag,
+                                               record->etag_len, payload,
+                                               record->payload_len);
+}
+
+CacheLog* cache_log_open(const char* dir) {
+    if (!dir || strlen(dir) >= sizeof(((CacheLog*)0)->dir)) {
+        return NULL;
+    }
+
+    CacheLog* log = calloc(1, sizeof(CacheLog));
+    if (!log) {
+        return NULL;
+    }
+    strcpy(log->dir, dir);
+    log->log_fd = -1;
+
+    char path[600];
+    path_of(log, CACHE_LOG_INDEX_NAME, path, sizeof(path));
+    log->index_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (log->index_fd < 0) {
+        free(log);
+        return NULL;
+    }
+
+    file_lock_init(&log->lock, log->index_fd);
+    if (file_lock_acquire(&log->lock, LOCK_EX) != 0) {
+        close(log->index_fd);
+        file_lock_destroy(&log->lock);
+        free(log);
+        return NULL;
+    }
+
+    struct stat index_stat;
+    int         ok = fstat(log->index_fd, &index_stat) == 0;
+    if (ok && index_stat.st_size >= (off_t)index_size(INDEX_INITIAL_SLOTS)) {
+        ok = map_index(log) == 0;
+        if (ok && !index_valid(log)) {
+            ok = init_index(log) == 0;
+        }
+    } else if (ok) {
+        ok = init_index(log) == 0;
+    }
+
+    if (ok) {
+        ok = open_log_file(log) == 0;
+    }
+    if (ok && log->index->log_end == 0) {
+        /* Fresh or reset index: nothing in an old log is reachable */
+        ok = ftruncate(log->log_fd, 0) == 0;
+    }
+
+    file_lock_release(&log->lock);
+
+    if (!ok) {
+        cache_log_close(log);
+        return NULL;
+    }
+
+    return log;
+}
+
+void cache_log_close(CacheLog* log) {
+    if (!log) {
+        return;
+    }
+
+    if (log->index) {
+        munmap(log->index, log->mapped);
+    }
+    if (log->log_fd >= 0) {
+        close(log->log_fd);
+    }
+    close(log->index_fd);
+    file_lock_destroy(&log->lock);
+    free(log);
+}
+
+int cache_log_put(CacheLog* log, const char* key, const char* data,
+                  size_t len, time_t created_at, time_t expires_at,
+                  uint64_t stamp, const char* etag, CacheLogRecordInfo* info) {
+    if (!log || !key || !data) {
+        return -1;
+    }
+
+    size_t key_len  = strlen(key);
+    size_t etag_len = etag ? strlen(etag) : 0;
+    if (etag_len >= CACHE_LOG_ETAG_MAX) {
+        etag_len = 0;
+    }
+
+    RecordHeader record;
+    record.magic       = RECORD_MAGIC;
+    record.key_len     = (uint32_t)key_len;
+    record.etag_len    = (uint32_t)etag_len;
+    record.payload_len = (uint32_t)len;
+    record.created_at  = (int64_t)created_at;
+    record.expires_at  = (int64_t)expires_at;
+    record.stamp       = stamp;
+    record.checksum =
+        record_checksum(key, key_len, etag, etag_len, data, len);
+
+    size_t length = sizeof(record) + key_len + etag_len + len;
+    if (length > UINT32_MAX) {
+        return -1;
+    }
+
+    if (lock_log(log, LOCK_EX) != 0) {
+        return -1;
+    }
+
+    /* Write at the recorded end rather than O_APPEND, so a torn write left
+     * by a crash is simply overwritten by the next record */
+    uint64_t     offset   = log->index->log_end;
+    struct iovec parts[4] = {
+        {&record, sizeof(record)},
+        {(void*)key, key_len},
+        {(void*)etag, etag_len},
+        {(void*)data, len},
+    };
+
+    if (pwritev(log->log_fd, parts, 4, (off_t)offset) != (ssize_t)length ||
+        reserve_slot(log) != 0) {
+        unlock_log(log);
+        return -1;
+    }
+
+    IndexSlot* previous = find_key(log, key);
+    if (previous) {
+        kill_slot(log, previous);
+    }
+
+    IndexSlot* slot  = insert_slot(log, key_hash(key));
+    slot->offset     = offset;
+    slot->length     = (uint32_t)length;
+    slot->expires_at = (int64_t)expires_at;
+    slot->hash       = key_hash(key);
+
+    log->index->log_end += length;
+    log->index->live_bytes += length;
+
+    int compact = should_compact(log);
+    unlock_log(log);
+
+    if (info) {
+        info->created_at = record.created_at;
+        info->expires_at = record.expires_at;
+        info->stamp      = record.stamp;
+        info->offset     = offset;
+        info->disk_bytes = length;
+        if (etag_len) {
+            memcpy(info->etag, etag, etag_len);
+        }
+        info->etag[etag_len] = '\0';
+    }
+
+    if (compact) {
+        cache_log_compact(log);
+    }
+
+    return 0;
+}
+
+char* cache_log_get(CacheLog* log, const char* key, size_t* len,
+                    CacheLogRecordInfo* info) {
+    if (!log || !key) {
+        return NULL;
+    }
+
+    if (lock_log(log, LOCK_SH) != 0) {
+        return NULL;
+    }
+
+    IndexSlot* slot = find_key(log, key);
+    if (!slot) {
+        unlock_log(log);
+        return NULL;
+    }
+
+    uint64_t offset  = slot->offset;
+    size_t   length  = slot->length;
+    int      expired = (int64_t)time(NULL) > slot->expires_at;
+    char*    buffer  = expired ? NULL : malloc(length + 1);
+
+    int valid = buffer && pread(log->log_fd, buffer, length, (off_t)offset) ==
+                              (ssize_t)length;
+    unlock_log(log);
+
+    RecordHeader record;
+    size_t       key_len = strlen(key);
+    if (valid) {
+        memcpy(&record, buffer, sizeof(record));
+        valid = record_valid(&record, buffer + sizeof(record), length, key,
+                             key_len);
+    }
+
+    if (!valid) {
+        /* Expired or damaged: drop it so the next lookup is a plain miss */
+        free(buffer);
+        if (lock_log(log, LOCK_EX) == 0) {
+            slot = find_key(log, key);
+            if (slot && slot->offset == offset) {
+                kill_slot(log, slot);
+            }
+            unlock_log(log);
+        }
+        return NULL;
+    }
+
+    const char* etag    = buffer + sizeof(record) + key_len;
+    const char* payload = etag + record.etag_len;
+    if (info) {
+        info->created_at = record.created_at;
+        info->expires_at = record.expires_at;
+        info->stamp      = record.stamp;
+        info->offset     = offset;
+        info->disk_bytes = length;
+        memcpy(info->etag, etag, record.etag_len);
+        info->etag[record.etag_len] = '\0';
+    }
+
+    memmove(buffer, payload, record.payload_len);
+    buffer[record.payload_len] = '\0';
+    if (len) {
+        *len = record.payload_len;
+    }
+    return buffer;
+}
+
+int cache_log_lookup(CacheLog* log, const char* key, uint64_t* offset) {
+    if (!log || !key || lock_log(log, LOCK_SH) != 0) {
+        return -1;
+    }
+
+    IndexSlot* slot   = find_key(log, key);
+    int        result = -1;
+    if (slot && (int64_t)time(NULL) <= slot->expires_at) {
+        *offset = slot->offset;
+        result  = 0;
+    }
+
+    unlock_log(log);
+    return result;
+}
+
+void cache_log_delete(CacheLog* log, const char* key) {
+    if (!log || !key || lock_log(log, LOCK_EX) != 0) {
+        return;
+    }
+
+    IndexSlot* slot = find_key(log, key);
+    if (slot) {
+        kill_slot(log, slot);
+    }
+
+    unlock_log(log);
+}
+
+void cache_log_clear(CacheLog* log) {
+    if (!log || lock_log(log, LOCK_EX) != 0) {
+        return;
+    }
+
+    /* Shrink the log, never the index: other processes have it mapped */
+    reset_index(log);
+    if (ftruncate(log->log_fd, 0) == 0) {
+        log->log_epoch = log->index->log_epoch;
+    }
+
+    unlock_log(log);
+}
+
+int cache_log_compact(CacheLog* log) {
+    if (!log || lock_log(log, LOCK_EX) != 0) {
+        return -1;
+    }
+
+    char compact_path[600];
+    char log_path[600];
+    path_of(log, COMPACT_FILE_NAME, compact_path, sizeof(compact_path));
+    path_of(log, CACHE_LOG_FILE_NAME, log_path, sizeof(log_path));
+
+    int fd = open(compact_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        unlock_log(log);
+        return -1;
+    }
+
+    /* Copy live records first; the index is only touched once the new
+     * segment is complete, so a failure leaves the old one in use */
+    uint64_t   capacity = log->index->capacity;
+    uint64_t*  moved    = malloc(capacity * sizeof(uint64_t));
+    uint64_t   end      = 0;
+    int64_t    now      = (int64_t)time(NULL);
+    char*      buffer   = NULL;
+    size_t     alloc    = 0;
+    int        ok       = moved != NULL;
+    IndexSlot* all      = slots(log);
+
+    for (uint64_t i = 0; ok && i < capacity; i++) {
+        IndexSlot* slot = &all[i];
+        if (slot->hash <= SLOT_TOMBSTONE || slot->expires_at < now) {
+            continue;
+        }
+
+        if (slot->length > alloc) {
+            char* grown = realloc(buffer, slot->length);
+            if (!grown) {
+                ok = 0;
+                break;
+            }
+            buffer = grown;
+            alloc  = slot->length;
+        }
+
+        ok = pread(log->log_fd, buffer, slot->length, (off_t)slot->offset) ==
+                 (ssize_t)slot->length &&
+             pwrite(fd, buffer, slot->length, (off_t)end) ==
+                 (ssize_t)slot->length;
+        moved[i] = end;
+        end += slot->length;
+    }
+    free(buffer);
+
+    if (!ok || fsync(fd) != 0 || rename(compact_path, log_path) != 0) {
+        close(fd);
+        unlink(compact_path);
+        free(moved);
+        unlock_log(log);
+        return -1;
+    }
+
+    uint64_t live = 0;
+    for (uint64_t i = 0; i < capacity; i++) {
+        IndexSlot* slot = &all[i];
+        if (slot->hash <= SLOT_TOMBSTONE) {
+            continue;
+        }
+        if (slot->expires_at < now) {
+            kill_slot(log, slot);
+            continue;
+        }
+        slot->offset = moved[i];
+        live += slot->length;
+    }
+    free(moved);
+
+    log->index->log_end    = end;
+    log->index->live_bytes = live;
+    log->index->dead_bytes = 0;
+    log->index->log_epoch++;
+
+    close(log->log_fd);
+    log->log_fd    = fd;
+    log->log_epoch = log->index->log_epoch;
+
+    if (log->index->tombstones > log->index->capacity / 4) {
+        rehash(log, log->index->capacity);
+    }
+
+    unlock_log(log);
+    return 0;
+}
+
+static int by_expiry(const void* a, const void* b) {
+    const Candidate* left  = a;
+    const Candidate* right = b;
+    return (left->expires_at > right->expires_at) -
+           (left->expires_at < right->expires_at);
+}
+
+int cache_log_sweep(CacheLog* log, size_t max_slots, uint64_t quota) {
+    if (!log || lock_log(log, LOCK_EX) != 0) {
+        return -1;
+    }
+
+    IndexHeader* index = log->index;
+    uint64_t     mask  = index->capacity - 1;
+    if (max_slots > index->capacity) {
+        max_slots = index->capacity;
+    }
+
+    Candidate* candidates = quota ? malloc(max_slots * sizeof(Candidate))
+                                  : NULL;
+    size_t     count      = 0;
+    int        removed    = 0;
+    int64_t    now        = (int64_t)time(NULL);
+    uint64_t   cursor     = index->gc_cursor & mask;
+
+    for (size_t n = 0; n < max_slots; n++) {
+        uint64_t   i    = (cursor + n) & mask;
+        IndexSlot* slot = &slots(log)[i];
+        if (slot->hash <= SLOT_TOMBSTONE) {
+            continue;
+        }
+        if (slot->expires_at < now) {
+            kill_slot(log, slot);
+            removed++;
+        } else if (candidates) {
+            candidates[count].expires_at = slot->expires_at;
+            candidates[count].slot       = i;
+            count++;
+        }
+    }
+    index->gc_cursor = (cursor + max_slots) & mask;
+
+    /* Over quota: the visited records closest to expiry go first */
+    if (candidates && index->live_bytes > quota) {
+        qsort(candidates, count, sizeof(Candidate), by_expiry);
+        for (size_t n = 0; n < count && index->live_bytes > quota; n++) {
+            kill_slot(log, &slots(log)[candidates[n].slot]);
+            removed++;
+        }
+    }
+    free(candidates);
+
+    int compact = should_compact(log);
+    unlock_log(log);
+
+    /* Dead records only give their space back when the log is rewritten */
+    if (compact) {
+        cache_log_compact(log);
+    }
+    return removed;
+}
+
+int cache_log_sync(CacheLog* log) {
+    if (!log || lock_log(log, LOCK_SH) != 0) {
+        return -1;
+    }
+
+    int result = 0;
+    if (fdatasync(log->log_fd) != 0 ||
+        msync(log->index, log->mapped, MS_SYNC) != 0) {
+        result = -1;
+    }
+    unlock_log(log);
+    return result;
+}
+
+void cache_log_get_stats(CacheLog* log, CacheLogStats* stats) {
+    if (!log || !stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(CacheLogStats));
+    if (lock_log(log, LOCK_SH) != 0) {
+        return;
+    }
+
+    stats->records    = log->index->used;
+    stats->live_bytes = log->index->live_bytes;
+    stats->dead_bytes = log->index->dead_bytes;
+    stats->log_bytes  = log->index->log_end;
+    stats->slots      = log->index->capacity;
+
+    unlock_log(log);
+}
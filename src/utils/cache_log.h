@@ -0,0 +1,183 @@
+/**
+ * @file cache_log.h
+ * @brief Single-file, log-structured disk store for cached responses
+ *
+ * This header provides an alternative to one file per cache key. Records
+ * are appended to one segment file (cache.log) and located through a
+ * persistent open-addressing hash index (cache.idx) that every process
+ * maps into memory. A lookup is an index probe in shared memory followed
+ * by a single pread() of the record; no per-entry file is opened, stat'ed
+ * or unlinked.
+ *
+ * Features:
+ * - O(1) put, get and delete, one system call for the record itself
+ * - Index slots carry offset, length and expiry, so expired records are
+ *   rejected without touching the log
+ * - Records carry their key and a checksum and are verified on read
+ * - Dead records (overwritten, deleted or expired) are reclaimed by
+ *   compaction, which rewrites only the live records into a new segment
+ * - Incremental garbage collection (cache_log_sweep()): expired records
+ *   are dropped and a byte quota enforced a few index slots at a time
+ * - Safe to share between processes and threads: operations hold an
+ *   flock() on the index plus a mutex, and processes notice index growth
+ *   and log replacement
+ *
+ * Files: \<dir\>/cache.log and \<dir\>/cache.idx
+ */
+#ifndef CACHE_LOG_H
+#define CACHE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define CACHE_LOG_FILE_NAME "cache.log"  ///< Segment file in the directory
+#define CACHE_LOG_INDEX_NAME "cache.idx" ///< Index file in the directory
+#define CACHE_LOG_ETAG_MAX 128 ///< Longest ETag stored (including NUL)
+#define CACHE_LOG_COMPACT_MIN_DEAD                                             \
+    (256 * 1024) ///< Dead bytes before compaction is considered
+
+/**
+ * @struct CacheLog
+ * @brief Open log store (opaque)
+ */
+typedef struct CacheLog CacheLog;
+
+/**
+ * @struct CacheLogRecordInfo
+ * @brief Metadata of a stored record
+ */
+typedef struct {
+    int64_t  created_at;               /**< When the record was written */
+    int64_t  expires_at;               /**< Absolute expiry time */
+    uint64_t stamp;                    /**< Stamp stored with the record */
+    uint64_t offset;                   /**< Position; identifies a version */
+    size_t   disk_bytes;               /**< Size of the record in the log */
+    char     etag[CACHE_LOG_ETAG_MAX]; /**< ETag, empty if none */
+} CacheLogRecordInfo;
+
+/**
+ * @struct CacheLogStats
+ * @brief Space accounting of the store
+ */
+typedef struct {
+    size_t records;    /**< Live records */
+    size_t live_bytes; /**< Bytes used by live records */
+    size_t dead_bytes; /**< Bytes reclaimable by compaction */
+    size_t log_bytes;  /**< Size of the segment file */
+    size_t slots;      /**< Index size; one sweep cycle visits all slots */
+} CacheLogStats;
+
+/**
+ * @brief Opens (creating if needed) the store in the given directory
+ *
+ * An index that is missing, truncated or of another format is recreated
+ * empty together with the log; the store is a cache, so nothing is lost
+ * that cannot be fetched again.
+ *
+ * @param dir Existing directory to keep cache.log and cache.idx in
+ *
+ * @return Open store, or NULL on failure
+ */
+CacheLog* cache_log_open(const char* dir);
+
+/**
+ * @brief Closes the store (safe to call with NULL)
+ */
+void cache_log_close(CacheLog* log);
+
+/**
+ * @brief Appends a record, replacing any previous record of the key
+ *
+ * May trigger compaction when dead records outweigh live ones.
+ *
+ * @param log Open store
+ * @param key Cache key
+ * @param data Payload bytes
+ * @param len Payload length
+ * @param created_at Creation time stored with the record
+ * @param expires_at Absolute expiry time
+ * @param stamp Invalidation stamp stored with the record (see
+ *              cache_tombstone.h)
+ * @param etag Entity tag, or NULL
+ * @param info Output: metadata of the new record (may be NULL)
+ *
+ * @return 0 on success, -1 on failure
+ */
+int cache_log_put(CacheLog* log, const char* key, const char* data,
+                  size_t len, time_t created_at, time_t expires_at,
+                  uint64_t stamp, const char* etag, CacheLogRecordInfo* info);
+
+/**
+ * @brief Reads the live record of a key
+ *
+ * Expired or corrupt records are deleted and reported as a miss.
+ *
+ * @param log Open store
+ * @param key Cache key
+ * @param len Output: payload length
+ * @param info Output: record metadata (may be NULL)
+ *
+ * @return Payload (NUL-terminated, caller frees), or NULL on miss
+ */
+char* cache_log_get(CacheLog* log, const char* key, size_t* len,
+                    CacheLogRecordInfo* info);
+
+/**
+ * @brief Finds the offset of a key's live record without reading it
+ *
+ * @return 0 and *offset on success, -1 if the key has no live record
+ */
+int cache_log_lookup(CacheLog* log, const char* key, uint64_t* offset);
+
+/**
+ * @brief Deletes the record of a key (a no-op if there is none)
+ */
+void cache_log_delete(CacheLog* log, const char* key);
+
+/**
+ * @brief Deletes every record and truncates the log
+ */
+void cache_log_clear(CacheLog* log);
+
+/**
+ * @brief Rewrites the live records into a fresh segment
+ *
+ * Expired records are dropped on the way. Normally called automatically
+ * by cache_log_put().
+ *
+ * @return 0 on success, -1 on failure (the old segment stays in use)
+ */
+int cache_log_compact(CacheLog* log);
+
+/**
+ * @brief Runs one bounded garbage collection step
+ *
+ * Visits max_slots index slots from a cursor kept in the index, so that
+ * successive calls from any process walk the whole table. Expired records
+ * are dropped. If the live bytes then still exceed quota, the visited
+ * records that expire soonest are dropped until they do not. Compaction
+ * runs afterwards if enough of the log is dead.
+ *
+ * @param log Open store
+ * @param max_slots Index slots to visit
+ * @param quota Byte quota for the live records, 0 for none
+ *
+ * @return Number of records dropped, or -1 if the index could not be
+ *         locked
+ */
+int cache_log_sweep(CacheLog* log, size_t max_slots, uint64_t quota);
+
+/**
+ * @brief Forces the log and the index to stable storage
+ *
+ * @return 0 on success, -1 on failure
+ */
+int cache_log_sync(CacheLog* log);
+
+/**
+ * @brief Fills in space accounting
+ */
+void cache_log_get_stats(CacheLog* log, CacheLogStats* stats);
+
+#endif
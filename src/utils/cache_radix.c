@@ -0,0 +1,294 @@
+/**
+ * @file cache_radix.c
+ * @brief Radix tree implementation
+ *
+ * See cache_radix.h for detailed API documentation.
+ */
+#include "cache_radix.h"
+
+#include "cache_slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Children of a node start with distinct characters; the edge into a node
+ * is its label */
+typedef struct RadixNode RadixNode;
+struct RadixNode {
+    RadixNode* child;     /* first child */
+    RadixNode* sibling;   /* next child of the same parent */
+    void*      value;     /* NULL: no key ends here */
+    size_t     label_len;
+    char       label[];   /* not NUL-terminated */
+};
+
+struct CacheRadix {
+    RadixNode*  root;  /* empty label; not from the arena */
+    CacheArena* arena; /* every other node */
+    size_t      keys;
+};
+
+static RadixNode* new_node(CacheRadix* tree, const char* label, size_t len) {
+    RadixNode* node = cache_arena_alloc(tree->arena, sizeof(RadixNode) + len);
+    if (!node) {
+        return NULL;
+    }
+
+    memset(node, 0, sizeof(RadixNode));
+    node->label_len = len;
+    if (label) {
+        memcpy(node->label, label, len);
+    }
+    return node;
+}
+
+static void free_node(CacheRadix* tree, RadixNode* node) {
+    if (node) {
+        cache_arena_free(tree->arena, node,
+                         sizeof(RadixNode) + node->label_len);
+    }
+}
+
+/* The link to the child starting with first, or the empty end of the list */
+static RadixNode** child_link(RadixNode* node, char first) {
+    RadixNode** link = &node->child;
+    while (*link && (*link)->label[0] != first) {
+        link = &(*link)->sibling;
+    }
+    return link;
+}
+
+static size_t common_length(const RadixNode* node, const char* rest) {
+    size_t i = 0;
+    while (i < node->label_len && rest[i] == node->label[i]) {
+        i++;
+    }
+    return i;
+}
+
+/* The node at *link becomes a node labelled with the first at characters
+ * whose only child holds the rest of the label */
+static int split_node(CacheRadix* tree, RadixNode** link, size_t at) {
+    RadixNode* node = *link;
+    RadixNode* head = new_node(tree, node->label, at);
+    RadixNode* tail = new_node(tree, node->label + at, node->label_len - at);
+    if (!head || !tail) {
+        free_node(tree, head);
+        free_node(tree, tail);
+        return -1;
+    }
+
+    tail->value   = node->value;
+    tail->child   = node->child;
+    head->child   = tail;
+    head->sibling = node->sibling;
+    *link         = head;
+    free_node(tree, node);
+    return 0;
+}
+
+/* Folds a valueless node with a single child into that child; if memory is
+ * short it stays as it is, which is still a valid tree */
+static void merge_node(CacheRadix* tree, RadixNode** link) {
+    RadixNode* node  = *link;
+    RadixNode* child = node->child;
+    RadixNode* merged =
+        new_node(tree, NULL, node->label_len + child->label_len);
+    if (!merged) {
+        return;
+    }
+
+    memcpy(merged->label, node->label, node->label_len);
+    memcpy(merged->label + node->label_len, child->label, child->label_len);
+    merged->value   = child->value;
+    merged->child   = child->child;
+    merged->sibling = node->sibling;
+    *link           = merged;
+    free_node(tree, child);
+    free_node(tree, node);
+}
+
+CacheRadix* cache_radix_create(void) {
+    CacheRadix* tree = calloc(1, sizeof(CacheRadix));
+    if (!tree) {
+        return NULL;
+    }
+
+    tree->root  = calloc(1, sizeof(RadixNode));
+    tree->arena = cache_arena_create();
+    if (!tree->root || !tree->arena) {
+        free(tree->root);
+        cache_arena_destroy(tree->arena);
+        free(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+void cache_radix_destroy(CacheRadix* tree) {
+    if (!tree) {
+        return;
+    }
+
+    cache_arena_destroy(tree->arena);
+    free(tree->root);
+    free(tree);
+}
+
+int cache_radix_insert(CacheRadix* tree, const char* key, void* value) {
+    if (!tree || !key || !value) {
+        return -1;
+    }
+
+    RadixNode*  node = tree->root;
+    const char* rest = key;
+    while (*rest) {
+        RadixNode** link  = child_link(node, rest[0]);
+        RadixNode*  child = *link;
+        if (!child) {
+            RadixNode* leaf = new_node(tree, rest, strlen(rest));
+            if (!leaf) {
+                return -1;
+            }
+            leaf->value = value;
+            *link       = leaf;
+            tree->keys++;
+            return 0;
+        }
+
+        /* The key leaves the edge part-way: branch off there */
+        size_t common = common_length(child, rest);
+        if (common < child->label_len && split_node(tree, link, common) != 0) {
+            return -1;
+        }
+        node = *link;
+        rest += common;
+    }
+
+    if (!node->value) {
+        tree->keys++;
+    }
+    node->value = value;
+    return 0;
+}
+
+void* cache_radix_remove(CacheRadix* tree, const char* key) {
+    if (!tree || !key) {
+        return NULL;
+    }
+
+    RadixNode** parent_link = NULL;
+    RadixNode** link        = &tree->root;
+    const char* rest        = key;
+    while (*rest) {
+        RadixNode** next  = child_link(*link, rest[0]);
+        RadixNode*  child = *next;
+        if (!child || common_length(child, rest) < child->label_len) {
+            return NULL;
+        }
+        parent_link = link;
+        link        = next;
+        rest += child->label_len;
+    }
+
+    RadixNode* node  = *link;
+    void*      value = node->value;
+    if (!value) {
+        return NULL;
+    }
+    node->value = NULL;
+    tree->keys--;
+
+    if (node == tree->root) {
+        return value;
+    }
+
+    /* Keep the tree compact: no leaf without a value, and no valueless
+     * node with a single child */
+    if (!node->child) {
+        *link = node->sibling;
+        free_node(tree, node);
+
+        RadixNode* parent = *parent_link;
+        if (parent != tree->root && !parent->value && parent->child &&
+            !parent->child->sibling) {
+            merge_node(tree, parent_link);
+        }
+    } else if (!node->child->sibling) {
+        merge_node(tree, link);
+    }
+    return value;
+}
+
+void* cache_radix_find(const CacheRadix* tree, const char* key) {
+    if (!tree || !key) {
+        return NULL;
+    }
+
+    RadixNode*  node = tree->root;
+    const char* rest = key;
+    while (*rest) {
+        RadixNode* child = *child_link(node, rest[0]);
+        if (!child || common_length(child, rest) < child->label_len) {
+            return NULL;
+        }
+        node = child;
+        rest += child->label_len;
+    }
+    return node->value;
+}
+
+static size_t visit_subtree(const RadixNode* node, CacheRadixVisit visit,
+                            void* user_data) {
+    size_t visited = 0;
+    if (node->value) {
+        visit(node->value, user_data);
+        visited++;
+    }
+    for (const RadixNode* child = node->child; child; child = child->sibling) {
+        visited += visit_subtree(child, visit, user_data);
+    }
+    return visited;
+}
+
+size_t cache_radix_visit_prefix(const CacheRadix* tree, const char* prefix,
+                                CacheRadixVisit visit, void* user_data) {
+    if (!tree || !prefix || !visit) {
+        return 0;
+    }
+
+    /* Walk down to the node whose subtree holds exactly the matching keys;
+     * the prefix may end in the middle of its edge */
+    RadixNode*  node = tree->root;
+    const char* rest = prefix;
+    while (*rest) {
+        RadixNode* child = *child_link(node, rest[0]);
+        if (!child) {
+            return 0;
+        }
+
+        size_t common = common_length(child, rest);
+        if (rest[common] != '\0' && common < child->label_len) {
+            return 0;
+        }
+        node = child;
+        rest += common;
+    }
+
+    return visit_subtree(node, visit, user_data);
+}
+
+void cache_radix_clear(CacheRadix* tree) {
+    if (!tree) {
+        return;
+    }
+
+    cache_arena_reset(tree->arena);
+    tree->root->child = NULL;
+    tree->root->value = NULL;
+    tree->keys        = 0;
+}
+
+size_t cache_radix_count(const CacheRadix* tree) {
+    return tree ? tree->keys : 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file cache_radix.h
+ * @brief Radix tree of string keys for prefix lookups
+ *
+ * The hash index of ClientCache answers exact lookups only. This tree is a
+ * second index over the same keys: each edge carries a run of characters,
+ * so that all keys under a prefix such as "cities:" are found by walking
+ * the prefix and then the subtree below it. It adds to the memory of the
+ * cache rather than saving any, since the values keep their own copy of
+ * the key.
+ *
+ * Features:
+ * - Insert, remove and exact find in O(key length)
+ * - Prefix enumeration in O(prefix length + matches)
+ * - Nodes merge back on removal, so the tree never keeps dead chains
+ * - Nodes are allocated from a CacheArena (cache_slab.h); clearing the tree
+ *   hands all of them back at once
+ *
+ * Keys are NUL-terminated strings; values are opaque non-NULL pointers. The
+ * tree is not thread-safe.
+ */
+#ifndef CACHE_RADIX_H
+#define CACHE_RADIX_H
+
+#include <stddef.h>
+
+/**
+ * @struct CacheRadix
+ * @brief Radix tree (opaque)
+ */
+typedef struct CacheRadix CacheRadix;
+
+/**
+ * @brief Receives one value from cache_radix_visit_prefix()
+ *
+ * Must not modify the tree.
+ *
+ * @param value Value stored under a matching key
+ * @param user_data As passed to cache_radix_visit_prefix()
+ */
+typedef void (*CacheRadixVisit)(void* value, void* user_data);
+
+/**
+ * @brief Creates an empty tree
+ *
+ * @return New tree, or NULL on allocation failure
+ */
+CacheRadix* cache_radix_create(void);
+
+/**
+ * @brief Frees the tree (safe to call with NULL); values are not touched
+ */
+void cache_radix_destroy(CacheRadix* tree);
+
+/**
+ * @brief Stores a value under a key, replacing any previous value
+ *
+ * @param tree Tree
+ * @param key Key
+ * @param value Value, not NULL
+ *
+ * @return 0 on success, -1 on allocation failure (the key is not stored)
+ */
+int cache_radix_insert(CacheRadix* tree, const char* key, void* value);
+
+/**
+ * @brief Removes a key
+ *
+ * @return The value it held, or NULL if the key was not in the tree
+ */
+void* cache_radix_remove(CacheRadix* tree, const char* key);
+
+/**
+ * @brief Looks up a key
+ *
+ * @return Its value, or NULL if the key is not in the tree
+ */
+void* cache_radix_find(const CacheRadix* tree, const char* key);
+
+/**
+ * @brief Calls visit for every key that starts with prefix
+ *
+ * @param tree Tree
+ * @param prefix Prefix; "" visits every key
+ * @param visit Called once per matching key, in no particular order
+ * @param user_data Passed through to visit
+ *
+ * @return Number of keys visited
+ */
+size_t cache_radix_visit_prefix(const CacheRadix* tree, const char* prefix,
+                                CacheRadixVisit visit, void* user_data);
+
+/**
+ * @brief Removes every key
+ */
+void cache_radix_clear(CacheRadix* tree);
+
+/**
+ * @brief Number of keys in the tree
+ */
+size_t cache_radix_count(const CacheRadix* tree);
+
+#endif
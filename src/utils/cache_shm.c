@@ -0,0 +1,419 @@
+/**
+ * @file cache_shm.c
+ * @brief Shared-memory cache segment implementation
+ *
+ * See cache_shm.h for detailed API documentation.
+ */
+#include "cache_shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SEGMENT_MAGIC "JWCS"
+#define SEGMENT_VERSION 2
+#define SEGMENT_MIN_ARENA (64 * 1024)
+#define BYTES_PER_BUCKET 4096 /* arena bytes per index bucket when sizing */
+#define MIN_BUCKETS 64
+
+/* Segment: this header, bucket_count * CACHE_SHM_WAYS ways, the arena */
+typedef struct {
+    char            magic[4]; /* written last by the creating process */
+    uint32_t        version;
+    uint64_t        size; /* whole segment */
+    uint64_t        bucket_count;
+    uint64_t        arena_offset;
+    uint64_t        arena_size;
+    uint64_t        head; /* bytes ever appended; arena wraps modulo size */
+    pthread_mutex_t mutex;
+} SegmentHeader;
+
+typedef struct {
+    uint64_t hash;     /* 0 = empty */
+    uint64_t position; /* of the record in the append stream */
+    uint32_t length;   /* whole record, padded */
+    uint32_t reserved;
+    int64_t  expires_at;
+} Way;
+
+/* Arena record: this header, the key, the ETag, then the payload */
+typedef struct {
+    uint64_t hash;
+    uint32_t key_len;
+    uint32_t etag_len;
+    uint32_t payload_len;
+    uint32_t reserved;
+    int64_t  created_at;
+    int64_t  expires_at;
+    uint64_t stamp; /* see cache_tombstone.h */
+} SharedRecord;
+
+struct CacheShm {
+    SegmentHeader* header;
+    size_t         size;
+};
+
+static uint64_t key_hash(const char* key) {
+    uint64_t             hash  = 0xcbf29ce484222325ULL;
+    const unsigned char* bytes = (const unsigned char*)key;
+    for (; *bytes; bytes++) {
+        hash ^= *bytes;
+        hash *= 0x100000001b3ULL;
+    }
+    /* 0 marks an empty way */
+    return hash ? hash : 1;
+}
+
+static size_t align8(size_t value) { return (value + 7) & ~(size_t)7; }
+
+static Way* bucket_of(const CacheShm* shm, uint64_t hash) {
+    Way* ways = (Way*)((char*)shm->header + align8(sizeof(SegmentHeader)));
+    return ways + (hash & (shm->header->bucket_count - 1)) * CACHE_SHM_WAYS;
+}
+
+static char* arena_at(const CacheShm* shm, uint64_t position) {
+    const SegmentHeader* header = shm->header;
+    return (char*)header + header->arena_offset +
+           position % header->arena_size;
+}
+
+/* A record is intact until the head has moved a full arena past it */
+static int way_live(const SegmentHeader* header, const Way* way) {
+    return way->hash != 0 &&
+           header->head - way->position <= header->arena_size;
+}
+
+static void reset_segment(SegmentHeader* header) {
+    memset((char*)header + align8(sizeof(SegmentHeader)), 0,
+           header->bucket_count * CACHE_SHM_WAYS * sizeof(Way));
+    header->head = 0;
+}
+
+static int init_segment(SegmentHeader* header, size_t size) {
+    size_t index_start  = align8(sizeof(SegmentHeader));
+    size_t bucket_bytes = CACHE_SHM_WAYS * sizeof(Way);
+
+    uint64_t buckets = MIN_BUCKETS;
+    while (buckets * 2 * (BYTES_PER_BUCKET + bucket_bytes) <= size) {
+        buckets *= 2;
+    }
+
+    size_t arena_offset = index_start + buckets * bucket_bytes;
+    if (size < arena_offset + SEGMENT_MIN_ARENA) {
+        return -1;
+    }
+
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr) != 0) {
+        return -1;
+    }
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int result = pthread_mutex_init(&header->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (result != 0) {
+        return -1;
+    }
+
+    header->version      = SEGMENT_VERSION;
+    header->size         = size;
+    header->bucket_count = buckets;
+    header->arena_offset = arena_offset;
+    header->arena_size   = (size - arena_offset) & ~(uint64_t)7;
+    reset_segment(header);
+    memcpy(header->magic, SEGMENT_MAGIC, sizeof(header->magic));
+    return 0;
+}
+
+static int lock_segment(CacheShm* shm) {
+    int result = pthread_mutex_lock(&shm->header->mutex);
+    if (result == EOWNERDEAD) {
+        /* The holder died mid-update and may have left a torn index */
+        reset_segment(shm->header);
+        pthread_mutex_consistent(&shm->header->mutex);
+        result = 0;
+    }
+    return result == 0 ? 0 : -1;
+}
+
+static void unlock_segment(CacheShm* shm) {
+    pthread_mutex_unlock(&shm->header->mutex);
+}
+
+static Way* find_way(CacheShm* shm, uint64_t hash) {
+    Way* bucket = bucket_of(shm, hash);
+    for (int i = 0; i < CACHE_SHM_WAYS; i++) {
+        if (bucket[i].hash == hash && way_live(shm->header, &bucket[i])) {
+            return &bucket[i];
+        }
+    }
+    return NULL;
+}
+
+static Way* choose_way(CacheShm* shm, uint64_t hash) {
+    /* The key's own way, else a dead one, else the oldest record */
+    Way* bucket = bucket_of(shm, hash);
+    Way* oldest = &bucket[0];
+    for (int i = 0; i < CACHE_SHM_WAYS; i++) {
+        if (bucket[i].hash == hash) {
+            return &bucket[i];
+        }
+    }
+    for (int i = 0; i < CACHE_SHM_WAYS; i++) {
+        if (!way_live(shm->header, &bucket[i])) {
+            return &bucket[i];
+        }
+        if (bucket[i].position < oldest->position) {
+            oldest = &bucket[i];
+        }
+    }
+    return oldest;
+}
+
+CacheShm* cache_shm_attach(const char* name, size_t size) {
+    if (!name) {
+        return NULL;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    /* Creation is serialised on the object itself; the creator initialises
+     * the header before anyone else can look at it */
+    if (flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    struct stat shm_stat;
+    int         created = 0;
+    if (fstat(fd, &shm_stat) == 0 && shm_stat.st_size == 0 &&
+        ftruncate(fd, (off_t)size) == 0) {
+        shm_stat.st_size = (off_t)size;
+        created          = 1;
+    }
+
+    CacheShm* shm = calloc(1, sizeof(CacheShm));
+    void*     map = MAP_FAILED;
+    if (shm && shm_stat.st_size >= (off_t)sizeof(SegmentHeader)) {
+        map = mmap(NULL, (size_t)shm_stat.st_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+    }
+
+    int ok = map != MAP_FAILED;
+    if (ok) {
+        shm->header = map;
+        shm->size   = (size_t)shm_stat.st_size;
+
+        SegmentHeader* header = shm->header;
+        if (created || memcmp(header->magic, SEGMENT_MAGIC, 4) != 0) {
+            /* New, or its creator died before finishing */
+            ok = init_segment(header, shm->size) == 0;
+        } else {
+            ok = header->version == SEGMENT_VERSION &&
+                 header->size == shm->size;
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (!ok) {
+        if (map != MAP_FAILED) {
+            munmap(map, (size_t)shm_stat.st_size);
+        }
+        free(shm);
+        return NULL;
+    }
+
+    return shm;
+}
+
+void cache_shm_detach(CacheShm* shm) {
+    if (!shm) {
+        return;
+    }
+
+    munmap(shm->header, shm->size);
+    free(shm);
+}
+
+int cache_shm_put(CacheShm* shm, const char* key, const char* data,
+                  size_t len, time_t created_at, time_t expires_at,
+                  uint64_t stamp, const char* etag) {
+    if (!shm || !key || !data) {
+        return -1;
+    }
+
+    size_t key_len  = strlen(key);
+    size_t etag_len = etag ? strlen(etag) : 0;
+    if (etag_len >= CACHE_SHM_ETAG_MAX) {
+        etag_len = 0;
+    }
+
+    /* A record may take at most a quarter of the arena, so one large
+     * response cannot flush everything else at once */
+    size_t length = align8(sizeof(SharedRecord) + key_len + etag_len + len);
+    if (length > shm->header->arena_size / 4) {
+        return -1;
+    }
+
+    SharedRecord record;
+    memset(&record, 0, sizeof(record));
+    record.hash        = key_hash(key);
+    record.key_len     = (uint32_t)key_len;
+    record.etag_len    = (uint32_t)etag_len;
+    record.payload_len = (uint32_t)len;
+    record.created_at  = (int64_t)created_at;
+    record.expires_at  = (int64_t)expires_at;
+    record.stamp       = stamp;
+
+    if (lock_segment(shm) != 0) {
+        return -1;
+    }
+
+    SegmentHeader* header = shm->header;
+    Way*           way    = choose_way(shm, record.hash);
+
+    /* Records never wrap: skip the gap at the end of the arena */
+    uint64_t offset = header->head % header->arena_size;
+    if (offset + length > header->arena_size) {
+        header->head += header->arena_size - offset;
+    }
+
+    uint64_t position = header->head;
+    char*    target   = arena_at(shm, position);
+    memcpy(target, &record, sizeof(record));
+    memcpy(target + sizeof(record), key, key_len);
+    if (etag_len) {
+        memcpy(target + sizeof(record) + key_len, etag, etag_len);
+    }
+    memcpy(target + sizeof(record) + key_len + etag_len, data, len);
+    header->head += length;
+
+    way->hash       = record.hash;
+    way->position   = position;
+    way->length     = (uint32_t)length;
+    way->expires_at = record.expires_at;
+
+    unlock_segment(shm);
+    return 0;
+}
+
+char* cache_shm_get(CacheShm* shm, const char* key, size_t* len,
+                    CacheShmRecordInfo* info) {
+    if (!shm || !key || lock_segment(shm) != 0) {
+        return NULL;
+    }
+
+    uint64_t hash = key_hash(key);
+    Way*     way  = find_way(shm, hash);
+    if (!way) {
+        unlock_segment(shm);
+        return NULL;
+    }
+
+    if ((int64_t)time(NULL) > way->expires_at) {
+        way->hash = 0;
+        unlock_segment(shm);
+        return NULL;
+    }
+
+    /* Ways match on the hash alone; the record holds the key */
+    const SharedRecord* record  = (const SharedRecord*)arena_at(shm,
+                                                               way->position);
+    const char*         stored  = (const char*)(record + 1);
+    size_t              key_len = strlen(key);
+    char*               buffer  = NULL;
+    if (record->hash == hash && record->key_len == key_len &&
+        memcmp(stored, key, key_len) == 0) {
+        buffer = malloc(record->payload_len + 1);
+    }
+
+    if (buffer) {
+        const char* etag = stored + key_len;
+        memcpy(buffer, etag + record->etag_len, record->payload_len);
+        buffer[record->payload_len] = '\0';
+        if (len) {
+            *len = record->payload_len;
+        }
+        if (info) {
+            info->created_at = record->created_at;
+            info->expires_at = record->expires_at;
+            info->stamp      = record->stamp;
+            memcpy(info->etag, etag, record->etag_len);
+            info->etag[record->etag_len] = '\0';
+        }
+    }
+
+    unlock_segment(shm);
+    return buffer;
+}
+
+int cache_shm_contains(CacheShm* shm, const char* key) {
+    if (!shm || !key || lock_segment(shm) != 0) {
+        return 0;
+    }
+
+    Way* way   = find_way(shm, key_hash(key));
+    int  found = way && (int64_t)time(NULL) <= way->expires_at;
+
+    unlock_segment(shm);
+    return found;
+}
+
+void cache_shm_delete(CacheShm* shm, const char* key) {
+    if (!shm || !key || lock_segment(shm) != 0) {
+        return;
+    }
+
+    Way* way = find_way(shm, key_hash(key));
+    if (way) {
+        way->hash = 0;
+    }
+
+    unlock_segment(shm);
+}
+
+void cache_shm_clear(CacheShm* shm) {
+    if (!shm || lock_segment(shm) != 0) {
+        return;
+    }
+
+    reset_segment(shm->header);
+    unlock_segment(shm);
+}
+
+int cache_shm_get_stats(CacheShm* shm, CacheShmStats* stats) {
+    if (!shm || !stats || lock_segment(shm) != 0) {
+        return -1;
+    }
+
+    SegmentHeader* header = shm->header;
+    Way*           ways   = bucket_of(shm, 0);
+    int64_t        now    = (int64_t)time(NULL);
+
+    memset(stats, 0, sizeof(CacheShmStats));
+    stats->arena_bytes = header->arena_size;
+    for (uint64_t i = 0; i < header->bucket_count * CACHE_SHM_WAYS; i++) {
+        if (way_live(header, &ways[i]) && ways[i].expires_at >= now) {
+            stats->records++;
+            stats->bytes += ways[i].length;
+        }
+    }
+
+    unlock_segment(shm);
+    return 0;
+}
+
+int cache_shm_unlink(const char* name) {
+    return name && shm_unlink(name) == 0 ? 0 : -1;
+}
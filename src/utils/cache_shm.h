@@ -0,0 +1,151 @@
+/**
+ * @file cache_shm.h
+ * @brief Host-wide shared-memory cache segment
+ *
+ * This header provides a response cache that lives in a POSIX shared
+ * memory object (shm_open() + mmap()), so every process on the host that
+ * attaches to the same segment sees the same entries. A short-lived CLI
+ * invocation can then serve a repeat lookup from memory filled by an
+ * earlier one instead of going to disk or the network.
+ *
+ * Layout: a header with a process-shared robust mutex, a set-associative
+ * index (buckets of CACHE_SHM_WAYS slots) and a ring-buffer arena that
+ * records are appended to. When the arena wraps, the oldest records are
+ * overwritten; slots pointing at overwritten space are treated as empty.
+ *
+ * Features:
+ * - O(1) put, get and delete, no system call after attaching
+ * - FIFO replacement without fragmentation, bounded by the segment size
+ * - Per-record expiry and ETag
+ * - A process that dies while holding the lock cannot wedge the others:
+ *   the next locker resets the segment (its contents are only a cache)
+ *
+ * The segment persists until reboot or until it is unlinked with
+ * cache_shm_unlink().
+ */
+#ifndef CACHE_SHM_H
+#define CACHE_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define CACHE_SHM_WAYS 8       ///< Index slots per bucket
+#define CACHE_SHM_ETAG_MAX 128 ///< Longest ETag stored (including NUL)
+
+/**
+ * @struct CacheShm
+ * @brief Attached shared segment (opaque)
+ */
+typedef struct CacheShm CacheShm;
+
+/**
+ * @struct CacheShmRecordInfo
+ * @brief Metadata of a shared record
+ */
+typedef struct {
+    int64_t  created_at;               /**< When the record was stored */
+    int64_t  expires_at;               /**< Absolute expiry time */
+    uint64_t stamp;                    /**< Store stamp (cache_tombstone.h) */
+    char     etag[CACHE_SHM_ETAG_MAX]; /**< ETag, empty if none */
+} CacheShmRecordInfo;
+
+/**
+ * @struct CacheShmStats
+ * @brief Occupancy of a segment
+ */
+typedef struct {
+    size_t records;     /**< Live records */
+    size_t bytes;       /**< Arena bytes held by live records */
+    size_t arena_bytes; /**< Arena size */
+} CacheShmStats;
+
+/**
+ * @brief Attaches to a segment, creating it if it does not exist yet
+ *
+ * The size is only used by the process that creates the segment; later
+ * processes use whatever size it has.
+ *
+ * @param name POSIX shared memory name, e.g.
+ *             "/just-weather-cache-1000-3f1c9a0e5b7d2468-v2"
+ * @param size Segment size in bytes for a new segment
+ *
+ * @return Attached segment, or NULL on failure or if the segment was
+ *         created by an incompatible version
+ */
+CacheShm* cache_shm_attach(const char* name, size_t size);
+
+/**
+ * @brief Detaches from the segment (safe to call with NULL)
+ *
+ * The segment and its contents stay available to other processes.
+ */
+void cache_shm_detach(CacheShm* shm);
+
+/**
+ * @brief Stores a record, replacing any previous record of the key
+ *
+ * @param shm Attached segment
+ * @param key Cache key
+ * @param data Payload bytes
+ * @param len Payload length (at most a quarter of the arena)
+ * @param created_at Creation time stored with the record
+ * @param expires_at Absolute expiry time
+ * @param stamp Store stamp from cache_tombstones_stamp()
+ * @param etag Entity tag, or NULL
+ *
+ * @return 0 on success, -1 if the record is too large or the lock failed
+ */
+int cache_shm_put(CacheShm* shm, const char* key, const char* data,
+                  size_t len, time_t created_at, time_t expires_at,
+                  uint64_t stamp, const char* etag);
+
+/**
+ * @brief Copies out the record of a key
+ *
+ * @param shm Attached segment
+ * @param key Cache key
+ * @param len Output: payload length
+ * @param info Output: record metadata (may be NULL)
+ *
+ * @return Payload (NUL-terminated, caller frees), or NULL on miss, expiry
+ *         or allocation failure
+ */
+char* cache_shm_get(CacheShm* shm, const char* key, size_t* len,
+                    CacheShmRecordInfo* info);
+
+/**
+ * @brief Checks for a live record of a key without copying it out
+ *
+ * Like cache_shm_get(), matches on the key hash; a rare collision only
+ * means a record is not re-put.
+ *
+ * @return 1 if present and unexpired, 0 otherwise
+ */
+int cache_shm_contains(CacheShm* shm, const char* key);
+
+/**
+ * @brief Deletes the record of a key (a no-op if there is none)
+ */
+void cache_shm_delete(CacheShm* shm, const char* key);
+
+/**
+ * @brief Deletes every record
+ */
+void cache_shm_clear(CacheShm* shm);
+
+/**
+ * @brief Fills in occupancy (walks the index: meant for reporting)
+ *
+ * @return 0 on success, -1 on invalid arguments or if the lock failed
+ */
+int cache_shm_get_stats(CacheShm* shm, CacheShmStats* stats);
+
+/**
+ * @brief Removes the segment name; attached processes keep their mapping
+ *
+ * @return 0 on success, -1 on failure
+ */
+int cache_shm_unlink(const char* name);
+
+#endif
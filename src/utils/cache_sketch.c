@@ -0,0 +1,115 @@
+/**
+ * @file cache_sketch.c
+ * @brief Count-min frequency sketch implementation
+ *
+ * See cache_sketch.h for detailed API documentation.
+ */
+#include "cache_sketch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SKETCH_ROWS 4
+#define SKETCH_MIN_WIDTH 64
+
+struct CacheSketch {
+    uint8_t* counters; /* SKETCH_ROWS rows of width counters */
+    size_t   width;    /* power of two */
+    size_t   samples;
+    size_t   sample_period;
+};
+
+static const uint64_t ROW_SEEDS[SKETCH_ROWS] = {
+    0xc3a5c85c97cb3127ULL,
+    0xb492b66fbe98f273ULL,
+    0x9ae16a3b2f90404fULL,
+    0xcbf29ce484222325ULL,
+};
+
+static size_t row_slot(const CacheSketch* sketch, int row, uint64_t hash) {
+    /* Mix the key hash with a per-row seed so the rows collide differently */
+    uint64_t mixed = (hash ^ ROW_SEEDS[row]) * 0x9E3779B97F4A7C15ULL;
+    mixed ^= mixed >> 29;
+    return (size_t)row * sketch->width + (size_t)(mixed & (sketch->width - 1));
+}
+
+static void age(CacheSketch* sketch) {
+    size_t total = sketch->width * SKETCH_ROWS;
+    for (size_t i = 0; i < total; i++) {
+        sketch->counters[i] >>= 1;
+    }
+    sketch->samples /= 2;
+}
+
+CacheSketch* cache_sketch_create(size_t capacity) {
+    CacheSketch* sketch = calloc(1, sizeof(CacheSketch));
+    if (!sketch) {
+        return NULL;
+    }
+
+    size_t width = SKETCH_MIN_WIDTH;
+    while (width < capacity * 4) {
+        width *= 2;
+    }
+
+    sketch->counters = calloc(width * SKETCH_ROWS, sizeof(uint8_t));
+    if (!sketch->counters) {
+        free(sketch);
+        return NULL;
+    }
+
+    sketch->width         = width;
+    sketch->sample_period = (capacity > 0 ? capacity : 1) * 10;
+
+    return sketch;
+}
+
+void cache_sketch_destroy(CacheSketch* sketch) {
+    if (sketch) {
+        free(sketch->counters);
+        free(sketch);
+    }
+}
+
+void cache_sketch_increment(CacheSketch* sketch, uint64_t hash) {
+    if (!sketch) {
+        return;
+    }
+
+    /* Conservative update: only raise the counters holding the minimum */
+    unsigned int current = cache_sketch_estimate(sketch, hash);
+    if (current < CACHE_SKETCH_MAX_COUNT) {
+        for (int row = 0; row < SKETCH_ROWS; row++) {
+            uint8_t* counter = &sketch->counters[row_slot(sketch, row, hash)];
+            if (*counter == current) {
+                (*counter)++;
+            }
+        }
+    }
+
+    if (++sketch->samples >= sketch->sample_period) {
+        age(sketch);
+    }
+}
+
+unsigned int cache_sketch_estimate(const CacheSketch* sketch, uint64_t hash) {
+    if (!sketch) {
+        return 0;
+    }
+
+    unsigned int estimate = CACHE_SKETCH_MAX_COUNT;
+    for (int row = 0; row < SKETCH_ROWS; row++) {
+        uint8_t counter = sketch->counters[row_slot(sketch, row, hash)];
+        if (counter < estimate) {
+            estimate = counter;
+        }
+    }
+    return estimate;
+}
+
+void cache_sketch_reset(CacheSketch* sketch) {
+    if (sketch) {
+        memset(sketch->counters, 0, sketch->width * SKETCH_ROWS);
+        sketch->samples = 0;
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * @file cache_sketch.h
+ * @brief Count-min frequency sketch with periodic aging
+ *
+ * This header provides a compact, approximate access-frequency counter used
+ * by ClientCache for TinyLFU admission. Each key is counted in four rows of
+ * small saturating counters; the estimate is the minimum over the rows, so
+ * collisions can only overestimate.
+ *
+ * Features:
+ * - Fixed memory: one byte per counter, four rows
+ * - O(1) increment and estimate
+ * - Aging: after a sample period every counter is halved, so keys that were
+ *   popular long ago gradually lose their advantage
+ */
+#ifndef CACHE_SKETCH_H
+#define CACHE_SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_SKETCH_MAX_COUNT 15 ///< Counters saturate at this value
+
+/**
+ * @struct CacheSketch
+ * @brief Frequency sketch (opaque)
+ */
+typedef struct CacheSketch CacheSketch;
+
+/**
+ * @brief Creates a sketch sized for a cache of the given capacity
+ *
+ * The row width is derived from the capacity and the sample period (the
+ * number of increments between two aging passes) is ten times the capacity.
+ *
+ * @param capacity Number of entries the owning cache can hold
+ *
+ * @return New sketch, or NULL on allocation failure
+ */
+CacheSketch* cache_sketch_create(size_t capacity);
+
+/**
+ * @brief Frees a sketch (safe to call with NULL)
+ */
+void cache_sketch_destroy(CacheSketch* sketch);
+
+/**
+ * @brief Records one access to the key with the given hash
+ *
+ * @param sketch Sketch to update
+ * @param hash 64-bit hash of the key
+ */
+void cache_sketch_increment(CacheSketch* sketch, uint64_t hash);
+
+/**
+ * @brief Estimates how often the key with the given hash was accessed
+ *
+ * @param sketch Sketch to query
+ * @param hash 64-bit hash of the key
+ *
+ * @return Estimated (aged) access count, 0..CACHE_SKETCH_MAX_COUNT
+ */
+unsigned int cache_sketch_estimate(const CacheSketch* sketch, uint64_t hash);
+
+/**
+ * @brief Forgets all recorded accesses
+ */
+void cache_sketch_reset(CacheSketch* sketch);
+
+#endif
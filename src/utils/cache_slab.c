@@ -0,0 +1,335 @@
+/**
+ * @file cache_slab.c
+ * @brief Slab and arena allocator implementation
+ *
+ * See cache_slab.h for detailed API documentation.
+ */
+#include "cache_slab.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLAB_ALIGN 16
+#define ARENA_MIN_BLOCK 16
+/* 16, 24, 32, 48, ... up to CACHE_ARENA_MAX_BLOCK: two per doubling */
+#define ARENA_CLASSES 29
+
+typedef struct SlabFree SlabFree;
+struct SlabFree {
+    SlabFree* next;
+};
+
+/* Chunk layout: this header padded to SLAB_ALIGN, then the objects. A chunk
+ * is aligned to its size rounded up to a power of two, so the chunk of an
+ * object is found by masking its address. */
+typedef struct SlabChunk SlabChunk;
+struct SlabChunk {
+    SlabChunk* prev;      /* on the slab's partial or full list */
+    SlabChunk* next;
+    SlabFree*  free_list; /* handed back, reused first */
+    size_t     carved;    /* objects handed out at least once */
+    size_t     in_use;
+};
+
+struct CacheSlab {
+    size_t     object_size;
+    size_t     per_chunk;   /* objects per chunk */
+    size_t     chunk_align; /* power of two, at least the chunk size */
+    SlabChunk* partial;     /* chunks with room, allocated from first */
+    SlabChunk* full;
+    SlabChunk* spare;       /* one empty chunk kept against churn */
+    size_t     chunk_count;
+    size_t     in_use;
+    uint64_t   heap_allocations;
+};
+
+struct CacheArena {
+    CacheSlab* classes[ARENA_CLASSES]; /* created on first use */
+    size_t     large_bytes;            /* handed out past the classes */
+    uint64_t   large_allocations;
+};
+
+static size_t align_up(size_t size) {
+    return (size + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1);
+}
+
+static size_t chunk_header_size(void) {
+    return align_up(sizeof(SlabChunk));
+}
+
+static size_t chunk_size(const CacheSlab* slab) {
+    return chunk_header_size() + slab->per_chunk * slab->object_size;
+}
+
+CacheSlab* cache_slab_create(size_t object_size) {
+    if (object_size == 0) {
+        return NULL;
+    }
+
+    CacheSlab* slab = calloc(1, sizeof(CacheSlab));
+    if (!slab) {
+        return NULL;
+    }
+
+    slab->object_size = align_up(object_size);
+    slab->per_chunk   = CACHE_SLAB_CHUNK / slab->object_size;
+    if (slab->per_chunk == 0) {
+        slab->per_chunk = 1;
+    }
+
+    slab->chunk_align = SLAB_ALIGN;
+    while (slab->chunk_align < chunk_size(slab)) {
+        slab->chunk_align *= 2;
+    }
+    return slab;
+}
+
+static void free_chunks(SlabChunk* chunk) {
+    while (chunk) {
+        SlabChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+void cache_slab_reset(CacheSlab* slab) {
+    if (!slab) {
+        return;
+    }
+
+    free_chunks(slab->partial);
+    free_chunks(slab->full);
+    free(slab->spare);
+    slab->partial     = NULL;
+    slab->full        = NULL;
+    slab->spare       = NULL;
+    slab->chunk_count = 0;
+    slab->in_use      = 0;
+}
+
+void cache_slab_destroy(CacheSlab* slab) {
+    cache_slab_reset(slab);
+    free(slab);
+}
+
+static void unlink_chunk(SlabChunk** list, SlabChunk* chunk) {
+    if (chunk->prev) {
+        chunk->prev->next = chunk->next;
+    } else {
+        *list = chunk->next;
+    }
+    if (chunk->next) {
+        chunk->next->prev = chunk->prev;
+    }
+}
+
+static void push_chunk(SlabChunk** list, SlabChunk* chunk) {
+    chunk->prev = NULL;
+    chunk->next = *list;
+    if (*list) {
+        (*list)->prev = chunk;
+    }
+    *list = chunk;
+}
+
+static SlabChunk* new_chunk(CacheSlab* slab) {
+    SlabChunk* chunk = slab->spare;
+    if (chunk) {
+        slab->spare = NULL;
+    } else {
+        if (posix_memalign((void**)&chunk, slab->chunk_align,
+                           chunk_size(slab)) != 0) {
+            return NULL;
+        }
+        slab->chunk_count++;
+        slab->heap_allocations++;
+    }
+
+    chunk->free_list = NULL;
+    chunk->carved    = 0;
+    chunk->in_use    = 0;
+    return chunk;
+}
+
+void* cache_slab_alloc(CacheSlab* slab) {
+    if (!slab) {
+        return NULL;
+    }
+
+    SlabChunk* chunk = slab->partial;
+    if (!chunk) {
+        if (!(chunk = new_chunk(slab))) {
+            return NULL;
+        }
+        push_chunk(&slab->partial, chunk);
+    }
+
+    void* object;
+    if (chunk->free_list) {
+        object           = chunk->free_list;
+        chunk->free_list = chunk->free_list->next;
+    } else {
+        /* Carved lazily, so a new chunk costs no pass over its objects */
+        object = (char*)chunk + chunk_header_size() +
+                 chunk->carved * slab->object_size;
+        chunk->carved++;
+    }
+
+    if (++chunk->in_use == slab->per_chunk) {
+        unlink_chunk(&slab->partial, chunk);
+        push_chunk(&slab->full, chunk);
+    }
+    slab->in_use++;
+    return object;
+}
+
+void cache_slab_free(CacheSlab* slab, void* object) {
+    if (!slab || !object) {
+        return;
+    }
+
+    SlabChunk* chunk =
+        (SlabChunk*)((uintptr_t)object & ~(uintptr_t)(slab->chunk_align - 1));
+    SlabFree* node   = object;
+    node->next       = chunk->free_list;
+    chunk->free_list = node;
+    slab->in_use--;
+
+    if (chunk->in_use-- == slab->per_chunk) {
+        unlink_chunk(&slab->full, chunk);
+        push_chunk(&slab->partial, chunk);
+    }
+    if (chunk->in_use > 0) {
+        return;
+    }
+
+    /* The last object is back: the chunk goes to the system, except for
+     * one spare that absorbs a free/alloc pair at the chunk boundary */
+    unlink_chunk(&slab->partial, chunk);
+    if (!slab->spare) {
+        slab->spare = chunk;
+        return;
+    }
+    free(chunk);
+    slab->chunk_count--;
+}
+
+void cache_slab_get_stats(const CacheSlab* slab, CacheSlabStats* stats) {
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(CacheSlabStats));
+    if (!slab) {
+        return;
+    }
+
+    stats->reserved_bytes   = slab->chunk_count * chunk_size(slab);
+    stats->used_bytes       = slab->in_use * slab->object_size;
+    stats->heap_allocations = slab->heap_allocations;
+}
+
+/* Smallest class holding size bytes, or -1 if it exceeds every class */
+static int size_class(size_t size) {
+    if (size <= ARENA_MIN_BLOCK) {
+        return 0;
+    }
+    if (size > CACHE_ARENA_MAX_BLOCK) {
+        return -1;
+    }
+
+    /* 2^b < size <= 2^(b+1); the candidates are 1.5 * 2^b and 2^(b+1) */
+    int b = 63 - __builtin_clzll((unsigned long long)(size - 1));
+    return size <= (size_t)3 << (b - 1) ? 2 * (b - 4) + 1 : 2 * (b - 3);
+}
+
+static size_t class_size(int index) {
+    size_t base = (size_t)ARENA_MIN_BLOCK << (index / 2);
+    return index % 2 ? base + base / 2 : base;
+}
+
+CacheArena* cache_arena_create(void) {
+    return calloc(1, sizeof(CacheArena));
+}
+
+void cache_arena_destroy(CacheArena* arena) {
+    if (!arena) {
+        return;
+    }
+
+    for (int i = 0; i < ARENA_CLASSES; i++) {
+        cache_slab_destroy(arena->classes[i]);
+    }
+    free(arena);
+}
+
+void* cache_arena_alloc(CacheArena* arena, size_t size) {
+    if (!arena) {
+        return NULL;
+    }
+
+    int index = size_class(size);
+    if (index < 0) {
+        void* block = malloc(size);
+        if (block) {
+            arena->large_bytes += size;
+            arena->large_allocations++;
+        }
+        return block;
+    }
+
+    if (!arena->classes[index]) {
+        arena->classes[index] = cache_slab_create(class_size(index));
+        if (!arena->classes[index]) {
+            return NULL;
+        }
+    }
+    return cache_slab_alloc(arena->classes[index]);
+}
+
+void cache_arena_free(CacheArena* arena, void* block, size_t size) {
+    if (!arena || !block) {
+        return;
+    }
+
+    int index = size_class(size);
+    if (index < 0) {
+        arena->large_bytes -= size;
+        free(block);
+        return;
+    }
+    cache_slab_free(arena->classes[index], block);
+}
+
+void cache_arena_reset(CacheArena* arena) {
+    if (!arena) {
+        return;
+    }
+
+    for (int i = 0; i < ARENA_CLASSES; i++) {
+        cache_slab_reset(arena->classes[i]);
+    }
+}
+
+void cache_arena_get_stats(const CacheArena* arena, CacheSlabStats* stats) {
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(CacheSlabStats));
+    if (!arena) {
+        return;
+    }
+
+    for (int i = 0; i < ARENA_CLASSES; i++) {
+        CacheSlabStats class_stats;
+        cache_slab_get_stats(arena->classes[i], &class_stats);
+        stats->reserved_bytes += class_stats.reserved_bytes;
+        stats->used_bytes += class_stats.used_bytes;
+        stats->heap_allocations += class_stats.heap_allocations;
+    }
+    stats->reserved_bytes += arena->large_bytes;
+    stats->used_bytes += arena->large_bytes;
+    stats->heap_allocations += arena->large_allocations;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file cache_slab.h
+ * @brief Slab and size-classed arena allocation for cache entries
+ *
+ * Resident cache entries used to cost one malloc() each for the entry, its
+ * key, its payload and its ETag, scattered over the heap and returned to it
+ * on every eviction. A slab hands out fixed-size objects carved from large
+ * chunks and keeps freed objects on a free list for reuse; an arena keeps
+ * one slab per size class, so payloads of any size are served the same way.
+ *
+ * Features:
+ * - O(1) allocate and free without touching the system allocator once the
+ *   working set has been reached
+ * - Size classes at powers of two and the midpoints between them, so a
+ *   block wastes at most a third of its size
+ * - Blocks larger than the biggest class fall back to malloc()
+ * - Accounting of the chunk memory reserved, the part in use and the
+ *   number of system allocations made
+ * - Chunks that empty out are released, so memory follows the working set
+ *
+ * A chunk goes back to the system as soon as its last object is freed;
+ * each slab keeps one empty chunk as a spare, so that a free followed by an
+ * allocation does not cost a malloc() each time. Chunks are aligned to
+ * their size rounded up to a power of two, which finds an object's chunk
+ * in O(1). The allocators are not thread-safe; ClientCache only uses them
+ * from the thread that owns the cache.
+ */
+#ifndef CACHE_SLAB_H
+#define CACHE_SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_SLAB_CHUNK (64 * 1024)       ///< Bytes per chunk at least
+#define CACHE_ARENA_MAX_BLOCK (256 * 1024) ///< Biggest size class
+
+/**
+ * @struct CacheSlab
+ * @brief Fixed-size object allocator (opaque)
+ */
+typedef struct CacheSlab CacheSlab;
+
+/**
+ * @struct CacheArena
+ * @brief Size-classed block allocator (opaque)
+ */
+typedef struct CacheArena CacheArena;
+
+/**
+ * @struct CacheSlabStats
+ * @brief Memory accounting of a slab or arena
+ */
+typedef struct {
+    size_t   reserved_bytes;   /**< Chunks and large blocks held */
+    size_t   used_bytes;       /**< Objects and blocks handed out */
+    uint64_t heap_allocations; /**< malloc() calls made so far */
+} CacheSlabStats;
+
+/**
+ * @brief Creates a slab of objects of one size
+ *
+ * @param object_size Object size; rounded up to a multiple of 16
+ *
+ * @return New slab, or NULL on allocation failure
+ */
+CacheSlab* cache_slab_create(size_t object_size);
+
+/**
+ * @brief Frees the slab and every chunk it holds (safe to call with NULL)
+ */
+void cache_slab_destroy(CacheSlab* slab);
+
+/**
+ * @brief Hands out an object, 16-byte aligned and not zeroed
+ *
+ * @return Object, or NULL on allocation failure
+ */
+void* cache_slab_alloc(CacheSlab* slab);
+
+/**
+ * @brief Takes back an object of this slab (a no-op for NULL)
+ */
+void cache_slab_free(CacheSlab* slab, void* object);
+
+/**
+ * @brief Frees every chunk; all objects handed out become invalid
+ */
+void cache_slab_reset(CacheSlab* slab);
+
+/**
+ * @brief Fills in memory accounting
+ */
+void cache_slab_get_stats(const CacheSlab* slab, CacheSlabStats* stats);
+
+/**
+ * @brief Creates an empty arena; size classes get their slab on first use
+ *
+ * @return New arena, or NULL on allocation failure
+ */
+CacheArena* cache_arena_create(void);
+
+/**
+ * @brief Frees the arena and all its memory (safe to call with NULL)
+ */
+void cache_arena_destroy(CacheArena* arena);
+
+/**
+ * @brief Hands out a block of at least size bytes, 16-byte aligned
+ *
+ * @param arena Arena
+ * @param size Bytes needed; 0 is treated as 1
+ *
+ * @return Block, or NULL on allocation failure
+ */
+void* cache_arena_alloc(CacheArena* arena, size_t size);
+
+/**
+ * @brief Takes back a block
+ *
+ * @param arena Arena the block came from
+ * @param block Block, or NULL for a no-op
+ * @param size The size it was allocated with
+ */
+void cache_arena_free(CacheArena* arena, void* block, size_t size);
+
+/**
+ * @brief Frees all chunks, keeping the arena usable
+ *
+ * Every block handed out becomes invalid; large blocks still handed out
+ * are not tracked and must have been freed before.
+ */
+void cache_arena_reset(CacheArena* arena);
+
+/**
+ * @brief Fills in memory accounting, summed over all size classes
+ */
+void cache_arena_get_stats(const CacheArena* arena, CacheSlabStats* stats);
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * @file cache_tombstone.c
+ * @brief Shared tombstone table implementation
+ *
+ * See cache_tombstone.h for detailed API documentation.
+ */
+#include "cache_tombstone.h"
+
+#include "file_lock.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TOMBSTONE_MAGIC "JWCT"
+#define TOMBSTONE_VERSION 2
+#define TOMBSTONE_FILE_SIZE sizeof(TombstoneTable)
+#define TOMBSTONE_STAMP_SHIFT 20 /* a new table's stamps start at time << 20 */
+
+typedef struct {
+    uint64_t stamp;      /* records stamped before it are invalidated */
+    int64_t  expires_at; /* every record it covers has expired by then */
+    char     prefix[CACHE_TOMBSTONE_PREFIX_MAX]; /* NUL-terminated */
+} Tombstone;
+
+/* Shared table; slots [0, count) are in use */
+typedef struct {
+    char      magic[4];
+    uint32_t  version;
+    uint32_t  count;
+    uint32_t  reserved;
+    uint64_t  changes;    /* bumped by every add and reset */
+    uint64_t  stamp;      /* current stamp, moved on by every add */
+    int64_t   expires_at; /* latest expiry of a stamped record */
+    Tombstone slots[CACHE_TOMBSTONE_SLOTS];
+} TombstoneTable;
+
+struct CacheTombstones {
+    int             fd;
+    TombstoneTable* table; /* shared mapping of the table file */
+    FileLock        lock;
+};
+
+static void bump_changes(TombstoneTable* table) {
+    __atomic_fetch_add(&table->changes, 1, __ATOMIC_RELEASE);
+}
+
+CacheTombstones* cache_tombstones_open(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    CacheTombstones* tombstones = calloc(1, sizeof(CacheTombstones));
+    if (!tombstones) {
+        return NULL;
+    }
+
+    tombstones->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (tombstones->fd < 0) {
+        free(tombstones);
+        return NULL;
+    }
+
+    file_lock_init(&tombstones->lock, tombstones->fd);
+    if (file_lock_acquire(&tombstones->lock, LOCK_EX) != 0) {
+        close(tombstones->fd);
+        file_lock_destroy(&tombstones->lock);
+        free(tombstones);
+        return NULL;
+    }
+
+    struct stat table_stat;
+    int         fresh = fstat(tombstones->fd, &table_stat) != 0 ||
+                table_stat.st_size != (off_t)TOMBSTONE_FILE_SIZE;
+    int         ok    = 1;
+    if (fresh && (ftruncate(tombstones->fd, 0) != 0 ||
+                  ftruncate(tombstones->fd, TOMBSTONE_FILE_SIZE) != 0)) {
+        ok = 0;
+    }
+    if (ok) {
+        void* map = mmap(NULL, TOMBSTONE_FILE_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, tombstones->fd, 0);
+        ok        = map != MAP_FAILED;
+        if (ok) {
+            tombstones->table = map;
+        }
+    }
+
+    if (ok && !fresh) {
+        TombstoneTable* table = tombstones->table;
+        fresh =
+            memcmp(table->magic, TOMBSTONE_MAGIC, sizeof(table->magic)) != 0 ||
+            table->version != TOMBSTONE_VERSION ||
+            table->count > CACHE_TOMBSTONE_SLOTS;
+    }
+    if (ok && fresh) {
+        TombstoneTable* table = tombstones->table;
+        memset(table, 0, sizeof(TombstoneTable));
+        memcpy(table->magic, TOMBSTONE_MAGIC, sizeof(table->magic));
+        table->version = TOMBSTONE_VERSION;
+        /* Above the stamps of a table this one replaces, unless that one
+         * handed out a million stamps a second */
+        table->stamp = (uint64_t)time(NULL) << TOMBSTONE_STAMP_SHIFT;
+    }
+
+    file_lock_release(&tombstones->lock);
+
+    if (!ok) {
+        cache_tombstones_close(tombstones);
+        return NULL;
+    }
+    return tombstones;
+}
+
+void cache_tombstones_close(CacheTombstones* tombstones) {
+    if (!tombstones) {
+        return;
+    }
+
+    if (tombstones->table) {
+        munmap(tombstones->table, TOMBSTONE_FILE_SIZE);
+    }
+    close(tombstones->fd);
+    file_lock_destroy(&tombstones->lock);
+    free(tombstones);
+}
+
+uint64_t cache_tombstones_stamp(CacheTombstones* tombstones,
+                                int64_t          expires_at) {
+    if (!tombstones) {
+        return 0;
+    }
+
+    /* Raise the latest expiry before reading the stamp: a tombstone that
+     * takes the next stamp then also sees this expiry */
+    TombstoneTable* table  = tombstones->table;
+    int64_t         latest = __atomic_load_n(&table->expires_at,
+                                             __ATOMIC_SEQ_CST);
+    while (latest < expires_at &&
+           !__atomic_compare_exchange_n(&table->expires_at, &latest,
+                                        expires_at, 0, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_SEQ_CST)) {
+    }
+    return __atomic_load_n(&table->stamp, __ATOMIC_SEQ_CST);
+}
+
+int cache_tombstones_add(CacheTombstones* tombstones, const char* prefix,
+                         uint64_t* changes) {
+    if (!tombstones || !prefix || !*prefix ||
+        file_lock_acquire(&tombstones->lock, LOCK_EX) != 0) {
+        return -1;
+    }
+
+    char stored[CACHE_TOMBSTONE_PREFIX_MAX];
+    snprintf(stored, sizeof(stored), "%s", prefix);
+    size_t length = strlen(stored);
+
+    /* Tombstones under the new prefix are covered by it from now on, and
+     * expired ones cover nothing that has not expired itself */
+    TombstoneTable* table = tombstones->table;
+    int64_t         now   = (int64_t)time(NULL);
+    uint32_t        kept  = 0;
+    for (uint32_t i = 0; i < table->count; i++) {
+        if (strncmp(table->slots[i].prefix, stored, length) != 0 &&
+            table->slots[i].expires_at >= now) {
+            table->slots[kept++] = table->slots[i];
+        }
+    }
+
+    int result = -1;
+    if (kept < CACHE_TOMBSTONE_SLOTS) {
+        Tombstone* tombstone = &table->slots[kept];
+        tombstone->stamp =
+            __atomic_add_fetch(&table->stamp, 1, __ATOMIC_SEQ_CST);
+        tombstone->expires_at =
+            __atomic_load_n(&table->expires_at, __ATOMIC_SEQ_CST);
+        memcpy(tombstone->prefix, stored, length + 1);
+        kept++;
+        result = 0;
+    }
+    __atomic_store_n(&table->count, kept, __ATOMIC_RELEASE);
+    bump_changes(table);
+    if (changes) {
+        *changes = table->changes;
+    }
+
+    file_lock_release(&tombstones->lock);
+    return result;
+}
+
+int cache_tombstones_covers(CacheTombstones* tombstones, const char* key,
+                            uint64_t stamp) {
+    if (!tombstones || !key ||
+        __atomic_load_n(&tombstones->table->count, __ATOMIC_ACQUIRE) == 0 ||
+        file_lock_acquire(&tombstones->lock, LOCK_SH) != 0) {
+        return 0;
+    }
+
+    const TombstoneTable* table   = tombstones->table;
+    int                   covered = 0;
+    for (uint32_t i = 0; i < table->count; i++) {
+        const Tombstone* tombstone = &table->slots[i];
+        size_t           length    = strlen(tombstone->prefix);
+        if (stamp < tombstone->stamp &&
+            strncmp(key, tombstone->prefix, length) == 0) {
+            covered = 1;
+            break;
+        }
+    }
+
+    file_lock_release(&tombstones->lock);
+    return covered;
+}
+
+void cache_tombstones_for_each(CacheTombstones*    tombstones,
+                               CacheTombstoneVisit visit, void* user_data) {
+    if (!tombstones || !visit ||
+        file_lock_acquire(&tombstones->lock, LOCK_SH) != 0) {
+        return;
+    }
+
+    const TombstoneTable* table = tombstones->table;
+    for (uint32_t i = 0; i < table->count; i++) {
+        visit(table->slots[i].prefix, table->slots[i].stamp, user_data);
+    }
+
+    file_lock_release(&tombstones->lock);
+}
+
+void cache_tombstones_reset(CacheTombstones* tombstones) {
+    if (!tombstones || file_lock_acquire(&tombstones->lock, LOCK_EX) != 0) {
+        return;
+    }
+
+    /* The stamp keeps counting: records stamped before the reset must not
+     * outrank a later tombstone */
+    __atomic_store_n(&tombstones->table->count, 0, __ATOMIC_RELEASE);
+    bump_changes(tombstones->table);
+    file_lock_release(&tombstones->lock);
+}
+
+uint64_t cache_tombstones_version(const CacheTombstones* tombstones) {
+    return tombstones ? __atomic_load_n(&tombstones->table->changes,
+                                        __ATOMIC_ACQUIRE)
+                      : 0;
+}
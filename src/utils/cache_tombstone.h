@@ -0,0 +1,134 @@
+/**
+ * @file cache_tombstone.h
+ * @brief Shared table of invalidated key prefixes
+ *
+ * A process can find its own resident keys under a prefix, but the entries
+ * of the shared segment and of the disk store are named by hash and cannot
+ * be enumerated by prefix without reading all of them. Invalidating a
+ * prefix therefore records a tombstone instead, in a small memory-mapped
+ * table that every process using the cache directory shares.
+ *
+ * Order is kept with stamps rather than clock times. The table holds a
+ * shared counter; every record is stored with its current value
+ * (cache_tombstones_stamp()), and every tombstone moves it on and takes
+ * the new value. A record whose key starts with a tombstoned prefix and
+ * whose stamp is lower than the tombstone's was stored before the
+ * invalidation: it is stale, and is deleted when it is found. A record
+ * stored again right after the invalidation, in the same second or not,
+ * is not.
+ *
+ * Features:
+ * - Adding a tombstone is O(prefix length), however many keys it covers
+ * - Lock-free check while the table is empty, the usual case
+ * - A new prefix absorbs the tombstones of longer prefixes it covers
+ * - Tombstones expire with the records they cover: the table tracks the
+ *   latest expiry of any stamped record, and a tombstone's slot is reused
+ *   once that time, as of its adding, has passed
+ * - A change counter tells processes when to re-check resident entries
+ *
+ * The table has a fixed number of slots; adding only fails when every
+ * slot holds a live tombstone. A table that is recreated (missing or of
+ * another format) starts its stamps from the clock, above those of the
+ * table it replaces, but only knows the expiry of records stamped since.
+ */
+#ifndef CACHE_TOMBSTONE_H
+#define CACHE_TOMBSTONE_H
+
+#include <stdint.h>
+
+#define CACHE_TOMBSTONE_SLOTS 64       ///< Prefixes the table holds
+#define CACHE_TOMBSTONE_PREFIX_MAX 120 ///< Longer prefixes are cut short
+
+/**
+ * @struct CacheTombstones
+ * @brief Open tombstone table (opaque)
+ */
+typedef struct CacheTombstones CacheTombstones;
+
+/**
+ * @brief Receives one tombstone from cache_tombstones_for_each()
+ *
+ * @param prefix Invalidated prefix
+ * @param stamp Records stamped lower than this are invalidated
+ * @param user_data As passed to cache_tombstones_for_each()
+ */
+typedef void (*CacheTombstoneVisit)(const char* prefix, uint64_t stamp,
+                                    void* user_data);
+
+/**
+ * @brief Opens (creating if needed) a tombstone table file
+ *
+ * A table that is missing, truncated or of another format is recreated
+ * empty.
+ *
+ * @param path Table file path
+ *
+ * @return Open table, or NULL on failure
+ */
+CacheTombstones* cache_tombstones_open(const char* path);
+
+/**
+ * @brief Closes the table (safe to call with NULL)
+ */
+void cache_tombstones_close(CacheTombstones* tombstones);
+
+/**
+ * @brief Stamp to store with a new record
+ *
+ * Lock-free. Also raises the table's latest expiry to expires_at, so that
+ * a tombstone covering the record lasts as long as the record.
+ *
+ * @param tombstones Open table
+ * @param expires_at When the record expires
+ *
+ * @return Current stamp, or 0 for a NULL table
+ */
+uint64_t cache_tombstones_stamp(CacheTombstones* tombstones,
+                                int64_t          expires_at);
+
+/**
+ * @brief Records that every key under prefix is invalidated as of now
+ *
+ * Records stamped before this call are covered, records stamped after it
+ * are not. Expired tombstones are dropped first to make room. A prefix
+ * longer than CACHE_TOMBSTONE_PREFIX_MAX - 1 characters is cut short,
+ * which invalidates more keys rather than fewer.
+ *
+ * @param tombstones Open table
+ * @param prefix Prefix, not empty
+ * @param changes Output: the change counter after this add (may be NULL)
+ *
+ * @return 0 on success, -1 on error or if the table is full
+ */
+int cache_tombstones_add(CacheTombstones* tombstones, const char* prefix,
+                         uint64_t* changes);
+
+/**
+ * @brief Whether a record of key stored with stamp was invalidated
+ *
+ * @return 1 if a tombstone covers it, 0 otherwise (also for a NULL table)
+ */
+int cache_tombstones_covers(CacheTombstones* tombstones, const char* key,
+                            uint64_t stamp);
+
+/**
+ * @brief Calls visit for every tombstone
+ *
+ * Called with the table locked; visit must not call back into it.
+ */
+void cache_tombstones_for_each(CacheTombstones*    tombstones,
+                               CacheTombstoneVisit visit, void* user_data);
+
+/**
+ * @brief Removes every tombstone; stamps keep counting from where they are
+ */
+void cache_tombstones_reset(CacheTombstones* tombstones);
+
+/**
+ * @brief Change counter, bumped by every add and reset
+ *
+ * A plain load from the shared mapping; 0 for a NULL table.
+ */
+uint64_t cache_tombstones_version(const CacheTombstones* tombstones);
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ * @file cache_wheel.c
+ * @brief Timing wheel implementation
+ *
+ * See cache_wheel.h for detailed API documentation.
+ */
+#include "cache_wheel.h"
+
+#include <stdlib.h>
+
+/* Every slot is a circular list behind a sentinel timer */
+struct CacheWheel {
+    CacheWheelTimer inner[CACHE_WHEEL_SLOTS];       /* current window */
+    CacheWheelTimer outer[CACHE_WHEEL_OUTER_SLOTS]; /* later windows */
+    int64_t         current; /* seconds before it are expired */
+    size_t          count;
+};
+
+static int64_t window_of(int64_t second) {
+    return second / CACHE_WHEEL_SLOTS;
+}
+
+static void init_slots(CacheWheel* wheel) {
+    for (size_t i = 0; i < CACHE_WHEEL_SLOTS; i++) {
+        wheel->inner[i].prev = &wheel->inner[i];
+        wheel->inner[i].next = &wheel->inner[i];
+    }
+    for (size_t i = 0; i < CACHE_WHEEL_OUTER_SLOTS; i++) {
+        wheel->outer[i].prev = &wheel->outer[i];
+        wheel->outer[i].next = &wheel->outer[i];
+    }
+    wheel->count = 0;
+}
+
+static void link_timer(CacheWheelTimer* head, CacheWheelTimer* timer) {
+    timer->prev      = head->prev;
+    timer->next      = head;
+    head->prev->next = timer;
+    head->prev       = timer;
+}
+
+static void unlink_timer(CacheWheelTimer* timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev       = NULL;
+    timer->next       = NULL;
+}
+
+/* Overdue timers go to the slot expired next; timers past the current
+ * window wait in the outer slot of theirs */
+static CacheWheelTimer* slot_of(CacheWheel* wheel, int64_t expires_at) {
+    int64_t second = expires_at > wheel->current ? expires_at : wheel->current;
+    if (window_of(second) == window_of(wheel->current)) {
+        return &wheel->inner[second % CACHE_WHEEL_SLOTS];
+    }
+    return &wheel->outer[window_of(second) % CACHE_WHEEL_OUTER_SLOTS];
+}
+
+/* A new window started: spread its outer slot over the inner one; timers
+ * of a later lap land in the same outer slot again */
+static void cascade(CacheWheel* wheel) {
+    CacheWheelTimer* head =
+        &wheel->outer[window_of(wheel->current) % CACHE_WHEEL_OUTER_SLOTS];
+    CacheWheelTimer* timer = head->next;
+    head->prev             = head;
+    head->next             = head;
+
+    while (timer != head) {
+        CacheWheelTimer* next = timer->next;
+        link_timer(slot_of(wheel, timer->expires_at), timer);
+        timer = next;
+    }
+}
+
+CacheWheel* cache_wheel_create(int64_t now) {
+    CacheWheel* wheel = calloc(1, sizeof(CacheWheel));
+    if (!wheel) {
+        return NULL;
+    }
+
+    init_slots(wheel);
+    wheel->current = now;
+    return wheel;
+}
+
+void cache_wheel_destroy(CacheWheel* wheel) {
+    free(wheel);
+}
+
+void cache_wheel_add(CacheWheel* wheel, CacheWheelTimer* timer,
+                     int64_t expires_at) {
+    if (!wheel || !timer) {
+        return;
+    }
+
+    cache_wheel_remove(wheel, timer);
+    timer->expires_at = expires_at;
+    link_timer(slot_of(wheel, expires_at), timer);
+    wheel->count++;
+}
+
+void cache_wheel_remove(CacheWheel* wheel, CacheWheelTimer* timer) {
+    if (!wheel || !timer || !timer->next) {
+        return;
+    }
+
+    unlink_timer(timer);
+    wheel->count--;
+}
+
+size_t cache_wheel_advance(CacheWheel* wheel, int64_t now, size_t budget,
+                           CacheWheelExpire expire, void* user_data) {
+    if (!wheel || !expire) {
+        return 0;
+    }
+
+    /* Nothing to spread or expire: skip the idle seconds at once */
+    if (wheel->count == 0) {
+        if (now > wheel->current) {
+            wheel->current = now;
+        }
+        return 0;
+    }
+
+    /* The wheel stops at now rather than past it, so that a timer added
+     * for now is due on the next call */
+    size_t expired = 0;
+    while (wheel->current <= now) {
+        CacheWheelTimer* head =
+            &wheel->inner[wheel->current % CACHE_WHEEL_SLOTS];
+        while (head->next != head) {
+            if (expired == budget) {
+                return expired;
+            }
+
+            CacheWheelTimer* timer = head->next;
+            unlink_timer(timer);
+            wheel->count--;
+            expire(timer, user_data);
+            expired++;
+        }
+
+        if (wheel->current == now) {
+            break;
+        }
+        wheel->current++;
+        if (wheel->current % CACHE_WHEEL_SLOTS == 0) {
+            cascade(wheel);
+        }
+    }
+    return expired;
+}
+
+void cache_wheel_clear(CacheWheel* wheel) {
+    if (wheel) {
+        init_slots(wheel);
+    }
+}
+
+size_t cache_wheel_count(const CacheWheel* wheel) {
+    return wheel ? wheel->count : 0;
+}
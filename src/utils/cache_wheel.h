@@ -0,0 +1,122 @@
+/**
+ * @file cache_wheel.h
+ * @brief Hashed timing wheel for entry expiry
+ *
+ * Resident cache entries used to be checked for expiry only when their key
+ * was requested, so an entry nobody asks for again held its memory until
+ * the LRU pushed it out. The wheel files every entry under the second it
+ * expires in, so that the cache can reclaim what is due in a few steps per
+ * call instead of scanning its lists.
+ *
+ * Features:
+ * - O(1) add and remove: timers are embedded in their owner and linked
+ *   into the slot of their expiry second
+ * - Two levels: CACHE_WHEEL_SLOTS one-second slots for the current window,
+ *   and CACHE_WHEEL_OUTER_SLOTS slots of one window each beyond it; a slot
+ *   of the outer level is spread over the inner one when its window comes
+ *   up, and timers further out than the outer level stay for another lap
+ * - Expiry runs to a budget, resuming where it stopped on the next call
+ *
+ * Times are whole seconds, like the entries' TTLs. The wheel is not
+ * thread-safe; ClientCache only uses it from the thread that owns the
+ * cache.
+ */
+#ifndef CACHE_WHEEL_H
+#define CACHE_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_WHEEL_SLOTS 256      ///< One-second slots, a power of two
+#define CACHE_WHEEL_OUTER_SLOTS 64 ///< Window-long slots, a power of two
+
+/**
+ * @struct CacheWheelTimer
+ * @brief A timer, embedded in what it times
+ *
+ * The links are managed by the wheel; zero-initialise them before the
+ * first cache_wheel_add().
+ */
+typedef struct CacheWheelTimer CacheWheelTimer;
+struct CacheWheelTimer {
+    CacheWheelTimer* prev;       /**< NULL while not on the wheel */
+    CacheWheelTimer* next;       /**< NULL while not on the wheel */
+    int64_t          expires_at; /**< Second the timer is due in */
+    void*            data;       /**< Owner, for the expiry callback */
+};
+
+/**
+ * @struct CacheWheel
+ * @brief Timing wheel (opaque)
+ */
+typedef struct CacheWheel CacheWheel;
+
+/**
+ * @brief Receives one due timer from cache_wheel_advance()
+ *
+ * The timer is off the wheel already; the callback may add or remove any
+ * timer, including this one.
+ *
+ * @param timer Due timer
+ * @param user_data As passed to cache_wheel_advance()
+ */
+typedef void (*CacheWheelExpire)(CacheWheelTimer* timer, void* user_data);
+
+/**
+ * @brief Creates an empty wheel
+ *
+ * @param now Current time; nothing is due before it
+ *
+ * @return New wheel, or NULL on allocation failure
+ */
+CacheWheel* cache_wheel_create(int64_t now);
+
+/**
+ * @brief Frees the wheel (safe to call with NULL); timers are not touched
+ */
+void cache_wheel_destroy(CacheWheel* wheel);
+
+/**
+ * @brief Schedules a timer, moving it if it is on the wheel already
+ *
+ * @param wheel Wheel
+ * @param timer Timer
+ * @param expires_at Second it is due in; a time already past is due at
+ *                   the next cache_wheel_advance()
+ */
+void cache_wheel_add(CacheWheel* wheel, CacheWheelTimer* timer,
+                     int64_t expires_at);
+
+/**
+ * @brief Takes a timer off the wheel (a no-op if it is not on it)
+ */
+void cache_wheel_remove(CacheWheel* wheel, CacheWheelTimer* timer);
+
+/**
+ * @brief Calls expire for timers due at or before now, oldest second first
+ *
+ * @param wheel Wheel
+ * @param now Current time
+ * @param budget Most timers to expire in this call
+ * @param expire Callback
+ * @param user_data Passed through to expire
+ *
+ * @return Number of timers expired; if it equals budget, more may be due
+ */
+size_t cache_wheel_advance(CacheWheel* wheel, int64_t now, size_t budget,
+                           CacheWheelExpire expire, void* user_data);
+
+/**
+ * @brief Forgets every timer without touching them
+ *
+ * For when their owners are freed wholesale; the timers must not be
+ * removed afterwards.
+ */
+void cache_wheel_clear(CacheWheel* wheel);
+
+/**
+ * @brief Number of timers on the wheel
+ */
+size_t cache_wheel_count(const CacheWheel* wheel);
+
+#endif
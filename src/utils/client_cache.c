@@ -1,316 +1,2489 @@
 #include "client_cache.h"
 
-#include "client_list.h"
+#include "cache_bloom.h"
+#include "cache_index.h"
+#include "cache_log.h"
+#include "cache_radix.h"
+#include "cache_shm.h"
+#include "cache_sketch.h"
+#include "cache_slab.h"
+#include "cache_tombstone.h"
+#include "cache_wheel.h"
+#include "hash_fast.h"
 #include "hash_md5.h"
 
 #include <dirent.h>
 #include <errno.h>
-#include <jansson.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
-#define CACHE_DIR "src/client/cache"
+#define CACHE_DIR_ENV "JUST_WEATHER_CACHE_DIR"
+#define CACHE_XDG_NAME "just-weather-client" ///< under $XDG_CACHE_HOME
+#define CACHE_FALLBACK_DIR "src/client/cache" ///< without HOME
+#define CACHE_LEGACY_DIR "src/client/cache"   ///< before the root was set
+#define CACHE_LEGACY_SUFFIX ".json"
+#define CACHE_GENERATION_NAME ".generation"
+#define CACHE_GENERATION_WORDS 2 ///< change counter, clear epoch
+#define CACHE_FILES_INDEX_NAME "files.idx"
+#define CACHE_FILES_BLOOM_NAME "files.bloom"
+#define CACHE_TOMBSTONES_NAME "prefixes.tomb"
+#define CACHE_SHM_NAME_FORMAT                                                  \
+    "/just-weather-cache-%u-%016llx-v2" ///< user id, root hash, layout
+
+#define CACHE_INITIAL_BUCKETS 64 ///< Hash index size, always a power of two
+#define CACHE_WINDOW_PERCENT 1   ///< TinyLFU window share of the limits
+#define CACHE_INLINE_KEY 64      ///< Keys shorter than this live in the entry
+#define CACHE_GC_PERIOD 5        ///< Seconds between automatic GC slices
+#define CACHE_GC_BATCH 64        ///< Index slots visited per GC step
+#define CACHE_EXPIRE_BATCH 16    ///< Expired entries reclaimed per call
+#define CACHE_TMP_MAX_AGE 60     ///< Seconds before a temp file is orphaned
+#define CACHE_SHARD_DIGITS 2     ///< Hex digits naming a shard directory
+#define CACHE_SHARDS (1u << (4 * CACHE_SHARD_DIGITS))
+#define CACHE_PATH_MAX 512       ///< Longest path below the cache root
+
+#define CACHE_FILE_MAGIC "JWC1"
+#define CACHE_FILE_VERSION 3
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+
+/*
+ * On-disk entry: this header, then the key, then the response bytes exactly
+ * as received. Fields are in host byte order; the cache is machine-local.
+ */
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    int64_t  created_at;
+    int64_t  expires_at;
+    uint64_t checksum; /* FNV-1a over key and payload */
+    uint32_t key_len;
+    uint32_t payload_len;
+    uint64_t epoch; /* files of an earlier epoch were cleared */
+    uint64_t stamp; /* see cache_tombstone.h */
+    char     etag[CACHE_ETAG_MAX];
+} CacheFileHeader;
+
+/* What a store reports about a persisted entry, whichever store it is */
+typedef struct {
+    time_t          created_at;
+    time_t          expires_at;
+    uint64_t        stamp;
+    size_t          disk_bytes;
+    struct timespec file_mtime; /* files store: identifies the version */
+    uint64_t        log_offset; /* log store: identifies the version */
+    char            etag[CACHE_ETAG_MAX];
+} StoredRecord;
+
+typedef struct CacheEntry CacheEntry;
+struct CacheEntry {
+    char*           key;            /* key_inline, or an arena block */
+    char*           json_data;
+    size_t          json_len;
+    char*           etag;
+    time_t          created_at;
+    time_t          ttl;
+    uint64_t        stamp;          /* ordered against tombstones */
+    size_t          bytes;          /* memory charged: struct, key, payload */
+    size_t          disk_bytes;     /* size on disk, 0 if not persisted */
+    struct timespec file_mtime;     /* of the cache file as last seen */
+    uint64_t        log_offset;     /* of the log record as last seen */
+    uint64_t        write_seq;      /* queued write not yet stored, or 0 */
+    uint64_t        hash;           /* hash of key, cached for rehashing */
+    CacheEntry*     next_in_bucket; /* hash index chain */
+    CacheEntry*     lru_prev;       /* towards the most recently used entry */
+    CacheEntry*     lru_next;       /* towards the least recently used entry */
+    int             in_window;      /* on the TinyLFU admission window list */
+    CacheWheelTimer expiry;         /* on the wheel under its expiry second */
+    char            key_inline[CACHE_INLINE_KEY];
+};
 
 typedef struct {
-    char*  key;
-    char*  json_data;
-    time_t created_at;
-    time_t ttl;
-} CacheEntry;
+    CacheEntry* head; /* most recently used */
+    CacheEntry* tail; /* least recently used, evicted first */
+    size_t      count;
+    size_t      bytes;
+} CacheList;
+
+typedef enum { WRITE_SAVE, WRITE_DELETE } WriteKind;
+
+/* A disk operation for the flusher thread; it fills in the results */
+typedef struct WriteOp WriteOp;
+struct WriteOp {
+    WriteKind    kind;
+    char*        key;
+    uint64_t     hash;
+    char*        data;
+    size_t       len;
+    time_t       created_at;
+    time_t       ttl;
+    uint64_t     stamp;
+    char*        etag;
+    uint64_t     seq;      /* matches CacheEntry.write_seq */
+    int          status;   /* of the store operation */
+    uint64_t     previous; /* generation before the flusher bumped it */
+    StoredRecord record;
+    WriteOp*     next;
+};
+
+/* Write-behind state; the lock guards everything but the thread handle */
+typedef struct {
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake; /* work queued or stopping */
+    pthread_cond_t  idle; /* queue taken or batch finished */
+    WriteOp*        head; /* queued, oldest first, one per key */
+    WriteOp*        tail;
+    size_t          queued;
+    int             busy; /* flusher is working on a batch */
+    int             stopping;
+    WriteOp*        done; /* finished, waiting to be applied */
+    WriteOp*        done_tail;
+    int             completed; /* done is non-empty; read without lock */
+} WriteBehind;
 
 struct ClientCache {
-    LinkedList* entries;
-    size_t      max_entries;
-    time_t      default_ttl;
+    CacheList            window; /* TinyLFU only: recent arrivals */
+    CacheList            main;   /* every entry under plain LRU */
+    CacheEntry**         buckets;
+    size_t               bucket_count;
+    size_t               max_entries;
+    size_t               max_bytes;      /* 0 = unlimited */
+    size_t               max_disk_bytes; /* 0 = unlimited */
+    size_t               disk_bytes;
+    size_t               window_capacity;
+    size_t               window_bytes;
+    ClientCacheCounters  counters; /* atomics: the flusher updates some */
+    time_t               default_ttl;
+    ClientCachePolicy    policy;
+    CacheSketch*         sketch;          /* access frequencies */
+    unsigned int         promote_hits;    /* requests before going hot */
+    uint64_t*            generation;      /* shared disk change counter */
+    uint64_t             seen_generation; /* memory matches disk as of this */
+    uint64_t*            epoch;           /* shared clear counter */
+    uint64_t             seen_epoch;      /* resident entries are of this */
+    char*                detached;        /* last uncached peek result */
+    CacheLog*            log;             /* NULL: one file per key */
+    ClientCacheWriteMode write_mode;
+    WriteBehind*         writer;    /* flusher, in write-behind mode only */
+    uint64_t             write_seq; /* last sequence number handed out */
+    CacheShm*            shm;       /* host-wide segment, or NULL */
+    size_t               shm_bytes; /* size the segment was asked for */
+    ClientCacheKeyHash   key_hash;  /* file naming of the files store */
+    CacheIndex*          files_index; /* files store: sizes and expiry */
+    CacheBloom*          files_bloom; /* files store: names written */
+    CacheSlab*           entry_slab;  /* CacheEntry structs */
+    CacheArena*          arena;       /* keys, payloads and ETags */
+    CacheRadix*          key_tree;    /* resident keys, for prefix lookups */
+    CacheTombstones*     tombstones;  /* invalidated prefixes, shared */
+    uint64_t             seen_tombstones; /* resident entries checked */
+    CacheWheel*          wheel;       /* resident entries by expiry */
+    time_t               next_gc;     /* next automatic GC slice */
+    char                 root[CACHE_DIR_MAX]; /* cache directory */
+    int                  legacy_state; /* 0 unchecked, 1 present, -1 gone */
 };
 
-static void free_cache_entry(CacheEntry* entry) {
-    if (entry) {
-        free(entry->key);
-        free(entry->json_data);
-        free(entry);
+static void store_delete(ClientCache* cache, const char* key);
+static void persist_delete(ClientCache* cache, const char* key, uint64_t hash);
+
+static void free_cache_entry(ClientCache* cache, CacheEntry* entry) {
+    if (entry) {
+        if (entry->key != entry->key_inline) {
+            cache_arena_free(cache->arena, entry->key, strlen(entry->key) + 1);
+        }
+        cache_arena_free(cache->arena, entry->json_data, entry->json_len + 1);
+        if (entry->etag) {
+            cache_arena_free(cache->arena, entry->etag,
+                             strlen(entry->etag) + 1);
+        }
+        cache_slab_free(cache->entry_slab, entry);
+    }
+}
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_key(const char* key) {
+    return hash_fast_64(key, strlen(key));
+}
+
+static size_t entry_bytes(const char* key, size_t len, const char* etag) {
+    size_t key_size = strlen(key) + 1;
+    return sizeof(CacheEntry) + (key_size > CACHE_INLINE_KEY ? key_size : 0) +
+           len + 1 + (etag ? strlen(etag) + 1 : 0);
+}
+
+static size_t entry_count(const ClientCache* cache) {
+    return cache->window.count + cache->main.count;
+}
+
+static size_t total_bytes(const ClientCache* cache) {
+    return cache->window.bytes + cache->main.bytes;
+}
+
+static CacheEntry* index_find(ClientCache* cache, const char* key,
+                              uint64_t hash) {
+    CacheEntry* entry = cache->buckets[hash & (cache->bucket_count - 1)];
+    while (entry) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        entry = entry->next_in_bucket;
+    }
+    return NULL;
+}
+
+static int index_grow(ClientCache* cache) {
+    size_t       new_count   = cache->bucket_count * 2;
+    CacheEntry** new_buckets = calloc(new_count, sizeof(CacheEntry*));
+    if (!new_buckets) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < cache->bucket_count; i++) {
+        CacheEntry* entry = cache->buckets[i];
+        while (entry) {
+            CacheEntry* next      = entry->next_in_bucket;
+            size_t      slot      = entry->hash & (new_count - 1);
+            entry->next_in_bucket = new_buckets[slot];
+            new_buckets[slot]     = entry;
+            entry                 = next;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets      = new_buckets;
+    cache->bucket_count = new_count;
+    return 0;
+}
+
+static void index_insert(ClientCache* cache, CacheEntry* entry) {
+    /* Keep the load factor below 3/4; a failed grow only costs speed */
+    if ((entry_count(cache) + 1) * 4 > cache->bucket_count * 3) {
+        index_grow(cache);
+    }
+
+    size_t slot           = entry->hash & (cache->bucket_count - 1);
+    entry->next_in_bucket = cache->buckets[slot];
+    cache->buckets[slot]  = entry;
+}
+
+static void index_remove(ClientCache* cache, CacheEntry* entry) {
+    CacheEntry** link =
+        &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link) {
+        if (*link == entry) {
+            *link = entry->next_in_bucket;
+            return;
+        }
+        link = &(*link)->next_in_bucket;
+    }
+}
+
+static CacheList* list_of(ClientCache* cache, CacheEntry* entry) {
+    return entry->in_window ? &cache->window : &cache->main;
+}
+
+static void list_unlink(CacheList* list, CacheEntry* entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        list->head = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        list->tail = entry->lru_prev;
+    }
+
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+    list->count--;
+    list->bytes -= entry->bytes;
+}
+
+static void list_push_front(CacheList* list, CacheEntry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = list->head;
+
+    if (list->head) {
+        list->head->lru_prev = entry;
+    } else {
+        list->tail = entry;
+    }
+    list->head = entry;
+    list->count++;
+    list->bytes += entry->bytes;
+}
+
+static void lru_touch(ClientCache* cache, CacheEntry* entry) {
+    CacheList* list = list_of(cache, entry);
+    if (list->head != entry) {
+        list_unlink(list, entry);
+        list_push_front(list, entry);
+    }
+}
+
+static void remove_entry(ClientCache* cache, CacheEntry* entry) {
+    index_remove(cache, entry);
+    cache_radix_remove(cache->key_tree, entry->key);
+    cache_wheel_remove(cache->wheel, &entry->expiry);
+    list_unlink(list_of(cache, entry), entry);
+    cache->disk_bytes -= entry->disk_bytes;
+    free_cache_entry(cache, entry);
+}
+
+static void note_generation(ClientCache* cache, uint64_t previous) {
+    /* If nobody else bumped since we last looked, memory is still in sync */
+    if (previous == cache->seen_generation) {
+        cache->seen_generation = previous + 1;
+    }
+}
+
+static void bump_generation(ClientCache* cache) {
+    if (cache->generation) {
+        note_generation(cache, __atomic_fetch_add(cache->generation, 1,
+                                                  __ATOMIC_ACQ_REL));
+    }
+}
+
+static uint64_t current_epoch(const ClientCache* cache) {
+    return cache->epoch ? __atomic_load_n(cache->epoch, __ATOMIC_ACQUIRE) : 0;
+}
+
+static void count(uint64_t* counter) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+/* Hot tier overflow: the entry moves down to the warm tier and keeps its
+ * disk record, so a later request costs a copy rather than a fetch */
+static void demote_entry(ClientCache* cache, CacheEntry* entry) {
+    time_t expires_at = entry->created_at + entry->ttl;
+    if (cache->shm && time(NULL) <= expires_at &&
+        !cache_shm_contains(cache->shm, entry->key)) {
+        cache_shm_put(cache->shm, entry->key, entry->json_data,
+                      entry->json_len, entry->created_at, expires_at,
+                      entry->stamp, entry->etag);
+    }
+    remove_entry(cache, entry);
+    count(&cache->counters.demotions);
+}
+
+static void evict_entry(ClientCache* cache, CacheEntry* entry) {
+    /* Over the disk budget: the entry leaves memory and disk alike */
+    persist_delete(cache, entry->key, entry->hash);
+    remove_entry(cache, entry);
+    count(&cache->counters.evictions);
+    bump_generation(cache);
+}
+
+static void free_list(ClientCache* cache, CacheList* list) {
+    CacheEntry* entry = list->head;
+    while (entry) {
+        CacheEntry* next = entry->lru_next;
+        free_cache_entry(cache, entry);
+        entry = next;
+    }
+
+    list->head  = NULL;
+    list->tail  = NULL;
+    list->count = 0;
+    list->bytes = 0;
+}
+
+static void remove_all_entries(ClientCache* cache) {
+    free_list(cache, &cache->window);
+    free_list(cache, &cache->main);
+    cache->disk_bytes = 0;
+    memset(cache->buckets, 0, cache->bucket_count * sizeof(CacheEntry*));
+    cache_radix_clear(cache->key_tree);
+    cache_wheel_clear(cache->wheel);
+
+    /* Nothing is handed out any more: give the chunks back */
+    cache_slab_reset(cache->entry_slab);
+    cache_arena_reset(cache->arena);
+}
+
+/* Resident entries under a prefix, gathered first since the tree must not
+ * change while it is walked */
+typedef struct {
+    CacheEntry** entries;
+    size_t       count;
+} EntryBatch;
+
+static void batch_entry(void* value, void* user_data) {
+    EntryBatch* batch              = user_data;
+    batch->entries[batch->count++] = value;
+}
+
+static int collect_prefix(ClientCache* cache, const char* prefix,
+                          EntryBatch* batch) {
+    size_t resident = cache_radix_count(cache->key_tree);
+    batch->count    = 0;
+    batch->entries  = malloc((resident + 1) * sizeof(CacheEntry*));
+    if (!batch->entries) {
+        return -1;
+    }
+
+    cache_radix_visit_prefix(cache->key_tree, prefix, batch_entry, batch);
+    return 0;
+}
+
+static void expire_timer(CacheWheelTimer* timer, void* user_data) {
+    ClientCache* cache = user_data;
+    remove_entry(cache, timer->data);
+    count(&cache->counters.expirations);
+}
+
+/* Reclaims a few expired entries per call, so that entries nobody asks for
+ * again do not hold memory until the LRU reaches them; a slab chunk whose
+ * last object goes is handed back to the system. Their disk records are
+ * left to the disk GC. */
+static void expire_entries(ClientCache* cache, time_t now) {
+    cache_wheel_advance(cache->wheel, (int64_t)now, CACHE_EXPIRE_BATCH,
+                        expire_timer, cache);
+}
+
+static int over_limit(const ClientCache* cache) {
+    return entry_count(cache) > cache->max_entries ||
+           (cache->max_bytes && total_bytes(cache) > cache->max_bytes);
+}
+
+static int window_over_limit(const ClientCache* cache) {
+    return cache->window.count > cache->window_capacity ||
+           (cache->max_bytes && cache->window.bytes > cache->window_bytes);
+}
+
+static int main_over_limit(const ClientCache* cache) {
+    return cache->main.count > cache->max_entries - cache->window_capacity ||
+           (cache->max_bytes &&
+            cache->main.bytes > cache->max_bytes - cache->window_bytes);
+}
+
+static int admit_from_window(ClientCache* cache) {
+    /* The window overflowed: its oldest entry competes for a main slot */
+    CacheEntry* candidate = cache->window.tail;
+    list_unlink(&cache->window, candidate);
+    candidate->in_window = 0;
+    list_push_front(&cache->main, candidate);
+
+    /* Main is over budget: keep whichever was used more often, one victim
+     * at a time, since a large candidate may need several slots */
+    unsigned int frequency = cache_sketch_estimate(cache->sketch,
+                                                   candidate->hash);
+    while (main_over_limit(cache)) {
+        CacheEntry* victim = cache->main.tail;
+        if (victim == candidate ||
+            frequency <= cache_sketch_estimate(cache->sketch, victim->hash)) {
+            demote_entry(cache, candidate);
+            return -1;
+        }
+        demote_entry(cache, victim);
+    }
+
+    return 0;
+}
+
+/* Returns 0 if keep is still resident, -1 if it lost admission */
+static int enforce_limits(ClientCache* cache, const CacheEntry* keep) {
+    int kept = 0;
+    if (cache->policy == CLIENT_CACHE_POLICY_TINYLFU) {
+        while (cache->window.tail && window_over_limit(cache)) {
+            int is_keep = cache->window.tail == keep;
+            if (admit_from_window(cache) != 0 && is_keep) {
+                kept = -1;
+            }
+        }
+    }
+
+    while (over_limit(cache)) {
+        CacheEntry* victim = cache->main.tail ? cache->main.tail
+                                              : cache->window.tail;
+        if (!victim || victim == keep) {
+            break;
+        }
+        demote_entry(cache, victim);
+    }
+
+    return kept;
+}
+
+static void enforce_disk_limit(ClientCache* cache, const CacheEntry* keep) {
+    while (cache->max_disk_bytes && cache->disk_bytes > cache->max_disk_bytes) {
+        CacheEntry* victim = cache->main.tail ? cache->main.tail
+                                              : cache->window.tail;
+        if (victim == keep) {
+            victim = victim->lru_prev ? victim->lru_prev : cache->window.tail;
+        }
+        if (!victim || victim == keep) {
+            break;
+        }
+        evict_entry(cache, victim);
+    }
+}
+
+static CacheEntry* add_entry(ClientCache* cache, const char* key,
+                             uint64_t hash, const char* data, size_t len,
+                             time_t created_at, time_t ttl, uint64_t stamp,
+                             const char* etag) {
+    size_t bytes = entry_bytes(key, len, etag);
+    if (cache->max_bytes && bytes > cache->max_bytes) {
+        return NULL;
+    }
+
+    CacheEntry* entry = cache_slab_alloc(cache->entry_slab);
+    if (!entry) {
+        return NULL;
+    }
+    memset(entry, 0, sizeof(CacheEntry));
+
+    size_t key_size  = strlen(key) + 1;
+    size_t etag_size = etag ? strlen(etag) + 1 : 0;
+    entry->key        = key_size <= CACHE_INLINE_KEY
+                            ? entry->key_inline
+                            : cache_arena_alloc(cache->arena, key_size);
+    entry->json_data  = cache_arena_alloc(cache->arena, len + 1);
+    entry->json_len   = len;
+    entry->etag       = etag ? cache_arena_alloc(cache->arena, etag_size)
+                             : NULL;
+    entry->created_at = created_at;
+    entry->ttl        = ttl;
+    entry->stamp      = stamp;
+    entry->bytes      = bytes;
+    entry->hash       = hash;
+
+    if (!entry->key || !entry->json_data || (etag && !entry->etag)) {
+        if (entry->key != entry->key_inline) {
+            cache_arena_free(cache->arena, entry->key, key_size);
+        }
+        cache_arena_free(cache->arena, entry->json_data, len + 1);
+        cache_arena_free(cache->arena, entry->etag, etag_size);
+        cache_slab_free(cache->entry_slab, entry);
+        return NULL;
+    }
+    memcpy(entry->key, key, key_size);
+    memcpy(entry->json_data, data, len);
+    entry->json_data[len] = '\0';
+    if (etag) {
+        memcpy(entry->etag, etag, etag_size);
+    }
+
+    if (cache_radix_insert(cache->key_tree, entry->key, entry) != 0) {
+        free_cache_entry(cache, entry);
+        return NULL;
+    }
+    index_insert(cache, entry);
+
+    /* Due once its age exceeds the TTL, as lookup() judges it */
+    entry->expiry.data = entry;
+    cache_wheel_add(cache->wheel, &entry->expiry,
+                    (int64_t)(created_at + ttl) + 1);
+    if (cache->policy == CLIENT_CACHE_POLICY_TINYLFU) {
+        entry->in_window = 1;
+        list_push_front(&cache->window, entry);
+    } else {
+        list_push_front(&cache->main, entry);
+    }
+
+    return entry;
+}
+
+/* mkdir -p; an existing directory is not an error */
+static int make_dirs(const char* path) {
+    char buffer[CACHE_DIR_MAX];
+    if (strlen(path) >= sizeof(buffer)) {
+        return -1;
+    }
+    strcpy(buffer, path);
+
+    for (char* p = buffer + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+    return mkdir(buffer, 0755) != 0 && errno != EEXIST ? -1 : 0;
+}
+
+static void ensure_cache_dir(const ClientCache* cache) {
+    struct stat st;
+    if (stat(cache->root, &st) == -1) {
+        make_dirs(cache->root);
+    }
+}
+
+/* $JUST_WEATHER_CACHE_DIR, else the XDG user cache directory */
+static void default_cache_dir(char* root) {
+    const char* dir  = getenv(CACHE_DIR_ENV);
+    const char* xdg  = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    int         length;
+
+    /* Relative XDG paths are invalid and to be ignored, says the spec */
+    if (dir && *dir) {
+        length = snprintf(root, CACHE_DIR_MAX, "%s", dir);
+    } else if (xdg && xdg[0] == '/') {
+        length = snprintf(root, CACHE_DIR_MAX, "%s/%s", xdg, CACHE_XDG_NAME);
+    } else if (home && home[0] == '/') {
+        length = snprintf(root, CACHE_DIR_MAX, "%s/.cache/%s", home,
+                          CACHE_XDG_NAME);
+    } else {
+        length = -1;
+    }
+
+    if (length < 0 || length >= CACHE_DIR_MAX) {
+        strcpy(root, CACHE_FALLBACK_DIR);
+    }
+}
+
+/* <root>/<shard>/<name>.cache; path must hold CACHE_PATH_MAX bytes */
+static void name_path(const ClientCache* cache, const char* name,
+                      char* path) {
+    snprintf(path, CACHE_PATH_MAX, "%s/%.*s/%s.cache", cache->root,
+             CACHE_SHARD_DIGITS, name, name);
+}
+
+static void shard_path(const ClientCache* cache, unsigned int shard,
+                       char* path) {
+    snprintf(path, CACHE_PATH_MAX, "%s/%0*x", cache->root, CACHE_SHARD_DIGITS,
+             shard);
+}
+
+/* Creates the shard directory holding path */
+static int make_parent_dir(const char* path) {
+    char  dir[CACHE_PATH_MAX];
+    char* slash;
+    if (snprintf(dir, sizeof(dir), "%s", path) >= (int)sizeof(dir) ||
+        !(slash = strrchr(dir, '/'))) {
+        return -1;
+    }
+    *slash = '\0';
+    return mkdir(dir, 0755) != 0 && errno != EEXIST ? -1 : 0;
+}
+
+/* name must hold HASH_FAST_STRING_LENGTH bytes */
+static int cache_file_name(ClientCacheKeyHash naming, const char* key,
+                           char* name) {
+    /* Both namings give 32 hex digits */
+    return naming == CLIENT_CACHE_KEY_HASH_MD5
+               ? hash_md5_string(key, strlen(key), name,
+                                 HASH_FAST_STRING_LENGTH)
+               : hash_fast_string(key, strlen(key), name,
+                                  HASH_FAST_STRING_LENGTH);
+}
+
+static char* get_cache_filepath(const ClientCache* cache, const char* key) {
+    char hash[HASH_FAST_STRING_LENGTH];
+    if (cache_file_name(cache->key_hash, key, hash) != 0) {
+        return NULL;
+    }
+
+    char* filepath = malloc(CACHE_PATH_MAX);
+    if (!filepath) {
+        return NULL;
+    }
+
+    name_path(cache, hash, filepath);
+    return filepath;
+}
+
+static uint64_t file_checksum(const char* key, size_t key_len,
+                              const char* payload, size_t payload_len) {
+    return fnv1a(fnv1a(FNV_OFFSET_BASIS, key, key_len), payload, payload_len);
+}
+
+static void sync_parent_dir(const char* path) {
+    char  dir[CACHE_PATH_MAX];
+    char* slash;
+    snprintf(dir, sizeof(dir), "%s", path);
+    if (!(slash = strrchr(dir, '/'))) {
+        return;
+    }
+    *slash = '\0';
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static int save_to_file(const ClientCache* cache, const char* key,
+                        const char* data, size_t len, time_t created_at,
+                        time_t ttl, uint64_t stamp, const char* etag,
+                        int durable, StoredRecord* record) {
+    ensure_cache_dir(cache);
+
+    size_t key_len = strlen(key);
+    if (key_len > UINT32_MAX || len > UINT32_MAX) {
+        return -1;
+    }
+
+    char* filepath = get_cache_filepath(cache, key);
+    if (!filepath) {
+        return -1;
+    }
+
+    CacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic));
+    header.version     = CACHE_FILE_VERSION;
+    header.created_at  = (int64_t)created_at;
+    header.expires_at  = (int64_t)(created_at + ttl);
+    header.checksum    = file_checksum(key, key_len, data, len);
+    header.key_len     = (uint32_t)key_len;
+    header.payload_len = (uint32_t)len;
+    header.epoch       = current_epoch(cache);
+    header.stamp       = stamp;
+    if (etag && strlen(etag) < sizeof(header.etag)) {
+        strcpy(header.etag, etag);
+    }
+
+    /* Write a private temporary and rename it so that readers in other
+     * processes never see a half-written file */
+    char tmppath[600];
+    snprintf(tmppath, sizeof(tmppath), "%s.%ld.tmp", filepath, (long)getpid());
+
+    /* Shard directories are created on first use */
+    int fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 && errno == ENOENT && make_parent_dir(tmppath) == 0) {
+        fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0) {
+        free(filepath);
+        return -1;
+    }
+
+    struct iovec parts[3] = {
+        {&header, sizeof(header)},
+        {(void*)key, key_len},
+        {(void*)data, len},
+    };
+    ssize_t     expected = (ssize_t)(sizeof(header) + key_len + len);
+    int         result   = 0;
+    struct stat file_stat;
+    if (writev(fd, parts, 3) != expected || fstat(fd, &file_stat) != 0 ||
+        (durable && fsync(fd) != 0)) {
+        result = -1;
+    }
+
+    if (close(fd) != 0 || result != 0 || rename(tmppath, filepath) != 0) {
+        unlink(tmppath);
+        result = -1;
+    } else if (durable) {
+        /* The rename itself must survive a crash too */
+        sync_parent_dir(filepath);
+    }
+
+    free(filepath);
+    if (result == 0) {
+        record->disk_bytes = (size_t)file_stat.st_size;
+        record->file_mtime = file_stat.st_mtim;
+    }
+    return result;
+}
+
+/* Returns the payload (NUL-terminated, caller frees) or NULL on miss */
+static char* load_from_file(const ClientCache* cache, const char* key,
+                            size_t* len, StoredRecord* record) {
+    char* filepath = get_cache_filepath(cache, key);
+    if (!filepath) {
+        return NULL;
+    }
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        free(filepath);
+        return NULL;
+    }
+
+    char*       buffer = NULL;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 &&
+        file_stat.st_size >= (off_t)sizeof(CacheFileHeader)) {
+        size_t size = (size_t)file_stat.st_size;
+        buffer      = malloc(size + 1);
+        if (buffer && read(fd, buffer, size) != (ssize_t)size) {
+            free(buffer);
+            buffer = NULL;
+        }
+    }
+    close(fd);
+
+    if (!buffer) {
+        free(filepath);
+        return NULL;
+    }
+
+    CacheFileHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    size_t      key_len = strlen(key);
+    const char* stored  = buffer + sizeof(header);
+    const char* payload = stored + key_len;
+
+    int valid =
+        memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == CACHE_FILE_VERSION && header.key_len == key_len &&
+        sizeof(header) + key_len + header.payload_len ==
+            (size_t)file_stat.st_size &&
+        memcmp(stored, key, key_len) == 0 &&
+        header.checksum ==
+            file_checksum(key, key_len, payload, header.payload_len);
+    int expired = (int64_t)time(NULL) > header.expires_at ||
+                  header.epoch != current_epoch(cache);
+
+    if (!valid || expired) {
+        /* Stale, cleared, corrupt or from an older format: drop it */
+        unlink(filepath);
+        free(filepath);
+        free(buffer);
+        return NULL;
+    }
+    free(filepath);
+
+    header.etag[sizeof(header.etag) - 1] = '\0';
+    memcpy(record->etag, header.etag, sizeof(record->etag));
+    record->created_at = (time_t)header.created_at;
+    record->expires_at = (time_t)header.expires_at;
+    record->stamp      = header.stamp;
+    record->disk_bytes = (size_t)file_stat.st_size;
+    record->file_mtime = file_stat.st_mtim;
+
+    memmove(buffer, payload, header.payload_len);
+    buffer[header.payload_len] = '\0';
+    *len = header.payload_len;
+    return buffer;
+}
+
+static void delete_file(const ClientCache* cache, const char* key) {
+    char* filepath = get_cache_filepath(cache, key);
+    if (filepath) {
+        unlink(filepath);
+        free(filepath);
+    }
+}
+
+static int file_changed(const ClientCache* cache, const CacheEntry* entry) {
+    char* filepath = get_cache_filepath(cache, entry->key);
+    if (!filepath) {
+        return 0;
+    }
+
+    struct stat file_stat;
+    int         missing = stat(filepath, &file_stat) != 0;
+    free(filepath);
+
+    return missing || (size_t)file_stat.st_size != entry->disk_bytes ||
+           file_stat.st_mtim.tv_sec != entry->file_mtime.tv_sec ||
+           file_stat.st_mtim.tv_nsec != entry->file_mtime.tv_nsec;
+}
+
+static int log_save(ClientCache* cache, const char* key, const char* data,
+                    size_t len, time_t created_at, time_t ttl, uint64_t stamp,
+                    const char* etag, int durable, StoredRecord* record) {
+    CacheLogRecordInfo info;
+    if (cache_log_put(cache->log, key, data, len, created_at, created_at + ttl,
+                      stamp, etag, &info) != 0 ||
+        (durable && cache_log_sync(cache->log) != 0)) {
+        return -1;
+    }
+    record->disk_bytes = info.disk_bytes;
+    record->log_offset = info.offset;
+    return 0;
+}
+
+static int files_save(ClientCache* cache, const char* key, const char* data,
+                      size_t len, time_t created_at, time_t ttl,
+                      uint64_t stamp, const char* etag, int durable,
+                      StoredRecord* record) {
+    if (save_to_file(cache, key, data, len, created_at, ttl, stamp, etag,
+                     durable, record) != 0) {
+        return -1;
+    }
+
+    /* Not indexed, the file is left to expire on lookup; no error. The
+     * filter comes second so that a rebuild from the index cannot lose it */
+    char name[HASH_FAST_STRING_LENGTH];
+    if (cache->files_index &&
+        cache_file_name(cache->key_hash, key, name) == 0) {
+        cache_index_put(cache->files_index, name, record->disk_bytes,
+                        (int64_t)(created_at + ttl));
+        cache_bloom_add(cache->files_bloom, name);
+    }
+    return 0;
+}
+
+/* Called from the flusher thread as well */
+static int store_save(ClientCache* cache, const char* key, const char* data,
+                      size_t len, time_t created_at, time_t ttl,
+                      uint64_t stamp, const char* etag, int durable,
+                      StoredRecord* record) {
+    uint64_t start  = latency_now_ns();
+    int      result = cache->log ? log_save(cache, key, data, len, created_at,
+                                            ttl, stamp, etag, durable, record)
+                                 : files_save(cache, key, data, len,
+                                              created_at, ttl, stamp, etag,
+                                              durable, record);
+
+    latency_histogram_record(&cache->counters.disk_write,
+                             latency_now_ns() - start);
+    count(result == 0 ? &cache->counters.disk_writes
+                      : &cache->counters.disk_write_errors);
+    return result;
+}
+
+static char* log_load(ClientCache* cache, const char* key, size_t* len,
+                      StoredRecord* record) {
+    CacheLogRecordInfo info;
+    char*              data = cache_log_get(cache->log, key, len, &info);
+    if (data) {
+        record->created_at = (time_t)info.created_at;
+        record->expires_at = (time_t)info.expires_at;
+        record->stamp      = info.stamp;
+        record->disk_bytes = info.disk_bytes;
+        record->log_offset = info.offset;
+        snprintf(record->etag, sizeof(record->etag), "%s", info.etag);
+    }
+    return data;
+}
+
+/* A definite no from the filter saves the open() of a file that is not
+ * there, the usual case for a key never fetched before */
+static int file_may_exist(const ClientCache* cache, const char* key) {
+    char name[HASH_FAST_STRING_LENGTH];
+    return !cache->files_bloom ||
+           cache_file_name(cache->key_hash, key, name) != 0 ||
+           cache_bloom_may_contain(cache->files_bloom, name);
+}
+
+static char* store_load(ClientCache* cache, const char* key, size_t* len,
+                        StoredRecord* record) {
+    if (!cache->log && !file_may_exist(cache, key)) {
+        count(&cache->counters.filter_skips);
+        return NULL;
+    }
+
+    uint64_t start = latency_now_ns();
+    char*    data  = cache->log ? log_load(cache, key, len, record)
+                                : load_from_file(cache, key, len,
+                                                 record);
+
+    latency_histogram_record(&cache->counters.disk_read,
+                             latency_now_ns() - start);
+    count(&cache->counters.disk_reads);
+    return data;
+}
+
+static void store_delete(ClientCache* cache, const char* key) {
+    if (cache->log) {
+        cache_log_delete(cache->log, key);
+        return;
+    }
+
+    delete_file(cache, key);
+    char name[HASH_FAST_STRING_LENGTH];
+    if (cache->files_index &&
+        cache_file_name(cache->key_hash, key, name) == 0) {
+        cache_index_remove(cache->files_index, name);
+    }
+}
+
+/* Whether the persisted copy was deleted or rewritten since it was seen */
+static int store_changed(ClientCache* cache, const CacheEntry* entry) {
+    if (!cache->log) {
+        return file_changed(cache, entry);
+    }
+
+    /* Compaction moves records too, which merely costs a reload */
+    uint64_t offset;
+    return cache_log_lookup(cache->log, entry->key, &offset) != 0 ||
+           offset != entry->log_offset;
+}
+
+static void attach_record(ClientCache* cache, CacheEntry* entry,
+                          const StoredRecord* record) {
+    entry->disk_bytes = record->disk_bytes;
+    entry->file_mtime = record->file_mtime;
+    entry->log_offset = record->log_offset;
+    cache->disk_bytes += entry->disk_bytes;
+}
+
+static WriteOp* new_write_op(WriteKind kind, const char* key, uint64_t hash) {
+    WriteOp* op = calloc(1, sizeof(WriteOp));
+    if (!op) {
+        return NULL;
+    }
+
+    op->kind = kind;
+    op->hash = hash;
+    op->key  = strdup(key);
+    if (!op->key) {
+        free(op);
+        return NULL;
+    }
+    return op;
+}
+
+static void free_write_ops(WriteOp* op) {
+    while (op) {
+        WriteOp* next = op->next;
+        free(op->key);
+        free(op->data);
+        free(op->etag);
+        free(op);
+        op = next;
+    }
+}
+
+/* Runs on the flusher thread: touches only the op and the store */
+static void perform_write(ClientCache* cache, WriteOp* op) {
+    if (op->kind == WRITE_SAVE) {
+        op->status = store_save(cache, op->key, op->data, op->len,
+                                op->created_at, op->ttl, op->stamp, op->etag,
+                                0, &op->record);
+    } else {
+        store_delete(cache, op->key);
+    }
+
+    if (cache->generation) {
+        op->previous =
+            __atomic_fetch_add(cache->generation, 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+static void* flusher_main(void* arg) {
+    ClientCache* cache  = arg;
+    WriteBehind* writer = cache->writer;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (!writer->head && !writer->stopping) {
+            pthread_cond_wait(&writer->wake, &writer->lock);
+        }
+        if (!writer->head) {
+            break;
+        }
+
+        /* Take everything queued as one batch and do the I/O unlocked */
+        WriteOp* batch = writer->head;
+        writer->head   = NULL;
+        writer->tail   = NULL;
+        writer->queued = 0;
+        writer->busy   = 1;
+        pthread_cond_broadcast(&writer->idle);
+        pthread_mutex_unlock(&writer->lock);
+
+        WriteOp* last = batch;
+        for (WriteOp* op = batch; op; op = op->next) {
+            perform_write(cache, op);
+            last = op;
+        }
+
+        pthread_mutex_lock(&writer->lock);
+        if (writer->done_tail) {
+            writer->done_tail->next = batch;
+        } else {
+            writer->done = batch;
+        }
+        writer->done_tail = last;
+        writer->busy      = 0;
+        __atomic_store_n(&writer->completed, 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&writer->idle);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+/* Takes ownership of op; blocks while the queue is full */
+static void queue_write(ClientCache* cache, WriteOp* op) {
+    WriteBehind* writer = cache->writer;
+    pthread_mutex_lock(&writer->lock);
+
+    for (WriteOp* queued = writer->head; queued; queued = queued->next) {
+        if (queued->hash == op->hash && strcmp(queued->key, op->key) == 0) {
+            /* Coalesce: the newer operation replaces the queued one */
+            WriteOp* next = queued->next;
+            WriteOp  old  = *queued;
+            *queued       = *op;
+            queued->next  = next;
+            *op           = old;
+            op->next      = NULL;
+            pthread_mutex_unlock(&writer->lock);
+            free_write_ops(op);
+            return;
+        }
+    }
+
+    while (writer->queued >= CACHE_WRITE_QUEUE_MAX) {
+        pthread_cond_wait(&writer->idle, &writer->lock);
+    }
+
+    if (writer->tail) {
+        writer->tail->next = op;
+    } else {
+        writer->head = op;
+    }
+    writer->tail = op;
+    writer->queued++;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+/* Waits until nothing is queued or in flight; discard drops queued ops */
+static void flush_writes(ClientCache* cache, int discard) {
+    WriteBehind* writer = cache->writer;
+    if (!writer) {
+        return;
+    }
+
+    WriteOp* dropped = NULL;
+    pthread_mutex_lock(&writer->lock);
+    if (discard) {
+        dropped        = writer->head;
+        writer->head   = NULL;
+        writer->tail   = NULL;
+        writer->queued = 0;
+    }
+    while (writer->head || writer->busy) {
+        pthread_cond_wait(&writer->idle, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    free_write_ops(dropped);
+}
+
+/* Folds finished background writes back into their entries */
+static void apply_done(ClientCache* cache, WriteOp* done) {
+    for (WriteOp* op = done; op; op = op->next) {
+        if (cache->generation) {
+            note_generation(cache, op->previous);
+        }
+
+        /* An entry replaced or evicted since has a different sequence */
+        CacheEntry* entry = op->kind == WRITE_SAVE
+                                ? index_find(cache, op->key, op->hash)
+                                : NULL;
+        if (entry && entry->write_seq == op->seq) {
+            entry->write_seq = 0;
+            if (op->status == 0) {
+                attach_record(cache, entry, &op->record);
+            }
+        }
+    }
+    free_write_ops(done);
+
+    enforce_disk_limit(cache, NULL);
+}
+
+/* Returns whether there was anything to apply */
+static int apply_completions(ClientCache* cache) {
+    WriteBehind* writer = cache->writer;
+    if (!writer || !__atomic_load_n(&writer->completed, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    WriteOp* done     = writer->done;
+    writer->done      = NULL;
+    writer->done_tail = NULL;
+    __atomic_store_n(&writer->completed, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&writer->lock);
+
+    apply_done(cache, done);
+    return 1;
+}
+
+static int start_writer(ClientCache* cache) {
+    WriteBehind* writer = calloc(1, sizeof(WriteBehind));
+    if (!writer) {
+        return -1;
+    }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wake, NULL);
+    pthread_cond_init(&writer->idle, NULL);
+
+    cache->writer = writer;
+    if (pthread_create(&writer->thread, NULL, flusher_main, cache) != 0) {
+        cache->writer = NULL;
+        pthread_cond_destroy(&writer->idle);
+        pthread_cond_destroy(&writer->wake);
+        pthread_mutex_destroy(&writer->lock);
+        free(writer);
+        return -1;
+    }
+    return 0;
+}
+
+/* Lets the flusher write out everything still queued, then joins it */
+static void stop_writer(ClientCache* cache) {
+    WriteBehind* writer = cache->writer;
+    if (!writer) {
+        return;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = 1;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    /* Evictions triggered from here on are written through */
+    cache->writer = NULL;
+    apply_done(cache, writer->done);
+
+    pthread_cond_destroy(&writer->idle);
+    pthread_cond_destroy(&writer->wake);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
+
+/* Persists a new entry, in the background in write-behind mode */
+static void persist_entry(ClientCache* cache, CacheEntry* entry) {
+    if (cache->writer) {
+        WriteOp* op = new_write_op(WRITE_SAVE, entry->key, entry->hash);
+        if (op) {
+            op->data       = malloc(entry->json_len + 1);
+            op->len        = entry->json_len;
+            op->created_at = entry->created_at;
+            op->ttl        = entry->ttl;
+            op->stamp      = entry->stamp;
+            op->etag       = entry->etag ? strdup(entry->etag) : NULL;
+            op->seq        = ++cache->write_seq;
+        }
+        if (op && op->data && (!entry->etag || op->etag)) {
+            memcpy(op->data, entry->json_data, entry->json_len);
+            entry->write_seq = op->seq;
+            queue_write(cache, op);
+            return;
+        }
+
+        /* Out of memory: write through, after what is already queued */
+        free_write_ops(op);
+        flush_writes(cache, 0);
+    }
+
+    StoredRecord record;
+    memset(&record, 0, sizeof(record));
+    if (store_save(cache, entry->key, entry->json_data, entry->json_len,
+                   entry->created_at, entry->ttl, entry->stamp, entry->etag,
+                   cache->write_mode == CLIENT_CACHE_WRITE_DURABLE,
+                   &record) == 0) {
+        attach_record(cache, entry, &record);
+    }
+    bump_generation(cache);
+}
+
+static void persist_delete(ClientCache* cache, const char* key,
+                           uint64_t hash) {
+    if (cache->writer) {
+        WriteOp* op = new_write_op(WRITE_DELETE, key, hash);
+        if (op) {
+            queue_write(cache, op);
+            return;
+        }
+        flush_writes(cache, 0);
+    }
+    store_delete(cache, key);
+}
+
+/* A shared or disk record from before its key was invalidated */
+static int record_invalidated(const ClientCache* cache, const char* key,
+                              const StoredRecord* record) {
+    return cache_tombstones_covers(cache->tombstones, key, record->stamp);
+}
+
+static char* shared_load(ClientCache* cache, const char* key, size_t* len,
+                         StoredRecord* record) {
+    if (!cache->shm) {
+        return NULL;
+    }
+
+    CacheShmRecordInfo info;
+    char*              data = cache_shm_get(cache->shm, key, len, &info);
+    if (data) {
+        /* Not tied to a disk record: revalidation reloads it from here */
+        memset(record, 0, sizeof(StoredRecord));
+        record->created_at = (time_t)info.created_at;
+        record->expires_at = (time_t)info.expires_at;
+        record->stamp      = info.stamp;
+        snprintf(record->etag, sizeof(record->etag), "%s", info.etag);
+    }
+    return data;
+}
+
+static void open_generation(ClientCache* cache) {
+    ensure_cache_dir(cache);
+
+    char path[CACHE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", cache->root, CACHE_GENERATION_NAME);
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return;
+    }
+
+    /* Concurrent creators may both extend the file; zero-fill is harmless,
+     * and extends a file from before the epoch word existed */
+    size_t      size = CACHE_GENERATION_WORDS * sizeof(uint64_t);
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 ||
+        (file_stat.st_size < (off_t)size && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+
+    cache->generation      = map;
+    cache->epoch           = cache->generation + 1;
+    cache->seen_generation = __atomic_load_n(cache->generation,
+                                             __ATOMIC_ACQUIRE);
+    cache->seen_epoch      = current_epoch(cache);
+}
+
+static void close_generation(ClientCache* cache) {
+    if (cache->generation) {
+        munmap(cache->generation, CACHE_GENERATION_WORDS * sizeof(uint64_t));
+    }
+    cache->generation = NULL;
+    cache->epoch      = NULL;
+}
+
+static int is_file_name(const char* name, size_t length, const char* suffix) {
+    size_t suffix_len = strlen(suffix);
+    if (length != CACHE_INDEX_NAME_LENGTH + suffix_len ||
+        strcmp(name + CACHE_INDEX_NAME_LENGTH, suffix) != 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < CACHE_INDEX_NAME_LENGTH; i++) {
+        if (!strchr("0123456789abcdef", name[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Checks the header only; lookups still verify the key and checksum */
+static int read_file_header(const ClientCache* cache, const char* filepath,
+                            CacheFileHeader* header, struct stat* file_stat) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int valid =
+        fstat(fd, file_stat) == 0 &&
+        read(fd, header, sizeof(*header)) == (ssize_t)sizeof(*header) &&
+        memcmp(header->magic, CACHE_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+        header->version == CACHE_FILE_VERSION &&
+        header->epoch == current_epoch(cache) &&
+        sizeof(*header) + header->key_len + header->payload_len ==
+            (size_t)file_stat->st_size;
+    close(fd);
+    return valid ? 0 : -1;
+}
+
+/* Adopts the cache files of one directory into a new index */
+static void import_dir(ClientCache* cache, const char* dirpath, time_t now) {
+    DIR* dir = opendir(dirpath);
+    if (!dir) {
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name   = entry->d_name;
+        size_t      length = strlen(name);
+
+        char filepath[CACHE_PATH_MAX];
+        if (snprintf(filepath, sizeof(filepath), "%s/%s", dirpath, name) >=
+            (int)sizeof(filepath)) {
+            continue;
+        }
+
+        /* Left behind by a writer that died before its rename */
+        struct stat file_stat;
+        if (length > 4 && strcmp(name + length - 4, ".tmp") == 0) {
+            if (stat(filepath, &file_stat) == 0 &&
+                now - file_stat.st_mtime > CACHE_TMP_MAX_AGE) {
+                unlink(filepath);
+            }
+            continue;
+        }
+
+        if (!is_file_name(name, length, ".cache")) {
+            continue;
+        }
+
+        char stem[CACHE_INDEX_NAME_LENGTH + 1];
+        memcpy(stem, name, CACHE_INDEX_NAME_LENGTH);
+        stem[CACHE_INDEX_NAME_LENGTH] = '\0';
+
+        CacheFileHeader header;
+        if (read_file_header(cache, filepath, &header, &file_stat) == 0 &&
+            header.expires_at >= (int64_t)now) {
+            cache_index_put(cache->files_index, stem,
+                            (uint64_t)file_stat.st_size, header.expires_at);
+        } else {
+            unlink(filepath);
+        }
+    }
+    closedir(dir);
+}
+
+static void import_cache_files(ClientCache* cache) {
+    time_t now = time(NULL);
+    for (unsigned int shard = 0; shard < CACHE_SHARDS; shard++) {
+        char dirpath[CACHE_PATH_MAX];
+        shard_path(cache, shard, dirpath);
+        import_dir(cache, dirpath, now);
+    }
+}
+
+static void list_indexed_names(CacheBloomAdd add, void* add_data,
+                               void* user_data) {
+    cache_index_for_each(user_data, add, add_data);
+}
+
+static int rebuild_files_bloom(ClientCache* cache) {
+    return cache_bloom_rebuild(cache->files_bloom, list_indexed_names,
+                               cache->files_index);
+}
+
+/* The filter can only be trusted while the index it is rebuilt from is
+ * there, so it is opened after the index and only with it. Nothing is
+ * queued for the flusher here, so a filter that fails its first rebuild
+ * can still be closed. */
+static void open_files_index(ClientCache* cache) {
+    char path[CACHE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", cache->root, CACHE_FILES_INDEX_NAME);
+
+    int created        = 0;
+    cache->files_index = cache_index_open(path, &created);
+    if (!cache->files_index) {
+        return;
+    }
+    if (created) {
+        import_cache_files(cache);
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", cache->root, CACHE_FILES_BLOOM_NAME);
+    int bloom_created  = 0;
+    cache->files_bloom = cache_bloom_open(path, &bloom_created);
+    if (cache->files_bloom && (created || bloom_created) &&
+        rebuild_files_bloom(cache) != 0) {
+        /* A filter missing names would hide files: go without one */
+        cache_bloom_close(cache->files_bloom);
+        cache->files_bloom = NULL;
+    }
+}
+
+static void open_tombstones(ClientCache* cache) {
+    char path[CACHE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", cache->root, CACHE_TOMBSTONES_NAME);
+
+    cache->tombstones      = cache_tombstones_open(path);
+    cache->seen_tombstones = cache_tombstones_version(cache->tombstones);
+}
+
+static void unlink_cache_file(const char* name, void* user_data) {
+    const ClientCache* cache = user_data;
+    char               filepath[CACHE_PATH_MAX];
+    name_path(cache, name, filepath);
+    unlink(filepath);
+}
+
+/* Runs a GC slice when one is due; growth only comes from writes */
+static void maybe_collect_garbage(ClientCache* cache, time_t now) {
+    if (now >= cache->next_gc) {
+        cache->next_gc = now + CACHE_GC_PERIOD;
+        client_cache_collect_garbage(cache, CACHE_GC_SLICE_US);
+    }
+}
+
+static void revalidate_list(ClientCache* cache, CacheList* list) {
+    CacheEntry* entry = list->head;
+    while (entry) {
+        CacheEntry* next = entry->lru_next;
+        if (entry->write_seq == 0 && store_changed(cache, entry)) {
+            /* Deleted or rewritten elsewhere: reload on next access */
+            remove_entry(cache, entry);
+        }
+        entry = next;
+    }
+}
+
+/* Drops what another process invalidated; memory being short, everything */
+static void drop_invalidated(const char* prefix, uint64_t stamp,
+                             void* user_data) {
+    ClientCache* cache = user_data;
+    EntryBatch   batch;
+    if (collect_prefix(cache, prefix, &batch) != 0) {
+        remove_all_entries(cache);
+        return;
+    }
+
+    for (size_t i = 0; i < batch.count; i++) {
+        if (batch.entries[i]->stamp < stamp) {
+            remove_entry(cache, batch.entries[i]);
+        }
+    }
+    free(batch.entries);
+}
+
+static void sync_with_disk(ClientCache* cache) {
+    uint64_t tombstones = cache_tombstones_version(cache->tombstones);
+    if (tombstones != cache->seen_tombstones) {
+        cache->seen_tombstones = tombstones;
+        cache_tombstones_for_each(cache->tombstones, drop_invalidated, cache);
+    }
+
+    if (!cache->generation) {
+        return;
+    }
+
+    /* A plain shared-memory load: no system call unless the disk changed */
+    uint64_t generation =
+        __atomic_load_n(cache->generation, __ATOMIC_ACQUIRE);
+    uint64_t epoch = current_epoch(cache);
+    if (epoch != cache->seen_epoch) {
+        /* Cleared elsewhere: nothing resident can still be valid */
+        remove_all_entries(cache);
+        cache->seen_epoch      = epoch;
+        cache->seen_generation = generation;
+    } else if (generation != cache->seen_generation) {
+        revalidate_list(cache, &cache->window);
+        revalidate_list(cache, &cache->main);
+        cache->seen_generation = generation;
+    }
+}
+
+static void update_window_limits(ClientCache* cache) {
+    cache->window_capacity = cache->max_entries * CACHE_WINDOW_PERCENT / 100;
+    if (cache->window_capacity == 0) {
+        cache->window_capacity = 1;
+    }
+    cache->window_bytes = cache->max_bytes * CACHE_WINDOW_PERCENT / 100;
+}
+
+ClientCache* client_cache_create(size_t max_entries, time_t default_ttl) {
+    ClientCache* cache = calloc(1, sizeof(ClientCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->bucket_count = CACHE_INITIAL_BUCKETS;
+    cache->buckets      = calloc(cache->bucket_count, sizeof(CacheEntry*));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->max_entries  = max_entries > 0 ? max_entries : CACHE_MAX_ENTRIES;
+    cache->default_ttl  = default_ttl > 0 ? default_ttl : CACHE_DEFAULT_TTL;
+    cache->policy       = CLIENT_CACHE_POLICY_LRU;
+    cache->promote_hits = CACHE_PROMOTE_HITS;
+    cache->sketch       = cache_sketch_create(cache->max_entries);
+    cache->entry_slab   = cache_slab_create(sizeof(CacheEntry));
+    cache->arena        = cache_arena_create();
+    cache->key_tree     = cache_radix_create();
+    cache->wheel        = cache_wheel_create((int64_t)time(NULL));
+    if (!cache->sketch || !cache->entry_slab || !cache->arena ||
+        !cache->key_tree || !cache->wheel) {
+        cache_sketch_destroy(cache->sketch);
+        cache_slab_destroy(cache->entry_slab);
+        cache_arena_destroy(cache->arena);
+        cache_radix_destroy(cache->key_tree);
+        cache_wheel_destroy(cache->wheel);
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+
+    default_cache_dir(cache->root);
+    update_window_limits(cache);
+    open_generation(cache);
+    open_files_index(cache);
+    open_tombstones(cache);
+
+    return cache;
+}
+
+void client_cache_destroy(ClientCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    stop_writer(cache);
+    remove_all_entries(cache);
+    cache_shm_detach(cache->shm);
+    cache_sketch_destroy(cache->sketch);
+    close_generation(cache);
+    cache_log_close(cache->log);
+    cache_index_close(cache->files_index);
+    cache_bloom_close(cache->files_bloom);
+    cache_tombstones_close(cache->tombstones);
+    cache_slab_destroy(cache->entry_slab);
+    cache_arena_destroy(cache->arena);
+    cache_radix_destroy(cache->key_tree);
+    cache_wheel_destroy(cache->wheel);
+    free(cache->detached);
+    free(cache->buckets);
+    free(cache);
+}
+
+int client_cache_set_store(ClientCache* cache, ClientCacheStore store) {
+    if (!cache || (store != CLIENT_CACHE_STORE_FILES &&
+                   store != CLIENT_CACHE_STORE_LOG)) {
+        return -1;
+    }
+
+    if (store == client_cache_get_store(cache)) {
+        return 0;
     }
-}
 
-static void ensure_cache_dir() {
-    struct stat st;
-    if (stat(CACHE_DIR, &st) == -1) {
-        mkdir(CACHE_DIR, 0755);
+    /* The flusher must not be using the old store while it is swapped */
+    flush_writes(cache, 0);
+    apply_completions(cache);
+
+    CacheLog* log = NULL;
+    if (store == CLIENT_CACHE_STORE_LOG) {
+        ensure_cache_dir(cache);
+        log = cache_log_open(cache->root);
+        if (!log) {
+            return -1;
+        }
     }
+
+    /* Resident entries belong to the old store; they reload from the new */
+    remove_all_entries(cache);
+    cache_log_close(cache->log);
+    cache->log = log;
+    return 0;
 }
 
-static char* get_cache_filepath(const char* key) {
-    char hash[HASH_MD5_STRING_LENGTH];
-    if (hash_md5_string(key, strlen(key), hash, sizeof(hash)) != 0) {
-        return NULL;
+int client_cache_set_key_hash(ClientCache* cache, ClientCacheKeyHash key_hash) {
+    if (!cache || (key_hash != CLIENT_CACHE_KEY_HASH_FAST &&
+                   key_hash != CLIENT_CACHE_KEY_HASH_MD5)) {
+        return -1;
     }
 
-    char* filepath = malloc(512);
-    if (!filepath) {
-        return NULL;
+    if (key_hash == cache->key_hash) {
+        return 0;
     }
 
-    snprintf(filepath, 512, "%s/%s.json", CACHE_DIR, hash);
-    return filepath;
+    /* Resident entries point at files under the old names */
+    flush_writes(cache, 0);
+    apply_completions(cache);
+    remove_all_entries(cache);
+    cache->key_hash = key_hash;
+    return 0;
 }
 
-static int is_cache_file_valid(const char* filepath, time_t ttl) {
-    struct stat file_stat;
+/* One segment per cache directory: its records belong to that directory's
+ * store and tombstones. The name hashes the resolved path, so every
+ * spelling of the directory finds the same segment. */
+static CacheShm* attach_shared(const ClientCache* cache, size_t bytes) {
+    char*       resolved = realpath(cache->root, NULL);
+    const char* root     = resolved ? resolved : cache->root;
+    uint64_t    hash     = fnv1a(FNV_OFFSET_BASIS, root, strlen(root));
+    free(resolved);
+
+    char name[64];
+    snprintf(name, sizeof(name), CACHE_SHM_NAME_FORMAT,
+             (unsigned int)getuid(), (unsigned long long)hash);
+    return cache_shm_attach(name, bytes);
+}
+
+int client_cache_set_directory(ClientCache* cache, const char* dir) {
+    if (!cache || !dir || !*dir || strlen(dir) >= CACHE_DIR_MAX) {
+        return -1;
+    }
 
-    if (stat(filepath, &file_stat) != 0) {
+    if (strcmp(dir, cache->root) == 0) {
         return 0;
     }
 
-    time_t now = time(NULL);
-    double age = difftime(now, file_stat.st_mtime);
+    /* The flusher must not be writing into the old directory */
+    flush_writes(cache, 0);
+    apply_completions(cache);
 
-    if (age > (double)ttl) {
-        return 0;
+    if (make_dirs(dir) != 0) {
+        return -1;
     }
 
-    return 1;
+    CacheLog* log = NULL;
+    if (cache->log) {
+        log = cache_log_open(dir);
+        if (!log) {
+            return -1;
+        }
+    }
+
+    /* Resident entries belong to the old directory */
+    remove_all_entries(cache);
+    cache_log_close(cache->log);
+    cache_index_close(cache->files_index);
+    cache_bloom_close(cache->files_bloom);
+    cache_tombstones_close(cache->tombstones);
+    close_generation(cache);
+    cache->log         = log;
+    cache->files_index = NULL;
+    cache->files_bloom = NULL;
+    cache->tombstones  = NULL;
+
+    strcpy(cache->root, dir);
+    open_generation(cache);
+    open_files_index(cache);
+    open_tombstones(cache);
+
+    /* The old directory's segment would serve records of another store */
+    if (cache->shm) {
+        cache_shm_detach(cache->shm);
+        cache->shm = attach_shared(cache, cache->shm_bytes);
+    }
+    return 0;
 }
 
-static int save_to_file(const char* key, const char* json_data) {
-    ensure_cache_dir();
+const char* client_cache_get_directory(const ClientCache* cache) {
+    return cache ? cache->root : NULL;
+}
 
-    char* filepath = get_cache_filepath(key);
-    if (!filepath) {
+ClientCacheKeyHash client_cache_get_key_hash(const ClientCache* cache) {
+    return cache ? cache->key_hash : CLIENT_CACHE_KEY_HASH_FAST;
+}
+
+ClientCacheStore client_cache_get_store(const ClientCache* cache) {
+    return cache && cache->log ? CLIENT_CACHE_STORE_LOG
+                               : CLIENT_CACHE_STORE_FILES;
+}
+
+int client_cache_set_write_mode(ClientCache* cache, ClientCacheWriteMode mode) {
+    if (!cache || (mode != CLIENT_CACHE_WRITE_THROUGH &&
+                   mode != CLIENT_CACHE_WRITE_BEHIND &&
+                   mode != CLIENT_CACHE_WRITE_DURABLE)) {
         return -1;
     }
 
-    json_error_t error;
-    json_t*      json = json_loads(json_data, 0, &error);
-    if (!json) {
-        free(filepath);
+    if (mode == CLIENT_CACHE_WRITE_BEHIND) {
+        if (!cache->writer && start_writer(cache) != 0) {
+            return -1;
+        }
+    } else {
+        stop_writer(cache);
+    }
+
+    cache->write_mode = mode;
+    return 0;
+}
+
+ClientCacheWriteMode client_cache_get_write_mode(const ClientCache* cache) {
+    return cache ? cache->write_mode : CLIENT_CACHE_WRITE_THROUGH;
+}
+
+int client_cache_set_shared(ClientCache* cache, size_t bytes) {
+    if (!cache) {
         return -1;
     }
 
-    int result =
-        json_dump_file(json, filepath, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    CacheShm* shm = NULL;
+    if (bytes > 0) {
+        if (cache->shm) {
+            return 0;
+        }
 
-    json_decref(json);
-    free(filepath);
+        shm = attach_shared(cache, bytes);
+        if (!shm) {
+            return -1;
+        }
+    }
 
-    return result;
+    cache_shm_detach(cache->shm);
+    cache->shm       = shm;
+    cache->shm_bytes = bytes;
+    return 0;
 }
 
-static char* load_from_file(const char* key, time_t ttl) {
-    char* filepath = get_cache_filepath(key);
-    if (!filepath) {
-        return NULL;
+void client_cache_flush(ClientCache* cache) {
+    /* Applying results may evict, which queues deletes: repeat until quiet */
+    while (cache && cache->writer) {
+        flush_writes(cache, 0);
+        if (!apply_completions(cache)) {
+            break;
+        }
     }
+}
 
-    if (!is_cache_file_valid(filepath, ttl)) {
-        unlink(filepath);
-        free(filepath);
-        return NULL;
+int client_cache_collect_garbage(ClientCache* cache, unsigned int budget_us) {
+    if (!cache) {
+        return -1;
     }
 
-    json_error_t error;
-    json_t*      json = json_load_file(filepath, 0, &error);
-    free(filepath);
+    /* Resident entries too: a process that only runs this when idle still
+     * gives their memory back */
+    expire_entries(cache, time(NULL));
 
-    if (!json) {
-        return NULL;
+    size_t slots = 0;
+    if (cache->log) {
+        CacheLogStats log_stats;
+        cache_log_get_stats(cache->log, &log_stats);
+        slots = log_stats.slots;
+    } else if (cache->files_index) {
+        CacheIndexStats index_stats;
+        cache_index_get_stats(cache->files_index, &index_stats);
+        slots = index_stats.slots;
     }
 
-    char* json_str = json_dumps(json, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
-    json_decref(json);
+    /* At most one full cycle; the cursor persists for the next slice */
+    uint64_t deadline = latency_now_ns() + (uint64_t)budget_us * 1000;
+    int      removed  = 0;
+    for (size_t visited = 0; visited < slots; visited += CACHE_GC_BATCH) {
+        int step = cache->log
+                       ? cache_log_sweep(cache->log, CACHE_GC_BATCH,
+                                         cache->max_disk_bytes)
+                       : cache_index_sweep(cache->files_index, CACHE_GC_BATCH,
+                                           cache->max_disk_bytes,
+                                           unlink_cache_file, cache);
+        if (step < 0) {
+            break;
+        }
+        removed += step;
+        if (latency_now_ns() >= deadline) {
+            break;
+        }
+    }
 
-    return json_str;
-}
+    /* Deleted and expired files leave their bits set until a rebuild. The
+     * flusher may be adding to the filter, so it is never closed here; a
+     * failed rebuild leaves every name in place and is retried later */
+    if (!cache->log && cache_bloom_should_rebuild(cache->files_bloom)) {
+        rebuild_files_bloom(cache);
+    }
 
-static void delete_file(const char* key) {
-    char* filepath = get_cache_filepath(key);
-    if (filepath) {
-        unlink(filepath);
-        free(filepath);
+    if (removed > 0) {
+        __atomic_fetch_add(&cache->counters.gc_removed, (uint64_t)removed,
+                           __ATOMIC_RELAXED);
+        /* Not noted as our own change: resident entries whose records were
+         * collected have to be revalidated here as well */
+        if (cache->generation) {
+            __atomic_fetch_add(cache->generation, 1, __ATOMIC_ACQ_REL);
+        }
     }
+    return removed;
 }
 
-ClientCache* client_cache_create(size_t max_entries, time_t default_ttl) {
-    ClientCache* cache = malloc(sizeof(ClientCache));
+int client_cache_set_policy(ClientCache* cache, ClientCachePolicy policy) {
     if (!cache) {
-        return NULL;
+        return -1;
     }
 
-    cache->entries = linked_list_create();
-    if (!cache->entries) {
-        free(cache);
-        return NULL;
+    if (policy == CLIENT_CACHE_POLICY_LRU) {
+        /* Window entries are the most recent arrivals: they go in front */
+        while (cache->window.tail) {
+            CacheEntry* entry = cache->window.tail;
+            list_unlink(&cache->window, entry);
+            entry->in_window = 0;
+            list_push_front(&cache->main, entry);
+        }
+    } else if (policy != CLIENT_CACHE_POLICY_TINYLFU) {
+        return -1;
     }
 
-    cache->max_entries = max_entries > 0 ? max_entries : CACHE_MAX_ENTRIES;
-    cache->default_ttl = default_ttl > 0 ? default_ttl : CACHE_DEFAULT_TTL;
+    cache->policy = policy;
+    return 0;
+}
 
-    return cache;
+int client_cache_set_promotion(ClientCache* cache, unsigned int hits) {
+    if (!cache || hits == 0) {
+        return -1;
+    }
+    cache->promote_hits = hits;
+    return 0;
 }
 
-void client_cache_destroy(ClientCache* cache) {
+unsigned int client_cache_get_promotion(const ClientCache* cache) {
+    return cache ? cache->promote_hits : CACHE_PROMOTE_HITS;
+}
+
+ClientCachePolicy client_cache_get_policy(const ClientCache* cache) {
+    return cache ? cache->policy : CLIENT_CACHE_POLICY_LRU;
+}
+
+int client_cache_set_limits(ClientCache* cache, size_t max_bytes,
+                            size_t max_disk_bytes) {
     if (!cache) {
+        return -1;
+    }
+
+    cache->max_bytes      = max_bytes;
+    cache->max_disk_bytes = max_disk_bytes;
+    update_window_limits(cache);
+    apply_completions(cache);
+
+    enforce_limits(cache, NULL);
+    enforce_disk_limit(cache, NULL);
+    return 0;
+}
+
+static uint64_t load_counter(const uint64_t* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+int client_cache_get_stats(const ClientCache* cache, ClientCacheStats* stats) {
+    if (!cache || !stats) {
+        return -1;
+    }
+
+    stats->entries        = entry_count(cache);
+    stats->bytes          = total_bytes(cache);
+    stats->disk_bytes     = cache->disk_bytes;
+    stats->max_entries    = cache->max_entries;
+    stats->max_bytes      = cache->max_bytes;
+    stats->max_disk_bytes = cache->max_disk_bytes;
+    stats->evictions      = load_counter(&cache->counters.evictions);
+
+    CacheShmStats shm_stats;
+    memset(&shm_stats, 0, sizeof(shm_stats));
+    cache_shm_get_stats(cache->shm, &shm_stats);
+    stats->shared_entries   = shm_stats.records;
+    stats->shared_bytes     = shm_stats.bytes;
+    stats->shared_max_bytes = shm_stats.arena_bytes;
+
+    CacheSlabStats entry_stats;
+    CacheSlabStats arena_stats;
+    cache_slab_get_stats(cache->entry_slab, &entry_stats);
+    cache_arena_get_stats(cache->arena, &arena_stats);
+    stats->heap_reserved_bytes =
+        entry_stats.reserved_bytes + arena_stats.reserved_bytes;
+    stats->heap_used_bytes = entry_stats.used_bytes + arena_stats.used_bytes;
+    stats->heap_allocations =
+        entry_stats.heap_allocations + arena_stats.heap_allocations;
+    stats->store = client_cache_get_store(cache);
+    return 0;
+}
+
+int client_cache_get_counters(const ClientCache*   cache,
+                              ClientCacheCounters* counters) {
+    if (!cache || !counters) {
+        return -1;
+    }
+
+    const ClientCacheCounters* live = &cache->counters;
+    counters->lookups           = load_counter(&live->lookups);
+    counters->memory_hits       = load_counter(&live->memory_hits);
+    counters->shared_hits       = load_counter(&live->shared_hits);
+    counters->disk_hits         = load_counter(&live->disk_hits);
+    counters->misses            = load_counter(&live->misses);
+    counters->expirations       = load_counter(&live->expirations);
+    counters->stores            = load_counter(&live->stores);
+    counters->store_failures    = load_counter(&live->store_failures);
+    counters->evictions         = load_counter(&live->evictions);
+    counters->disk_reads        = load_counter(&live->disk_reads);
+    counters->disk_writes       = load_counter(&live->disk_writes);
+    counters->disk_write_errors = load_counter(&live->disk_write_errors);
+    counters->gc_removed        = load_counter(&live->gc_removed);
+    counters->promotions        = load_counter(&live->promotions);
+    counters->demotions         = load_counter(&live->demotions);
+    counters->filter_skips      = load_counter(&live->filter_skips);
+    latency_histogram_snapshot(&live->lookup, &counters->lookup);
+    latency_histogram_snapshot(&live->store, &counters->store);
+    latency_histogram_snapshot(&live->disk_read, &counters->disk_read);
+    latency_histogram_snapshot(&live->disk_write, &counters->disk_write);
+    return 0;
+}
+
+static void visit_entry(const CacheEntry* entry, ClientCacheVisitor visitor,
+                        void* user_data) {
+    ClientCacheEntryInfo info;
+    info.key        = entry->key;
+    info.bytes      = entry->bytes;
+    info.disk_bytes = entry->disk_bytes;
+    info.etag       = entry->etag;
+    info.created_at = entry->created_at;
+    info.ttl        = entry->ttl;
+    visitor(&info, user_data);
+}
+
+static void visit_list(const CacheList* list, ClientCacheVisitor visitor,
+                       void* user_data) {
+    for (CacheEntry* entry = list->head; entry; entry = entry->lru_next) {
+        visit_entry(entry, visitor, user_data);
+    }
+}
+
+void client_cache_foreach(const ClientCache* cache, ClientCacheVisitor visitor,
+                          void* user_data) {
+    if (!cache || !visitor) {
         return;
     }
 
-    linked_list_clear(cache->entries, (void (*)(void*))free_cache_entry);
-    linked_list_dispose(&cache->entries, NULL);
-    free(cache);
+    visit_list(&cache->window, visitor, user_data);
+    visit_list(&cache->main, visitor, user_data);
+}
+
+/* A client_cache_foreach_prefix() call in progress */
+typedef struct {
+    ClientCacheVisitor visitor;
+    void*              user_data;
+} PrefixVisit;
+
+static void visit_tree_entry(void* value, void* user_data) {
+    const PrefixVisit* visit = user_data;
+    visit_entry(value, visit->visitor, visit->user_data);
+}
+
+size_t client_cache_foreach_prefix(const ClientCache* cache, const char* prefix,
+                                   ClientCacheVisitor visitor,
+                                   void*              user_data) {
+    if (!cache || !prefix || !visitor) {
+        return 0;
+    }
+
+    PrefixVisit visit = {visitor, user_data};
+    return cache_radix_visit_prefix(cache->key_tree, prefix, visit_tree_entry,
+                                    &visit);
+}
+
+int client_cache_invalidate_prefix(ClientCache* cache, const char* prefix) {
+    if (!cache || !prefix) {
+        return -1;
+    }
+
+    if (!*prefix) {
+        int removed = (int)entry_count(cache);
+        client_cache_clear(cache);
+        return removed;
+    }
+
+    apply_completions(cache);
+
+    EntryBatch batch;
+    if (collect_prefix(cache, prefix, &batch) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < batch.count; i++) {
+        CacheEntry* entry = batch.entries[i];
+        persist_delete(cache, entry->key, entry->hash);
+        cache_shm_delete(cache->shm, entry->key);
+        remove_entry(cache, entry);
+    }
+    free(batch.entries);
+
+    /* Copies in the shared segment and on disk that were not resident are
+     * dropped when loaded; with no slot left for the tombstone, the only
+     * way to reach them all is to clear. Resident entries are checked
+     * already: only a tombstone of another process makes them due again */
+    uint64_t changes;
+    if (cache_tombstones_add(cache->tombstones, prefix, &changes) != 0) {
+        client_cache_clear(cache);
+    } else if (changes == cache->seen_tombstones + 1) {
+        cache->seen_tombstones = changes;
+    }
+
+    bump_generation(cache);
+    return (int)batch.count;
 }
 
 int client_cache_set(ClientCache* cache, const char* key,
                      const char* json_data) {
-    if (!cache || !key || !json_data) {
+    if (!json_data) {
         return -1;
     }
+    return client_cache_set_ex(cache, key, json_data, strlen(json_data), 0,
+                               NULL);
+}
 
-    LinkedList_foreach(cache->entries, node) {
-        CacheEntry* entry = (CacheEntry*)node->item;
-        if (strcmp(entry->key, key) == 0) {
-            linked_list_remove(cache->entries, node,
-                               (void (*)(void*))free_cache_entry);
-            break;
-        }
+static int store_entry(ClientCache* cache, const char* key, const char* data,
+                       size_t len, time_t ttl, const char* etag) {
+    if (etag && strlen(etag) >= CACHE_ETAG_MAX) {
+        etag = NULL;
     }
 
-    if (cache->entries->size >= cache->max_entries) {
-        if (cache->entries->head) {
-            CacheEntry* oldest = (CacheEntry*)cache->entries->head->item;
-            LinkedList_foreach(cache->entries, node) {
-                CacheEntry* entry = (CacheEntry*)node->item;
-                if (entry->created_at < oldest->created_at) {
-                    oldest = entry;
-                }
-            }
+    apply_completions(cache);
 
-            LinkedList_foreach(cache->entries, node) {
-                if (node->item == oldest) {
-                    delete_file(oldest->key);
-                    linked_list_remove(cache->entries, node,
-                                       (void (*)(void*))free_cache_entry);
-                    break;
-                }
-            }
-        }
+    time_t now = time(NULL);
+    expire_entries(cache, now);
+
+    uint64_t    hash     = hash_key(key);
+    CacheEntry* existing = index_find(cache, key, hash);
+    if (existing) {
+        remove_entry(cache, existing);
     }
 
-    CacheEntry* entry = malloc(sizeof(CacheEntry));
+    time_t      life  = ttl > 0 ? ttl : cache->default_ttl;
+    uint64_t    stamp = cache_tombstones_stamp(cache->tombstones,
+                                               (int64_t)(now + life));
+    CacheEntry* entry =
+        add_entry(cache, key, hash, data, len, now, life, stamp, etag);
     if (!entry) {
         return -1;
     }
 
-    entry->key       = strdup(key);
-    entry->json_data = strdup(json_data);
+    persist_entry(cache, entry);
+    if (cache->shm) {
+        cache_shm_put(cache->shm, key, data, len, now, now + life, stamp,
+                      etag);
+    }
 
-    if (!entry->key || !entry->json_data) {
-        free_cache_entry(entry);
-        return -1;
+    /* The entry may itself lose TinyLFU admission; that is not an error */
+    if (enforce_limits(cache, entry) == 0) {
+        enforce_disk_limit(cache, entry);
     }
 
-    entry->created_at = time(NULL);
-    entry->ttl        = cache->default_ttl;
+    maybe_collect_garbage(cache, now);
+    return 0;
+}
 
-    if (linked_list_append(cache->entries, entry) != 0) {
-        free_cache_entry(entry);
+int client_cache_set_ex(ClientCache* cache, const char* key, const char* data,
+                        size_t len, time_t ttl, const char* etag) {
+    if (!cache || !key || !data) {
         return -1;
     }
 
-    save_to_file(key, json_data);
+    uint64_t start  = latency_now_ns();
+    int      result = store_entry(cache, key, data, len, ttl, etag);
 
-    return 0;
+    latency_histogram_record(&cache->counters.store, latency_now_ns() - start);
+    count(result == 0 ? &cache->counters.stores
+                      : &cache->counters.store_failures);
+    return result;
 }
 
-char* client_cache_get(ClientCache* cache, const char* key) {
-    if (!cache || !key) {
-        return NULL;
+/* Deletes the expired responses of the legacy directory, then the
+ * directory itself once empty; returns whether it is still there */
+static int sweep_legacy_dir(const ClientCache* cache) {
+    DIR* dir = opendir(CACHE_LEGACY_DIR);
+    if (!dir) {
+        return 0;
     }
 
-    LinkedList_foreach(cache->entries, node) {
-        CacheEntry* entry = (CacheEntry*)node->item;
-        if (strcmp(entry->key, key) == 0) {
-            time_t now = time(NULL);
-            double age = difftime(now, entry->created_at);
+    time_t         now = time(NULL);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name   = entry->d_name;
+        size_t      length = strlen(name);
+        size_t      stem   = HASH_MD5_STRING_LENGTH - 1;
+        if (length != stem + strlen(CACHE_LEGACY_SUFFIX) ||
+            strcmp(name + stem, CACHE_LEGACY_SUFFIX) != 0) {
+            continue;
+        }
 
-            if (age > (double)entry->ttl) {
-                linked_list_remove(cache->entries, node,
-                                   (void (*)(void*))free_cache_entry);
-                delete_file(key);
-                return NULL;
-            }
+        char filepath[CACHE_PATH_MAX];
+        snprintf(filepath, sizeof(filepath), "%s/%s", CACHE_LEGACY_DIR, name);
 
-            char* filepath = get_cache_filepath(key);
-            if (filepath) {
-                struct stat file_stat;
-                if (stat(filepath, &file_stat) != 0) {
-                    free(filepath);
-                    linked_list_remove(cache->entries, node,
-                                       (void (*)(void*))free_cache_entry);
-                    return NULL;
-                }
-                free(filepath);
-            }
+        struct stat file_stat;
+        if (stat(filepath, &file_stat) == 0 && S_ISREG(file_stat.st_mode) &&
+            difftime(now, file_stat.st_mtime) > (double)cache->default_ttl) {
+            unlink(filepath);
+        }
+    }
+    closedir(dir);
+
+    /* Fresh responses, or the fallback root, keep it in place */
+    return rmdir(CACHE_LEGACY_DIR) != 0;
+}
+
+int client_cache_import_legacy(ClientCache* cache, const char* key,
+                               const char* legacy_key) {
+    if (!cache || !key || !legacy_key) {
+        return -1;
+    }
+
+    if (cache->legacy_state == 0) {
+        cache->legacy_state = sweep_legacy_dir(cache) ? 1 : -1;
+    }
+    if (cache->legacy_state < 0) {
+        return 0;
+    }
+
+    char name[HASH_MD5_STRING_LENGTH];
+    if (hash_md5_string(legacy_key, strlen(legacy_key), name, sizeof(name)) !=
+        0) {
+        return -1;
+    }
+
+    char filepath[CACHE_PATH_MAX];
+    snprintf(filepath, sizeof(filepath), "%s/%s%s", CACHE_LEGACY_DIR, name,
+             CACHE_LEGACY_SUFFIX);
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    /* The old cache judged freshness by the file's mtime */
+    struct stat file_stat;
+    char*       data = NULL;
+    time_t      age  = 0;
+    if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) &&
+        file_stat.st_size > 0) {
+        age  = time(NULL) - file_stat.st_mtime;
+        data = malloc((size_t)file_stat.st_size);
+    }
+
+    int valid = data && age <= cache->default_ttl &&
+                read(fd, data, (size_t)file_stat.st_size) ==
+                    (ssize_t)file_stat.st_size;
+    close(fd);
+    unlink(filepath);
+
+    int result = 0;
+    if (valid) {
+        time_t ttl = cache->default_ttl - (age > 0 ? age : 0);
+        result     = client_cache_set_ex(cache, key, data,
+                                         (size_t)file_stat.st_size,
+                                         ttl > 0 ? ttl : 1, NULL) == 0
+                         ? 1
+                         : -1;
+    }
+    free(data);
+    return result;
+}
+
+/* Counts the outcome in exactly one of the hit counters or misses */
+static const char* lookup(ClientCache* cache, const char* key, size_t* len) {
+    free(cache->detached);
+    cache->detached = NULL;
+    apply_completions(cache);
+
+    /* Misses count too: a key's second request is what earns it a slot,
+     * in the TinyLFU main list and in the hot tier alike */
+    uint64_t hash = hash_key(key);
+    cache_sketch_increment(cache->sketch, hash);
+
+    sync_with_disk(cache);
+
+    time_t now = time(NULL);
+    expire_entries(cache, now);
 
-            return strdup(entry->json_data);
+    CacheEntry* entry = index_find(cache, key, hash);
+    if (entry && entry->write_seq == 0 && !cache->generation &&
+        store_changed(cache, entry)) {
+        /* No shared counter: fall back to checking the store per hit */
+        remove_entry(cache, entry);
+        entry = NULL;
+    }
+
+    if (entry) {
+        double age = difftime(now, entry->created_at);
+
+        if (age > (double)entry->ttl) {
+            remove_entry(cache, entry);
+            persist_delete(cache, key, hash);
+            bump_generation(cache);
+            count(&cache->counters.expirations);
+            count(&cache->counters.misses);
+            return NULL;
         }
+
+        count(&cache->counters.memory_hits);
+        lru_touch(cache, entry);
+        if (len) {
+            *len = entry->json_len;
+        }
+        return entry->json_data;
     }
 
-    char* json_data = load_from_file(key, cache->default_ttl);
+    /* Another process may have fetched it already; the segment is the
+     * cheapest place to look before the disk */
+    StoredRecord record;
+    size_t       data_len  = 0;
+    char*        json_data = shared_load(cache, key, &data_len, &record);
+    if (json_data && record_invalidated(cache, key, &record)) {
+        cache_shm_delete(cache->shm, key);
+        free(json_data);
+        json_data = NULL;
+    }
     if (json_data) {
-        CacheEntry* entry = malloc(sizeof(CacheEntry));
-        if (entry) {
-            entry->key        = strdup(key);
-            entry->json_data  = strdup(json_data);
-            entry->created_at = time(NULL);
-            entry->ttl        = cache->default_ttl;
-
-            if (entry->key && entry->json_data) {
-                linked_list_append(cache->entries, entry);
-            } else {
-                free_cache_entry(entry);
+        count(&cache->counters.shared_hits);
+    } else {
+        json_data = store_load(cache, key, &data_len, &record);
+        if (json_data && record_invalidated(cache, key, &record)) {
+            persist_delete(cache, key, hash);
+            bump_generation(cache);
+            free(json_data);
+            json_data = NULL;
+        }
+        if (json_data) {
+            count(&cache->counters.disk_hits);
+        }
+        if (json_data && cache->shm) {
+            cache_shm_put(cache->shm, key, json_data, data_len,
+                          record.created_at, record.expires_at, record.stamp,
+                          record.etag[0] ? record.etag : NULL);
+        }
+    }
+    if (!json_data) {
+        count(&cache->counters.misses);
+        return NULL;
+    }
+
+    /* Warm and cold hits are only promoted to the hot tier on repeated
+     * access; a one-off request does not push out a hot entry */
+    entry = NULL;
+    if (cache_sketch_estimate(cache->sketch, hash) >= cache->promote_hits) {
+        entry = add_entry(cache, key, hash, json_data, data_len,
+                          record.created_at,
+                          record.expires_at - record.created_at, record.stamp,
+                          record.etag[0] ? record.etag : NULL);
+    }
+    if (entry) {
+        attach_record(cache, entry, &record);
+        if (enforce_limits(cache, entry) == 0) {
+            count(&cache->counters.promotions);
+            free(json_data);
+            if (len) {
+                *len = entry->json_len;
             }
+            return entry->json_data;
         }
-        return json_data;
     }
 
-    return NULL;
+    /* Not kept in memory: hand out the loaded copy until the next call */
+    cache->detached = json_data;
+    if (len) {
+        *len = data_len;
+    }
+    return json_data;
 }
 
-void client_cache_clear(ClientCache* cache) {
-    if (!cache) {
-        return;
+const char* client_cache_peek(ClientCache* cache, const char* key,
+                              size_t* len) {
+    if (!cache || !key) {
+        return NULL;
+    }
+
+    uint64_t    start = latency_now_ns();
+    const char* data  = lookup(cache, key, len);
+
+    latency_histogram_record(&cache->counters.lookup,
+                             latency_now_ns() - start);
+    count(&cache->counters.lookups);
+    return data;
+}
+
+char* client_cache_get(ClientCache* cache, const char* key) {
+    size_t      len  = 0;
+    const char* data = client_cache_peek(cache, key, &len);
+    if (!data) {
+        return NULL;
     }
 
-    LinkedList_foreach(cache->entries, node) {
-        CacheEntry* entry = (CacheEntry*)node->item;
-        delete_file(entry->key);
+    char* copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, data, len + 1);
     }
+    return copy;
+}
 
-    linked_list_clear(cache->entries, (void (*)(void*))free_cache_entry);
+/* Deletes the regular files of a directory; at the top, files shared with
+ * other processes are kept */
+static void clear_dir(ClientCache* cache, const char* dirpath, int top) {
+    DIR* dir = opendir(dirpath);
+    if (!dir) {
+        return;
+    }
 
-    DIR* dir = opendir(CACHE_DIR);
-    if (dir) {
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (strcmp(entry->d_name, ".") == 0 ||
-                strcmp(entry->d_name, "..") == 0) {
-                continue;
-            }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
 
-            if (strcmp(entry->d_name, "README.md") == 0) {
-                continue;
-            }
+        if (top && (strcmp(entry->d_name, "README.md") == 0 ||
+                    strcmp(entry->d_name, CACHE_GENERATION_NAME) == 0)) {
+            continue;
+        }
 
-            char filepath[512];
-            snprintf(filepath, sizeof(filepath), "%s/%s", CACHE_DIR,
-                     entry->d_name);
+        /* Open indexes are shared with other processes; they were emptied
+         * by the caller */
+        if (top && ((cache->log &&
+                     (strcmp(entry->d_name, CACHE_LOG_FILE_NAME) == 0 ||
+                      strcmp(entry->d_name, CACHE_LOG_INDEX_NAME) == 0)) ||
+                    (cache->files_index &&
+                     strcmp(entry->d_name, CACHE_FILES_INDEX_NAME) == 0) ||
+                    (cache->files_bloom &&
+                     strcmp(entry->d_name, CACHE_FILES_BLOOM_NAME) == 0) ||
+                    (cache->tombstones &&
+                     strcmp(entry->d_name, CACHE_TOMBSTONES_NAME) == 0))) {
+            continue;
+        }
 
-            struct stat file_stat;
-            if (stat(filepath, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
-                unlink(filepath);
-            }
+        char filepath[CACHE_PATH_MAX];
+        if (snprintf(filepath, sizeof(filepath), "%s/%s", dirpath,
+                     entry->d_name) >= (int)sizeof(filepath)) {
+            continue;
         }
-        closedir(dir);
+
+        struct stat file_stat;
+        if (stat(filepath, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+            unlink(filepath);
+        }
+    }
+    closedir(dir);
+}
+
+void client_cache_clear(ClientCache* cache) {
+    if (!cache) {
+        return;
     }
+
+    /* Queued writes would only be deleted again */
+    flush_writes(cache, 1);
+    apply_completions(cache);
+
+    cache_shm_clear(cache->shm);
+    if (cache->log) {
+        cache_log_clear(cache->log);
+    }
+
+    if (cache->epoch) {
+        /* Constant time: files of the old epoch read as misses from now on,
+         * in every process, and the GC deletes them over its next slices */
+        cache->seen_epoch =
+            __atomic_add_fetch(cache->epoch, 1, __ATOMIC_ACQ_REL);
+        cache_index_retire_all(cache->files_index);
+        cache_bloom_reset(cache->files_bloom);
+        cache->next_gc = 0;
+    } else {
+        cache_index_clear(cache->files_index);
+        cache_bloom_reset(cache->files_bloom);
+        clear_dir(cache, cache->root, 1);
+        for (unsigned int shard = 0; shard < CACHE_SHARDS; shard++) {
+            char dirpath[CACHE_PATH_MAX];
+            shard_path(cache, shard, dirpath);
+            clear_dir(cache, dirpath, 0);
+        }
+    }
+
+    /* Nothing is left for the tombstones to cover */
+    cache_tombstones_reset(cache->tombstones);
+    remove_all_entries(cache);
+    cache_sketch_reset(cache->sketch);
+    free(cache->detached);
+    cache->detached = NULL;
+
+    bump_generation(cache);
 }
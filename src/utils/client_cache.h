@@ -4,27 +4,230 @@
  *
  * This header provides a caching system for storing JSON responses with
  * configurable Time-To-Live (TTL) values. The cache uses both in-memory
- * storage and file-based persistence, with MD5 hashing for cache keys.
+ * storage and file-based persistence, with hashed keys as file names.
  *
  * Features:
- * - In-memory cache with LRU eviction
+ * - In-memory cache with true LRU eviction (hits refresh recency)
+ * - Optional W-TinyLFU admission: a small LRU window in front of the main
+ *   segment plus a frequency sketch, so one-off keys cannot push out
+ *   frequently used entries
+ * - Hash index over keys: get, set and eviction are O(1) on average
+ * - Radix tree over the same keys: invalidation and enumeration of every
+ *   key under a prefix such as "cities:" in O(prefix length + matches)
  * - File-based persistence for cache durability
- * - MD5 hashing of keys for filename generation
- * - TTL-based automatic expiration
+ * - Fast 128-bit hashing of keys for filename generation (MD5 optional)
+ * - Per-entry TTL and ETag
+ * - TTL-based automatic expiration: a timing wheel (cache_wheel.h) files
+ *   resident entries by expiry second, and every get or set reclaims a
+ *   few that are due, so expired entries free their memory without being
+ *   requested again
  * - Maximum entry limit with automatic cleanup
- *
- * Cache files are stored in: src/client/cache/
- * File naming: MD5(key).json
+ * - Three tiers with promotion and demotion (see below)
+ * - Optional byte budgets for memory (keys + payloads) and disk, with
+ *   per-entry size accounting
+ * - Optional write-behind: disk writes are queued, coalesced and done by
+ *   a background flusher thread
+ * - Optional host-wide shared-memory segment in front of the disk, shared
+ *   by all processes of the user
+ * - Lock-free hit/miss/expiry counters and per-operation latency
+ *   histograms (client_cache_get_counters())
+ * - Incremental disk garbage collection: expired records are removed and
+ *   the disk budget is enforced for the whole directory in short time
+ *   slices, driven by a persistent size/expiry index (no directory scans)
+ *
+ * Cache directory: $JUST_WEATHER_CACHE_DIR, else
+ * $XDG_CACHE_HOME/just-weather-client, else ~/.cache/just-weather-client
+ * (src/client/cache without HOME); see client_cache_set_directory().
+ * File naming: \<hh\>/hash_fast(key).cache, or MD5(key) if selected,
+ * where \<hh\> are the first two hex digits of the name. The 256 shard
+ * directories keep lookups and directory scans fast at 100k+ entries.
+ * Naming and sharding are those of the files store; the log store keeps
+ * every entry in one file (see below). Responses cached before the
+ * directory was configurable are imported on demand; see
+ * client_cache_import_legacy().
+ *
+ * Each file holds a small binary header (magic, format version, creation
+ * and expiry time, ETag, checksum) followed by the key and the response
+ * bytes exactly as they were stored. Files are written atomically (temp
+ * file + rename) and read back with a single read(); no JSON is parsed or
+ * serialised by the cache.
+ *
+ * A persistent Bloom filter of the file names written (cache_bloom.h)
+ * answers most lookups for keys that were never stored, so that they go
+ * to the network without touching the filesystem. The filter belongs to
+ * the files store; in the log store a miss is a probe of its mapped index.
+ *
+ * Alternatively (client_cache_set_store()) entries go to a single
+ * append-only log with a memory-mapped index, see cache_log.h; this avoids
+ * one inode and an open/stat/unlink per entry.
+ *
+ * Processes sharing the cache directory also share a change counter in
+ * its .generation file (memory mapped). Every disk write or delete
+ * bumps it; a process only re-checks its in-memory entries against the
+ * files when the counter moved, so memory hits cost no system call.
+ * The same file holds a clear epoch that every entry file records when it
+ * is written; a file of another epoch reads as a miss. Clearing bumps the
+ * epoch instead of deleting files, and the disk GC removes them later.
+ *
+ * Tiers, each sized and counted on its own:
+ * - hot: resident entries in process memory (entry limit and memory
+ *   budget, memory_hits)
+ * - warm: the mmap'd shared segment, when attached (its size,
+ *   shared_hits)
+ * - cold: the disk store (disk budget, disk_hits)
+ *
+ * Stores go to all tiers. A warm or cold hit is copied up to the hot tier
+ * only once the key has been requested CACHE_PROMOTE_HITS times (see
+ * client_cache_set_promotion()); before that it is served without
+ * displacing hot entries, and a cold hit is copied to the warm tier. An
+ * entry pushed out of the hot tier is demoted to the warm tier and keeps
+ * its disk record; only the disk budget and expiry delete records.
+ *
+ * Invalidating a prefix (client_cache_invalidate_prefix()) removes the
+ * matching resident entries at once. The warm and cold tiers cannot be
+ * searched by prefix, so the prefix is recorded as a tombstone in the
+ * shared prefixes.tomb file (cache_tombstone.h). Every record carries a
+ * stamp from that table; records under the prefix stamped before the
+ * tombstone read as misses and are deleted when they are loaded, and other
+ * processes drop their resident copies on their next call.
  */
 
 #ifndef CLIENT_CACHE_H
 #define CLIENT_CACHE_H
 
+#include "latency_histogram.h"
+
 #include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
-#define CACHE_MAX_ENTRIES 50  ///< Default maximum number of cache entries
-#define CACHE_DEFAULT_TTL 300 ///< Default TTL in seconds (5 minutes)
+#define CACHE_MAX_ENTRIES 50      ///< Default maximum number of cache entries
+#define CACHE_DEFAULT_TTL 300     ///< Default TTL in seconds (5 minutes)
+#define CACHE_ETAG_MAX 128        ///< Longest ETag stored (including NUL)
+#define CACHE_WRITE_QUEUE_MAX 256 ///< Queued disk writes before set blocks
+#define CACHE_GC_SLICE_US 1000    ///< Time budget of an automatic GC slice
+#define CACHE_DIR_MAX 384         ///< Longest cache directory path (with NUL)
+#define CACHE_PROMOTE_HITS 2      ///< Requests before a key is made resident
+
+#define CACHE_DEFAULT_MAX_BYTES (4 * 1024 * 1024) ///< Suggested memory budget
+#define CACHE_DEFAULT_MAX_DISK_BYTES                                           \
+    (16 * 1024 * 1024) ///< Suggested disk budget
+#define CACHE_DEFAULT_SHARED_BYTES                                             \
+    (8 * 1024 * 1024) ///< Suggested shared-memory segment size
+
+/**
+ * @enum ClientCachePolicy
+ * @brief Eviction/admission policy of a cache
+ */
+typedef enum {
+    CLIENT_CACHE_POLICY_LRU,     ///< Evict the least recently used entry
+    CLIENT_CACHE_POLICY_TINYLFU, ///< Window LRU + frequency-filtered main
+} ClientCachePolicy;
+
+/**
+ * @enum ClientCacheStore
+ * @brief Where a cache persists its entries
+ */
+typedef enum {
+    CLIENT_CACHE_STORE_FILES, ///< One \<hash\>.cache file per entry
+    CLIENT_CACHE_STORE_LOG,   ///< Single append-only log plus index
+} ClientCacheStore;
+
+/**
+ * @enum ClientCacheKeyHash
+ * @brief How the files store derives a file name from a key
+ */
+typedef enum {
+    CLIENT_CACHE_KEY_HASH_FAST, ///< 128-bit hash_fast (default)
+    CLIENT_CACHE_KEY_HASH_MD5,  ///< MD5, the naming before hash_fast
+} ClientCacheKeyHash;
+
+/**
+ * @enum ClientCacheWriteMode
+ * @brief When entries reach the disk store
+ */
+typedef enum {
+    CLIENT_CACHE_WRITE_THROUGH, ///< Before client_cache_set() returns
+    CLIENT_CACHE_WRITE_BEHIND,  ///< Later, from a background flusher thread
+    CLIENT_CACHE_WRITE_DURABLE, ///< Write through and fsync every write
+} ClientCacheWriteMode;
+
+/**
+ * @struct ClientCacheStats
+ * @brief Cache occupancy snapshot
+ *
+ * Memory bytes include the per-entry bookkeeping, the key and the payload.
+ * Disk bytes are the sizes of the cache files owned by resident entries.
+ * The shared fields describe the warm tier, 0 when it is not attached.
+ */
+typedef struct {
+    size_t   entries;             /**< Resident (hot) entries */
+    size_t   bytes;               /**< Memory charged to resident entries */
+    size_t   disk_bytes;          /**< Disk space of their cache files */
+    size_t   max_entries;         /**< Entry limit */
+    size_t   max_bytes;           /**< Memory budget, 0 if unlimited */
+    size_t   max_disk_bytes;      /**< Disk budget, 0 if unlimited */
+    size_t   evictions;           /**< Entries deleted for the disk budget */
+    size_t   shared_entries;      /**< Live records in the shared segment */
+    size_t   shared_bytes;        /**< Segment bytes they occupy */
+    size_t   shared_max_bytes;    /**< Segment capacity */
+    size_t   heap_reserved_bytes; /**< Slab chunks held for entries */
+    size_t   heap_used_bytes;     /**< Of which handed out */
+    uint64_t heap_allocations;    /**< malloc() calls the slabs made */
+
+    ClientCacheStore store; /**< Disk store in use */
+} ClientCacheStats;
+
+/**
+ * @struct ClientCacheCounters
+ * @brief Activity since the cache was created
+ *
+ * Every lookup ends in exactly one of the hit kinds or a miss; an entry
+ * found expired counts as a miss and as an expiration. Disk writes include
+ * those done by the write-behind flusher, which is why all fields are
+ * updated with atomic operations rather than under a lock.
+ */
+typedef struct {
+    uint64_t         lookups;           /**< Calls to peek or get */
+    uint64_t         memory_hits;       /**< Served from process memory */
+    uint64_t         shared_hits;       /**< Served from the shared segment */
+    uint64_t         disk_hits;         /**< Served from the disk store */
+    uint64_t         misses;            /**< Not found, or found expired */
+    uint64_t         expirations;       /**< Entries dropped by their TTL */
+    uint64_t         stores;            /**< Entries stored by a set */
+    uint64_t         store_failures;    /**< Stores refused (size, memory) */
+    uint64_t         evictions;         /**< Deleted for the disk budget */
+    uint64_t         disk_reads;        /**< Store lookups, hit or miss */
+    uint64_t         disk_writes;       /**< Records written to the store */
+    uint64_t         disk_write_errors; /**< Store writes that failed */
+    uint64_t         gc_removed;        /**< Records removed by the disk GC */
+    uint64_t         promotions;        /**< Shared/disk hits made resident */
+    uint64_t         demotions;         /**< Resident entries moved down */
+    uint64_t         filter_skips;      /**< Disk reads the filter saved */
+    LatencyHistogram lookup;            /**< Whole peek/get, any outcome */
+    LatencyHistogram store;             /**< Whole set, not queued I/O */
+    LatencyHistogram disk_read;         /**< One store lookup */
+    LatencyHistogram disk_write;        /**< One store write, any thread */
+} ClientCacheCounters;
+
+/**
+ * @struct ClientCacheEntryInfo
+ * @brief Size accounting of a single entry, see client_cache_foreach()
+ */
+typedef struct {
+    const char* key;        /**< Cache key (valid during the callback only) */
+    size_t      bytes;      /**< Memory charged to this entry */
+    size_t      disk_bytes; /**< Size of its cache file, 0 if none */
+    const char* etag;       /**< ETag stored with the entry, or NULL */
+    time_t      created_at; /**< When the entry was stored */
+    time_t      ttl;        /**< Time-To-Live in seconds */
+} ClientCacheEntryInfo;
+
+/**
+ * @brief Callback invoked by client_cache_foreach() for each entry
+ */
+typedef void (*ClientCacheVisitor)(const ClientCacheEntryInfo* info,
+                                   void*                       user_data);
 
 /**
  * @struct ClientCache
@@ -40,11 +243,12 @@ typedef struct ClientCache ClientCache;
  *
  * Allocates and initializes a new ClientCache with the specified configuration.
  * The cache stores entries both in memory and on disk for persistence.
- * When the maximum number of entries is reached, the oldest entries are
- * evicted.
+ * When the maximum number of entries is reached, the least recently used
+ * entry is demoted out of memory.
  *
- * @param max_entries Maximum number of cache entries to store.
- *                    When exceeded, oldest entries are removed (LRU).
+ * @param max_entries Maximum number of resident entries (hot tier).
+ *                    When exceeded, the least recently used entry is
+ *                    demoted (LRU).
  *                    Typical value: CACHE_MAX_ENTRIES (50).
  * @param default_ttl Default Time-To-Live in seconds for cache entries.
  *                    Entries older than TTL are considered expired.
@@ -53,8 +257,8 @@ typedef struct ClientCache ClientCache;
  * @return Pointer to the newly created ClientCache structure, or NULL if
  *         memory allocation fails
  *
- * @note The cache directory (src/client/cache/) is created automatically
- *       if it doesn't exist.
+ * @note The default cache directory (see the file description) is
+ *       created automatically, with its parents, if it doesn't exist.
  *
  * @see client_cache_destroy()
  *
@@ -89,25 +293,330 @@ ClientCache* client_cache_create(size_t max_entries, time_t default_ttl);
  */
 void client_cache_destroy(ClientCache* cache);
 
+/**
+ * @brief Selects the eviction policy
+ *
+ * New caches use CLIENT_CACHE_POLICY_LRU. With CLIENT_CACHE_POLICY_TINYLFU,
+ * new entries first enter a small LRU window (1% of max_entries, at least
+ * one entry). When the window overflows, its oldest entry is only admitted
+ * to the main segment if it has been requested more often than the main
+ * segment's least recently used entry; otherwise the newcomer is dropped.
+ * Request frequencies are tracked by client_cache_get() in a count-min
+ * sketch that is periodically halved, so old popularity fades.
+ *
+ * The policy can be changed at any time; existing entries are kept.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param policy Policy to use from now on
+ *
+ * @return 0 on success, -1 on invalid arguments
+ *
+ * @par Example:
+ * @code
+ * ClientCache *cache = client_cache_create(CACHE_MAX_ENTRIES,
+ *                                          CACHE_DEFAULT_TTL);
+ * client_cache_set_policy(cache, CLIENT_CACHE_POLICY_TINYLFU);
+ * @endcode
+ */
+int client_cache_set_policy(ClientCache* cache, ClientCachePolicy policy);
+
+/**
+ * @brief Returns the active eviction policy (LRU for NULL)
+ */
+ClientCachePolicy client_cache_get_policy(const ClientCache* cache);
+
+/**
+ * @brief Sets how often a key must be requested before it goes hot
+ *
+ * A lookup served from the shared segment or the disk store copies the
+ * entry into process memory only when the key's request count (misses
+ * included, estimated by the frequency sketch) reaches hits. 1 promotes
+ * on every such hit.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param hits Requests needed, at least 1 (default CACHE_PROMOTE_HITS)
+ *
+ * @return 0 on success, -1 on invalid arguments
+ */
+int client_cache_set_promotion(ClientCache* cache, unsigned int hits);
+
+/**
+ * @brief Returns the promotion threshold (the default for NULL)
+ */
+unsigned int client_cache_get_promotion(const ClientCache* cache);
+
+/**
+ * @brief Selects the disk store of the cache
+ *
+ * Entries currently held in memory are dropped; anything persisted in the
+ * previous store stays on disk but is not visible through the new one.
+ * New caches use CLIENT_CACHE_STORE_FILES.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param store Store to use from now on
+ *
+ * @return 0 on success, -1 on invalid arguments or if the log cannot be
+ *         opened (the current store stays in use)
+ */
+int client_cache_set_store(ClientCache* cache, ClientCacheStore store);
+
+/**
+ * @brief Returns the active disk store (files for NULL)
+ */
+ClientCacheStore client_cache_get_store(const ClientCache* cache);
+
+/**
+ * @brief Moves the cache to another directory
+ *
+ * The directory (and its parents) is created if needed. Entries held in
+ * memory are dropped; the disk store reopens in the new directory. An
+ * attached shared-memory segment is swapped for the new directory's; if
+ * that cannot be attached, the cache goes on without one.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param dir Cache directory, shorter than CACHE_DIR_MAX
+ *
+ * @return 0 on success, -1 on invalid arguments or if the directory or its
+ *         log cannot be opened (the current directory stays in use)
+ */
+int client_cache_set_directory(ClientCache* cache, const char* dir);
+
+/**
+ * @brief Returns the cache directory (NULL for NULL)
+ */
+const char* client_cache_get_directory(const ClientCache* cache);
+
+/**
+ * @brief Selects the file naming of the files store
+ *
+ * Files are named by the 128-bit hash_fast of the key unless
+ * CLIENT_CACHE_KEY_HASH_MD5 is selected. Only the files store names files
+ * by key; the log store ignores this setting. MD5 names do not make files
+ * of an older cache layout readable, since their format differs as well.
+ * Entries currently held in memory are dropped.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param key_hash Naming to use from now on
+ *
+ * @return 0 on success, -1 on invalid arguments
+ */
+int client_cache_set_key_hash(ClientCache* cache, ClientCacheKeyHash key_hash);
+
+/**
+ * @brief Returns the active file naming (hash_fast for NULL)
+ */
+ClientCacheKeyHash client_cache_get_key_hash(const ClientCache* cache);
+
+/**
+ * @brief Selects when writes reach the disk store
+ *
+ * In write-behind mode client_cache_set() only updates memory and queues
+ * the disk write for a flusher thread. Repeated writes (or a write and a
+ * delete) of a key that are still queued are coalesced into the latest
+ * one; the flusher takes the whole queue as one batch. At most
+ * CACHE_WRITE_QUEUE_MAX writes are queued, beyond that client_cache_set()
+ * waits for the flusher. Leaving write-behind mode and
+ * client_cache_destroy() write out everything queued first.
+ *
+ * The cache itself stays single-threaded: only the flusher runs
+ * concurrently, and it touches nothing but the store.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param mode Write mode to use from now on (new caches write through)
+ *
+ * @return 0 on success, -1 on invalid arguments or if the flusher thread
+ *         cannot be started
+ */
+int client_cache_set_write_mode(ClientCache* cache, ClientCacheWriteMode mode);
+
+/**
+ * @brief Returns the active write mode (write-through for NULL)
+ */
+ClientCacheWriteMode client_cache_get_write_mode(const ClientCache* cache);
+
+/**
+ * @brief Waits until every queued write has reached the disk store
+ *
+ * A no-op unless the cache is in write-behind mode.
+ *
+ * @param cache Pointer to the ClientCache structure (safe to pass NULL)
+ */
+void client_cache_flush(ClientCache* cache);
+
+/**
+ * @brief Runs one time-sliced step of the disk garbage collector
+ *
+ * The disk store (files or log) keeps an index of every record's size and
+ * expiry, shared by all processes. Each step resumes the shared cursor
+ * over that index, removes expired records and, while the store as a whole
+ * exceeds the disk budget of client_cache_set_limits(), the visited records
+ * that expire soonest. It stops when budget_us has elapsed or after one
+ * full pass. A slice of CACHE_GC_SLICE_US runs automatically every few
+ * seconds from client_cache_set(); call this for more (e.g. when idle).
+ * Each call also expires a batch of resident entries, as lookups and
+ * stores do, so a process that makes no other calls still frees them.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param budget_us Time budget in microseconds; at least one step runs
+ *
+ * @return Number of records removed, or -1 if cache is NULL
+ */
+int client_cache_collect_garbage(ClientCache* cache, unsigned int budget_us);
+
+/**
+ * @brief Attaches the cache to the host-wide shared-memory segment
+ *
+ * Every process of the same user that attaches with the same cache
+ * directory shares one segment (see cache_shm.h); the segment name holds
+ * a hash of the directory's resolved path. Stored entries are also put in
+ * the segment, and a memory miss looks there before the disk, so a repeat
+ * lookup made by another (possibly already finished) process is served
+ * from memory.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param bytes Segment size if it has to be created, or 0 to detach
+ *
+ * @return 0 on success, -1 on invalid arguments or if the segment cannot
+ *         be attached
+ */
+int client_cache_set_shared(ClientCache* cache, size_t bytes);
+
+/**
+ * @brief Caps the cache by bytes instead of (or on top of) entry count
+ *
+ * With a memory budget, least valuable entries are demoted until the sum
+ * of all entry sizes (bookkeeping + key + payload) fits; an entry larger
+ * than the whole budget is not kept in memory. With a disk budget, entries
+ * are evicted (memory and file) until their cache files fit, and the disk
+ * garbage collector (client_cache_collect_garbage()) holds the whole store,
+ * including records of other processes, to the same budget. The entry
+ * limit given to client_cache_create() stays in force as well. Limits are
+ * enforced immediately.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param max_bytes Memory budget in bytes, 0 for no byte limit
+ * @param max_disk_bytes Disk budget in bytes, 0 for no byte limit
+ *
+ * @return 0 on success, -1 if cache is NULL
+ *
+ * @par Example:
+ * @code
+ * ClientCache *cache = client_cache_create(4096, CACHE_DEFAULT_TTL);
+ * client_cache_set_limits(cache, CACHE_DEFAULT_MAX_BYTES,
+ *                         CACHE_DEFAULT_MAX_DISK_BYTES);
+ * @endcode
+ */
+int client_cache_set_limits(ClientCache* cache, size_t max_bytes,
+                            size_t max_disk_bytes);
+
+/**
+ * @brief Fills in current occupancy and limits
+ *
+ * @return 0 on success, -1 on invalid arguments
+ */
+int client_cache_get_stats(const ClientCache* cache, ClientCacheStats* stats);
+
+/**
+ * @brief Copies the activity counters and latency histograms
+ *
+ * Cheap enough to call at any time; it takes no lock, so a write finishing
+ * on the flusher thread during the copy may be only partly reflected.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param counters Output
+ *
+ * @return 0 on success, -1 on invalid arguments
+ *
+ * @par Example:
+ * @code
+ * ClientCacheCounters counters;
+ * client_cache_get_counters(cache, &counters);
+ * printf("hit ratio %.2f, p99 lookup %llu ns\n",
+ *        (double)(counters.lookups - counters.misses) / counters.lookups,
+ *        (unsigned long long)latency_histogram_percentile(&counters.lookup,
+ *                                                         99.0));
+ * @endcode
+ */
+int client_cache_get_counters(const ClientCache*   cache,
+                              ClientCacheCounters* counters);
+
+/**
+ * @brief Calls visitor with the size accounting of every resident entry
+ *
+ * The cache must not be modified from inside the callback.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param visitor Callback
+ * @param user_data Passed through to the callback
+ */
+void client_cache_foreach(const ClientCache* cache, ClientCacheVisitor visitor,
+                          void* user_data);
+
+/**
+ * @brief Calls visitor for every resident entry whose key starts with prefix
+ *
+ * Walks the key tree, so the cost depends on the prefix length and the
+ * number of matches, not on the size of the cache. The cache must not be
+ * modified from inside the callback.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param prefix Key prefix; "" visits every resident entry
+ * @param visitor Callback
+ * @param user_data Passed through to the callback
+ *
+ * @return Number of entries visited
+ */
+size_t client_cache_foreach_prefix(const ClientCache* cache, const char* prefix,
+                                   ClientCacheVisitor visitor, void* user_data);
+
+/**
+ * @brief Invalidates every entry whose key starts with prefix
+ *
+ * Resident entries under the prefix are removed from all tiers. Records
+ * of the shared segment and the disk store that were not resident are
+ * covered by a tombstone: in this and every other process they read as
+ * misses and are deleted when next loaded. Entries stored afterwards are
+ * not affected, even in the same second.
+ *
+ * A tombstone is dropped once every record it can cover has expired. If
+ * the table is full (CACHE_TOMBSTONE_SLOTS live tombstones) or cannot be
+ * opened, the whole cache is cleared instead. An empty prefix clears the
+ * cache.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param prefix Key prefix, e.g. "cities:" or "weather:city=Stockholm"
+ *
+ * @return Number of resident entries removed, or -1 on error
+ *
+ * @par Example:
+ * @code
+ * // Forget every city search, keep the forecasts
+ * client_cache_invalidate_prefix(cache, "cities:");
+ * @endcode
+ */
+int client_cache_invalidate_prefix(ClientCache* cache, const char* prefix);
+
 /**
  * @brief Stores data in the cache
  *
  * Stores the provided JSON data in the cache with the specified key.
  * The data is stored both in memory and persisted to disk. The cache
- * key is hashed using MD5 to generate a filename for disk storage.
+ * key is hashed to generate a filename for disk storage.
  *
- * If the cache is full (max_entries reached), the oldest entry is
- * automatically removed before adding the new one.
+ * If the cache is full (max_entries or a byte budget reached), least
+ * recently used entries are automatically removed to make room (under
+ * CLIENT_CACHE_POLICY_TINYLFU the admission filter picks the entries to
+ * drop, possibly the new one).
  *
  * @param cache Pointer to the ClientCache structure
  * @param key Cache key (typically an API endpoint or query identifier).
- *            Will be hashed with MD5 for filename generation.
+ *            Will be hashed for filename generation.
  * @param json_data JSON string to cache. The data is copied internally.
  *
  * @return 0 on success, -1 on failure
  * @retval 0 Data cached successfully
  * @retval -1 Failed to cache (invalid parameters, memory allocation failure,
- *            or file write error)
+ *            or larger than the memory budget)
  *
  * @note If an entry with the same key exists, it will be updated with
  *       new data and timestamp.
@@ -115,7 +624,7 @@ void client_cache_destroy(ClientCache* cache);
  * @note The json_data is copied, so the caller retains ownership of
  *       the original string.
  *
- * @see client_cache_get()
+ * @see client_cache_get(), client_cache_set_ex()
  *
  * @par Example:
  * @code
@@ -127,12 +636,60 @@ void client_cache_destroy(ClientCache* cache);
  */
 int client_cache_set(ClientCache* cache, const char* key,
                      const char* json_data);
+
+/**
+ * @brief Stores raw response bytes with their own TTL and ETag
+ *
+ * Like client_cache_set(), but the length is explicit, the entry expires
+ * after ttl seconds instead of the cache default, and an optional entity
+ * tag is kept alongside. The bytes are written to disk unchanged.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param key Cache key
+ * @param data Bytes to cache (copied)
+ * @param len Number of bytes in data
+ * @param ttl Time-To-Live in seconds, 0 for the cache default
+ * @param etag Entity tag from the response, or NULL. Tags of
+ *             CACHE_ETAG_MAX bytes or more are not stored.
+ *
+ * @return 0 on success, -1 on failure (see client_cache_set())
+ *
+ * @par Example:
+ * @code
+ * client_cache_set_ex(cache, key, body, body_len, TTL_CITIES,
+ *                     http_client_get_etag(http));
+ * @endcode
+ */
+int client_cache_set_ex(ClientCache* cache, const char* key, const char* data,
+                        size_t len, time_t ttl, const char* etag);
+
+/**
+ * @brief Imports a response cached before the directory was configurable
+ *
+ * Older releases kept one JSON file per key in src/client/cache, relative
+ * to the working directory, named MD5(key).json and fresh while its mtime
+ * was at most the default TTL old. If such a file exists for legacy_key
+ * and is still fresh, it is stored under key like client_cache_set_ex()
+ * for the rest of its lifetime. The file is deleted either way. The first
+ * call also deletes the expired files of that directory, and the
+ * directory once it is empty; after that, calls cost nothing.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param key Cache key to store the response under
+ * @param legacy_key Key the older release built for the same request
+ *
+ * @return 1 if a response was imported, 0 if there was none, -1 on failure
+ */
+int client_cache_import_legacy(ClientCache* cache, const char* key,
+                               const char* legacy_key);
+
 /**
  * @brief Retrieves data from the cache
  *
  * Looks up data in the cache by key. First checks in-memory cache, then
  * falls back to disk storage if not found in memory. Validates TTL before
- * returning data - expired entries are treated as cache misses.
+ * returning data - expired entries are treated as cache misses. A hit marks
+ * the entry as most recently used.
  *
  * @param cache Pointer to the ClientCache structure
  * @param key Cache key to look up
@@ -165,16 +722,49 @@ int client_cache_set(ClientCache* cache, const char* key,
  */
 char* client_cache_get(ClientCache* cache, const char* key);
 
+/**
+ * @brief Looks up data without copying it
+ *
+ * Same lookup as client_cache_get(), but returns a pointer into the cache
+ * instead of a copy. An in-memory hit performs no allocation and no system
+ * call.
+ *
+ * @param cache Pointer to the ClientCache structure
+ * @param key Cache key to look up
+ * @param len Output: length of the data in bytes (may be NULL)
+ *
+ * @return Borrowed, NUL-terminated JSON data, or NULL on miss. The pointer
+ *         stays valid until the next call on this cache; do not free it.
+ *
+ * @see client_cache_get()
+ *
+ * @par Example:
+ * @code
+ * size_t      len;
+ * const char *cached = client_cache_peek(cache, "weather:stockholm", &len);
+ * if (cached) {
+ *     json_t *json = json_loadb(cached, len, 0, NULL);
+ * }
+ * @endcode
+ */
+const char* client_cache_peek(ClientCache* cache, const char* key,
+                              size_t* len);
+
 /**
  * @brief Clears all cache entries
  *
- * Removes all entries from both in-memory cache and deletes all cache
- * files from disk. The cache directory itself is preserved.
+ * Removes all entries from the in-memory cache, the shared segment and
+ * the disk store. Takes constant time however many files the files store
+ * holds: it bumps the clear epoch, so that every process sees the old
+ * files as misses at once, and leaves deleting them to the disk GC
+ * (client_cache_collect_garbage()). The cache directory itself is
+ * preserved. Prefix tombstones (client_cache_invalidate_prefix()) are
+ * dropped as well.
  *
  * @param cache Pointer to the ClientCache structure (safe to pass NULL)
  *
  * @note This operation is irreversible - all cached data is permanently
- * deleted.
+ * deleted, even though files may stay on disk until the GC reaches them.
  *
  * @note The cache can still be used after clearing - it starts empty.
  *
@@ -0,0 +1,34 @@
+/**
+ * @file file_lock.c
+ * @brief Shared file lock implementation
+ *
+ * See file_lock.h for detailed API documentation.
+ */
+#include "file_lock.h"
+
+#include <errno.h>
+
+void file_lock_init(FileLock* lock, int fd) {
+    lock->fd = fd;
+    pthread_mutex_init(&lock->mutex, NULL);
+}
+
+void file_lock_destroy(FileLock* lock) {
+    pthread_mutex_destroy(&lock->mutex);
+}
+
+int file_lock_acquire(FileLock* lock, int operation) {
+    pthread_mutex_lock(&lock->mutex);
+    while (flock(lock->fd, operation) != 0) {
+        if (errno != EINTR) {
+            pthread_mutex_unlock(&lock->mutex);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void file_lock_release(FileLock* lock) {
+    flock(lock->fd, LOCK_UN);
+    pthread_mutex_unlock(&lock->mutex);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file file_lock.h
+ * @brief Lock on a file shared by processes and threads
+ *
+ * Cache files that several processes map, such as the log index, are
+ * guarded with flock(). An flock() lock belongs to the open file
+ * description, so threads of one process that share the descriptor do not
+ * exclude each other through it; a mutex is taken first for them.
+ *
+ * @par Example:
+ * @code
+ * FileLock lock;
+ * file_lock_init(&lock, fd);
+ * if (file_lock_acquire(&lock, LOCK_EX) == 0) {
+ *     update_shared_mapping();
+ *     file_lock_release(&lock);
+ * }
+ * file_lock_destroy(&lock);
+ * @endcode
+ */
+#ifndef FILE_LOCK_H
+#define FILE_LOCK_H
+
+#include <pthread.h>
+#include <sys/file.h>
+
+/**
+ * @struct FileLock
+ * @brief flock() on a descriptor plus a mutex for the process's threads
+ */
+typedef struct {
+    int             fd;    /**< Locked descriptor, owned by the caller */
+    pthread_mutex_t mutex; /**< flock() does not exclude our own threads */
+} FileLock;
+
+/**
+ * @brief Initialises a lock on an open descriptor
+ *
+ * @param lock Lock to initialise
+ * @param fd Descriptor to flock(); it stays open until the caller closes it
+ */
+void file_lock_init(FileLock* lock, int fd);
+
+/**
+ * @brief Destroys the mutex (the descriptor is not closed)
+ */
+void file_lock_destroy(FileLock* lock);
+
+/**
+ * @brief Takes the lock, retrying flock() when a signal interrupts it
+ *
+ * @param lock Lock
+ * @param operation LOCK_SH or LOCK_EX
+ *
+ * @return 0 on success, -1 if flock() failed (nothing is held then)
+ */
+int file_lock_acquire(FileLock* lock, int operation);
+
+/**
+ * @brief Releases a lock taken with file_lock_acquire()
+ */
+void file_lock_release(FileLock* lock);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * hash_fast.c - Fast non-cryptographic hashing implementation
+ *
+ * The core step multiplies two 64-bit words into 128 bits and folds the
+ * halves together (as in wyhash); each of four lanes consumes 16 bytes of
+ * a 64-byte stripe, so the multiplications of a stripe are independent and
+ * overlap in the pipeline. Inputs of up to 16 bytes, the common case for
+ * cache keys, take a branch-light path with at most two loads.
+ */
+
+#include "hash_fast.h"
+
+#include <string.h>
+
+#define STRIPE_SIZE 64
+#define LANE_SIZE 16
+
+/* Two hex digits per byte value */
+static const char HEX_PAIRS[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static const uint64_t PRIMES[4] = {
+    0xa0761d6478bd642fULL,
+    0xe7037ed1a0b428dbULL,
+    0x8ebc6af09c88c6e3ULL,
+    0x589965cc75374cc3ULL,
+};
+
+static uint64_t read64(const unsigned char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/* 64x64 -> 128-bit multiply, halves folded */
+static uint64_t mix(uint64_t a, uint64_t b) {
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+/* XXH3 final avalanche */
+static uint64_t avalanche(uint64_t hash) {
+    hash ^= hash >> 37;
+    hash *= 0x165667919e3779f9ULL;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static void mix_lane(uint64_t* lane, const unsigned char* p, uint64_t prime) {
+    *lane = mix(read64(p) ^ prime, read64(p + 8) ^ *lane);
+}
+
+HashFast128 hash_fast_128(const void* data, size_t data_size, uint64_t seed) {
+    const unsigned char* p        = data;
+    uint64_t             len      = (uint64_t)data_size;
+    uint64_t             lanes[4] = {
+        seed ^ PRIMES[0],
+        seed ^ PRIMES[1],
+        seed ^ PRIMES[2],
+        seed ^ PRIMES[3],
+    };
+
+    if (data_size <= LANE_SIZE) {
+        /* Overlapping head and tail loads cover every short length */
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (data_size >= 8) {
+            a = read64(p);
+            b = read64(p + data_size - 8);
+        } else if (data_size >= 4) {
+            a = read32(p);
+            b = read32(p + data_size - 4);
+        } else if (data_size > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[data_size >> 1] << 8) |
+                p[data_size - 1];
+        }
+        lanes[0] = mix(a ^ lanes[0], b ^ lanes[1]);
+        lanes[1] = mix(b ^ lanes[2], a ^ lanes[3]);
+    } else {
+        size_t offset = 0;
+        for (; offset + STRIPE_SIZE <= data_size; offset += STRIPE_SIZE) {
+            for (int lane = 0; lane < 4; lane++) {
+                mix_lane(&lanes[lane], p + offset + lane * LANE_SIZE,
+                         PRIMES[lane]);
+            }
+        }
+
+        /* The rest in 16-byte steps; the last one ends at the last byte */
+        int lane = 0;
+        for (; offset + LANE_SIZE < data_size; offset += LANE_SIZE) {
+            mix_lane(&lanes[lane], p + offset, PRIMES[lane]);
+            lane = (lane + 1) & 3;
+        }
+        mix_lane(&lanes[lane], p + data_size - LANE_SIZE, PRIMES[lane]);
+    }
+
+    /* Every lane feeds both halves */
+    uint64_t low  = mix(lanes[0] ^ lanes[2] ^ PRIMES[0],
+                        lanes[1] ^ lanes[3] ^ len);
+    uint64_t high = mix(lanes[1] ^ lanes[2] ^ PRIMES[3],
+                        lanes[0] ^ lanes[3] ^ PRIMES[2] ^ len);
+
+    HashFast128 result;
+    result.low  = avalanche(low);
+    result.high = avalanche(high ^ low);
+    return result;
+}
+
+/* A table lookup per byte: snprintf() would cost more than the hash */
+static void write_hex(uint64_t value, char* output) {
+    for (int i = 14; i >= 0; i -= 2) {
+        memcpy(output + i, &HEX_PAIRS[2 * (value & 0xff)], 2);
+        value >>= 8;
+    }
+}
+
+uint64_t hash_fast_64(const void* data, size_t data_size) {
+    return hash_fast_128(data, data_size, 0).low;
+}
+
+int hash_fast_string(const void* data, size_t data_size, char* output,
+                     size_t output_size) {
+    if ((!data && data_size > 0) || !output ||
+        output_size < HASH_FAST_STRING_LENGTH) {
+        return -1;
+    }
+
+    HashFast128 hash = hash_fast_128(data, data_size, 0);
+    write_hex(hash.high, output);
+    write_hex(hash.low, output + 16);
+    output[32] = '\0';
+    return 0;
+}
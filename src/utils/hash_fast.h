@@ -0,0 +1,65 @@
+/**
+ * hash_fast.h - Fast non-cryptographic hashing for cache keys
+ *
+ * An xxh3/wyhash-style 128-bit hash: 64-bit reads, four independent
+ * multiply-fold lanes over 64-byte stripes and an xxh3 avalanche. It is
+ * not byte-compatible with XXH3 itself, only built the same way. Use it
+ * where a key needs a well-distributed identifier (file names, hash
+ * tables), never where an attacker could choose colliding inputs.
+ *
+ * Usage:
+ *   char hash[HASH_FAST_STRING_LENGTH];
+ *   hash_fast_string("current:lat=59.3293", 19, hash, sizeof(hash));
+ *   printf("Hash: %s\n", hash);
+ */
+
+#ifndef HASH_FAST_H
+#define HASH_FAST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 128-bit hash length in hexadecimal characters (32) + null terminator */
+#define HASH_FAST_STRING_LENGTH 33
+
+/**
+ * 128-bit hash value
+ */
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} HashFast128;
+
+/**
+ * Calculate the 128-bit hash of a memory block
+ *
+ * @param data Input data to hash (may be NULL if data_size is 0)
+ * @param data_size Size of input data in bytes
+ * @param seed Seed; different seeds give independent hash functions
+ * @return Hash value
+ */
+HashFast128 hash_fast_128(const void* data, size_t data_size, uint64_t seed);
+
+/**
+ * Calculate a 64-bit hash of a memory block (the low half, seed 0)
+ *
+ * @param data Input data to hash
+ * @param data_size Size of input data in bytes
+ * @return Hash value
+ */
+uint64_t hash_fast_64(const void* data, size_t data_size);
+
+/**
+ * Calculate the 128-bit hash of a memory block and return it as hex string
+ *
+ * @param data Input data to hash
+ * @param data_size Size of input data in bytes
+ * @param output Buffer to store hex string (must be at least
+ * HASH_FAST_STRING_LENGTH bytes)
+ * @param output_size Size of output buffer
+ * @return 0 on success, -1 on error
+ */
+int hash_fast_string(const void* data, size_t data_size, char* output,
+                     size_t output_size);
+
+#endif /* HASH_FAST_H */
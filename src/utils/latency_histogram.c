@@ -0,0 +1,101 @@
+/**
+ * @file latency_histogram.c
+ * @brief Lock-free log2 latency histograms implementation
+ *
+ * See latency_histogram.h for detailed API documentation.
+ */
+#include "latency_histogram.h"
+
+#include <time.h>
+
+uint64_t latency_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int bucket_of(uint64_t ns) {
+    if (ns < 2) {
+        return 0;
+    }
+    int bucket = 63 - __builtin_clzll(ns);
+    return bucket < LATENCY_HISTOGRAM_BUCKETS ? bucket
+                                              : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+void latency_histogram_record(LatencyHistogram* histogram, uint64_t ns) {
+    if (!histogram) {
+        return;
+    }
+
+    __atomic_fetch_add(&histogram->buckets[bucket_of(ns)], 1,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sum_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&histogram->max_ns, __ATOMIC_RELAXED);
+    while (ns > max &&
+           !__atomic_compare_exchange_n(&histogram->max_ns, &max, ns, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void latency_histogram_snapshot(const LatencyHistogram* histogram,
+                                LatencyHistogram*       snapshot) {
+    if (!histogram || !snapshot) {
+        return;
+    }
+
+    snapshot->count  = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    snapshot->sum_ns = __atomic_load_n(&histogram->sum_ns, __ATOMIC_RELAXED);
+    snapshot->max_ns = __atomic_load_n(&histogram->max_ns, __ATOMIC_RELAXED);
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        snapshot->buckets[i] =
+            __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t latency_histogram_percentile(const LatencyHistogram* histogram,
+                                      double                  percentile) {
+    if (!histogram) {
+        return 0;
+    }
+
+    /* Sum the buckets rather than trusting count, which a concurrent
+     * recorder may have bumped before or after its bucket */
+    uint64_t total = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        total += histogram->buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    } else if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+
+    uint64_t rank = (uint64_t)((double)total * percentile / 100.0 + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = (2ULL << i) - 1;
+            return upper < histogram->max_ns ? upper : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+uint64_t latency_histogram_mean(const LatencyHistogram* histogram) {
+    if (!histogram || histogram->count == 0) {
+        return 0;
+    }
+    return histogram->sum_ns / histogram->count;
+}
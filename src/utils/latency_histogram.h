@@ -0,0 +1,93 @@
+/**
+ * @file latency_histogram.h
+ * @brief Lock-free log2 latency histograms
+ *
+ * A histogram is a fixed array of power-of-two buckets plus a count, a sum
+ * and a maximum. Recording is a handful of relaxed atomic additions, so any
+ * thread may record into the same histogram without a lock and the cost is
+ * small enough to leave on in production. Percentiles are resolved to the
+ * upper bound of their bucket, i.e. to within a factor of two.
+ *
+ * Features:
+ * - Zero-initialised storage is an empty histogram (no create/destroy)
+ * - Wait-free recording from any thread
+ * - Consistent-enough snapshots for reporting without stopping writers
+ *
+ * @par Example:
+ * @code
+ * static LatencyHistogram lookups;
+ *
+ * uint64_t start = latency_now_ns();
+ * do_lookup();
+ * latency_histogram_record(&lookups, latency_now_ns() - start);
+ *
+ * printf("p99 <= %llu ns\n",
+ *        (unsigned long long)latency_histogram_percentile(&lookups, 99.0));
+ * @endcode
+ */
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+#define LATENCY_HISTOGRAM_BUCKETS 40 ///< Bucket i holds [2^i, 2^(i+1)) ns
+
+/**
+ * @struct LatencyHistogram
+ * @brief Latency distribution in nanoseconds
+ *
+ * Bucket 0 also holds samples of 0 ns; the last bucket holds everything
+ * from 2^39 ns (about nine minutes) up.
+ */
+typedef struct {
+    uint64_t count;  /**< Samples recorded */
+    uint64_t sum_ns; /**< Sum of all samples */
+    uint64_t max_ns; /**< Largest sample */
+    uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS]; /**< Samples per bucket */
+} LatencyHistogram;
+
+/**
+ * @brief Gets a monotonic timestamp in nanoseconds for timing operations
+ *
+ * @return Nanoseconds from CLOCK_MONOTONIC (arbitrary origin)
+ */
+uint64_t latency_now_ns(void);
+
+/**
+ * @brief Adds one sample (safe to call concurrently from any thread)
+ *
+ * @param histogram Histogram to record into
+ * @param ns Duration in nanoseconds
+ */
+void latency_histogram_record(LatencyHistogram* histogram, uint64_t ns);
+
+/**
+ * @brief Copies a histogram that other threads may still be recording into
+ *
+ * Each field is read atomically; samples recorded during the copy may be
+ * counted in some fields and not yet in others.
+ *
+ * @param histogram Source
+ * @param snapshot Output
+ */
+void latency_histogram_snapshot(const LatencyHistogram* histogram,
+                                LatencyHistogram*       snapshot);
+
+/**
+ * @brief Estimates a percentile
+ *
+ * @param histogram Histogram (normally a snapshot)
+ * @param percentile Percentile in [0, 100], e.g. 50.0 or 99.0
+ *
+ * @return Upper bound in nanoseconds of the bucket holding the percentile,
+ *         capped at the largest sample; 0 if the histogram is empty
+ */
+uint64_t latency_histogram_percentile(const LatencyHistogram* histogram,
+                                      double                  percentile);
+
+/**
+ * @brief Mean sample in nanoseconds, 0 if the histogram is empty
+ */
+uint64_t latency_histogram_mean(const LatencyHistogram* histogram);
+
+#endif
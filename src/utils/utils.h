@@ -212,6 +212,27 @@ int validate_city_name(const char* city);
  */
 uint64_t get_current_time_ms();
 
+/**
+ * @brief Gets a monotonic timestamp in milliseconds
+ *
+ * Returns milliseconds from CLOCK_MONOTONIC. The origin is arbitrary, but
+ * the value never jumps with system clock changes, which makes it the
+ * right clock for deadlines and timeouts.
+ *
+ * @return Monotonic time in milliseconds
+ *
+ * @see get_current_time_ms()
+ *
+ * @par Example:
+ * @code
+ * uint64_t deadline = get_monotonic_time_ms() + 5000;
+ * while (get_monotonic_time_ms() < deadline) {
+ *     // ... wait for data ...
+ * }
+ * @endcode
+ */
+uint64_t get_monotonic_time_ms();
+
 /**
  * @brief Trims leading and trailing whitespace from a string
  *